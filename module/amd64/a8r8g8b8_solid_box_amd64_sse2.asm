@@ -0,0 +1,101 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;check a box is one colour
+;amd64 SSE2
+;
+; notes
+;   same as a8r8g8b8_solid_box in rdpCapture.c
+;   16 pixels at a time, then 4, then 1
+;   width must be > 0
+;   height must be > 0
+
+%include "common.asm"
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_solid_box_amd64_sse2(const uint8_t *s8, int src_stride,
+;                              int width, int height, uint32_t *pixel);
+PROC a8r8g8b8_solid_box_amd64_sse2
+    movsxd rsi, esi                 ; src_stride
+    mov eax, [rdi]                  ; first pixel
+    mov [r8], eax                   ; *pixel = first pixel
+    movd xmm7, eax
+    pshufd xmm7, xmm7, 0            ; 4 copies of the first pixel
+
+row_loop1:
+    mov r9, rdi                     ; s32
+    mov r10d, edx                   ; width
+
+loop16:
+    cmp r10d, 16
+    jl loop4
+    movdqu xmm0, [r9]
+    movdqu xmm1, [r9 + 16]
+    movdqu xmm2, [r9 + 32]
+    movdqu xmm3, [r9 + 48]
+    pcmpeqd xmm0, xmm7
+    pcmpeqd xmm1, xmm7
+    pcmpeqd xmm2, xmm7
+    pcmpeqd xmm3, xmm7
+    pand xmm0, xmm1
+    pand xmm2, xmm3
+    pand xmm0, xmm2
+    pmovmskb r11d, xmm0
+    cmp r11d, 0xFFFF
+    jne not_solid
+    add r9, 64
+    sub r10d, 16
+    jmp loop16
+
+loop4:
+    cmp r10d, 4
+    jl loop1
+    movdqu xmm0, [r9]
+    pcmpeqd xmm0, xmm7
+    pmovmskb r11d, xmm0
+    cmp r11d, 0xFFFF
+    jne not_solid
+    add r9, 16
+    sub r10d, 4
+    jmp loop4
+
+loop1:
+    test r10d, r10d
+    jz row_done
+    cmp eax, [r9]
+    jne not_solid
+    add r9, 4
+    dec r10d
+    jmp loop1
+
+row_done:
+    add rdi, rsi                    ; s8 += src_stride
+    dec ecx
+    jnz row_loop1
+
+    mov rax, 1                      ; return value, solid
+    ret
+
+not_solid:
+    mov rax, 0                      ; return value
+    ret
+END_OF_FILE
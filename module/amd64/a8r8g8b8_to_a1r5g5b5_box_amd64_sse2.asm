@@ -0,0 +1,118 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to RGB555
+;amd64 SSE2
+;
+; notes
+;   width must be multiple of 8 and > 0
+;   height must be > 0
+;   dither points to 4 rows of 8 pixels that repeat every 4 pixels, added
+;   to each pixel with unsigned saturation before the bits are dropped,
+;   row 0 is used for the first line, all zero for no dithering
+
+%include "common.asm"
+
+PREPARE_RODATA
+    cdb    times 4 dd 0x001F
+    cdg    times 4 dd 0x03E0
+    cdr    times 4 dd 0x7C00
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9, the seventh is on the stack
+
+;int
+;a8r8g8b8_to_a1r5g5b5_box_amd64_sse2(const uint8_t *s8, int src_stride,
+;                                    uint8_t *d8, int dst_stride,
+;                                    int width, int height,
+;                                    const uint8_t *dither);
+PROC a8r8g8b8_to_a1r5g5b5_box_amd64_sse2
+    push rbx
+    push rbp
+
+    movsxd rsi, esi                 ; src_stride
+    movsxd rcx, ecx                 ; dst_stride
+    mov r10, [rsp + 24]             ; dither
+
+    movdqa xmm8, [lsym(cdb)]
+    movdqa xmm9, [lsym(cdg)]
+    movdqa xmm10, [lsym(cdr)]
+
+    xor ebx, ebx                    ; ebx = line
+
+row_loop1:
+    mov eax, ebx
+    and eax, 3
+    shl eax, 5
+    movdqu xmm7, [r10 + rax]        ; dither for this line
+    mov rax, rdi                    ; s8
+    mov r11, rdx                    ; d8
+
+    mov ebp, r8d                    ; ebp = width
+    shr ebp, 3                      ; doing 8 pixels at a time
+
+loop1:
+    movdqu xmm0, [rax]              ; 4 pixels, 16 bytes
+    movdqu xmm1, [rax + 16]         ; 4 pixels, 16 bytes
+    paddusb xmm0, xmm7              ; dither
+    paddusb xmm1, xmm7              ; dither
+
+    ; (r >> 3) << 10 | (g >> 3) << 5 | (b >> 3)
+    movdqa xmm2, xmm0              ; blue
+    psrld xmm2, 3
+    pand xmm2, xmm8
+    movdqa xmm3, xmm0              ; green
+    psrld xmm3, 6
+    pand xmm3, xmm9
+    por xmm2, xmm3
+    psrld xmm0, 9                  ; red
+    pand xmm0, xmm10
+    por xmm0, xmm2
+    movdqa xmm4, xmm1              ; blue
+    psrld xmm4, 3
+    pand xmm4, xmm8
+    movdqa xmm5, xmm1              ; green
+    psrld xmm5, 6
+    pand xmm5, xmm9
+    por xmm4, xmm5
+    psrld xmm1, 9                  ; red
+    pand xmm1, xmm10
+    por xmm1, xmm4
+    packssdw xmm0, xmm1
+    movdqu [r11], xmm0              ; out 8 pixels, 16 bytes
+
+    ; move right
+    lea rax, [rax + 32]
+    lea r11, [r11 + 16]
+
+    dec ebp
+    jnz loop1
+
+    add rdi, rsi                    ; s8 += src_stride
+    add rdx, rcx                    ; d8 += dst_stride
+
+    inc ebx
+    cmp ebx, r9d
+    jl row_loop1
+
+    mov rax, 0                      ; return value
+    pop rbp
+    pop rbx
+    ret
+END_OF_FILE
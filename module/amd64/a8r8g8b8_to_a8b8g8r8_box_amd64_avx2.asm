@@ -0,0 +1,107 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to ABGR, alpha is 0 like the C version
+;amd64 AVX2
+;
+
+%include "common.asm"
+
+PREPARE_RODATA
+    align 32
+    cbswap db 2, 1, 0, 0x80, 6, 5, 4, 0x80, 10, 9, 8, 0x80, 14, 13, 12, 0x80
+           db 2, 1, 0, 0x80, 6, 5, 4, 0x80, 10, 9, 8, 0x80, 14, 13, 12, 0x80
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+; s8 and d8 do not need to be aligned
+;int
+;a8r8g8b8_to_a8b8g8r8_box_amd64_avx2(const char *s8, int src_stride,
+;                                    char *d8, int dst_stride,
+;                                    int width, int height);
+PROC a8r8g8b8_to_a8b8g8r8_box_amd64_avx2
+    push rbx
+
+    movsxd rsi, esi      ; src_stride
+    movsxd rcx, ecx      ; dst_stride
+
+    vmovdqu ymm7, [lsym(cbswap)]
+
+    cmp r9d, 1
+    jl done_loop_y
+
+; A R G B A R G B A R G B A R G B to
+; 0 B G R 0 B G R 0 B G R 0 B G R
+
+loop_y:
+    mov r10, rdi         ; src
+    mov r11, rdx         ; dst
+    mov eax, r8d         ; width
+
+loop_x16:
+    cmp eax, 16
+    jl done_loop_x16
+    vmovdqu ymm0, [r10]
+    vmovdqu ymm1, [r10 + 32]
+    vpshufb ymm0, ymm0, ymm7
+    vpshufb ymm1, ymm1, ymm7
+    vmovdqu [r11], ymm0
+    vmovdqu [r11 + 32], ymm1
+    lea r10, [r10 + 64]
+    lea r11, [r11 + 64]
+    sub eax, 16
+    jmp loop_x16
+done_loop_x16:
+
+    cmp eax, 8
+    jl loop_x
+    vmovdqu ymm0, [r10]
+    vpshufb ymm0, ymm0, ymm7
+    vmovdqu [r11], ymm0
+    lea r10, [r10 + 32]
+    lea r11, [r11 + 32]
+    sub eax, 8
+
+loop_x:
+    cmp eax, 1
+    jl done_loop_x
+    mov ebx, [r10]       ; A R G B
+    bswap ebx            ; B G R A
+    ror ebx, 8           ; A B G R
+    and ebx, 0x00FFFFFF  ; 0 B G R
+    mov [r11], ebx
+    lea r10, [r10 + 4]
+    lea r11, [r11 + 4]
+    dec eax
+    jmp loop_x
+done_loop_x:
+
+    add rdi, rsi         ; src += src_stride
+    add rdx, rcx         ; dst += dst_stride
+
+    dec r9d
+    jnz loop_y
+done_loop_y:
+
+    vzeroupper
+    mov eax, 0           ; return value
+    pop rbx
+    ret
+END_OF_FILE
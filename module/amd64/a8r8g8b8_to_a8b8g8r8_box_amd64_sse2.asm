@@ -17,14 +17,14 @@
 ;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 ;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 ;
-;ARGB to ABGR
+;ARGB to ABGR, alpha is 0 like the C version
 ;amd64 SSE2
 ;
 
 %include "common.asm"
 
 PREPARE_RODATA
-c1 times 4 dd 0xFF00FF00
+c1 times 4 dd 0x0000FF00
 c2 times 4 dd 0x00FF0000
 c3 times 4 dd 0x000000FF
 
@@ -81,8 +81,8 @@ loop_xpre:
     jl done_loop_x       ; all done with this row
     mov eax, [rsi]
     lea rsi, [rsi + 4]
-    mov edx, eax         ; a and g
-    and edx, 0xFF00FF00
+    mov edx, eax         ; g
+    and edx, 0x0000FF00
     mov ebx, eax         ; r
     and ebx, 0x00FF0000
     shr ebx, 16
@@ -98,7 +98,7 @@ loop_xpre:
 done_loop_xpre:
 
 ; A R G B A R G B A R G B A R G B to
-; A B G R A B G R A B G R A B G R
+; 0 B G R 0 B G R 0 B G R 0 B G R
 
 loop_x8:
     cmp rcx, 8
@@ -106,7 +106,7 @@ loop_x8:
 
     movdqa xmm0, [rsi]
     lea rsi, [rsi + 16]
-    movdqa xmm3, xmm0    ; a and g
+    movdqa xmm3, xmm0    ; g
     pand xmm3, xmm4
     movdqa xmm1, xmm0    ; r
     pand xmm1, xmm5
@@ -122,7 +122,7 @@ loop_x8:
 
     movdqa xmm0, [rsi]
     lea rsi, [rsi + 16]
-    movdqa xmm3, xmm0    ; a and g
+    movdqa xmm3, xmm0    ; g
     pand xmm3, xmm4
     movdqa xmm1, xmm0    ; r
     pand xmm1, xmm5
@@ -144,8 +144,8 @@ loop_x:
     jl done_loop_x
     mov eax, [rsi]
     lea rsi, [rsi + 4]
-    mov edx, eax         ; a and g
-    and edx, 0xFF00FF00
+    mov edx, eax         ; g
+    and edx, 0x0000FF00
     mov ebx, eax         ; r
     and ebx, 0x00FF0000
     shr ebx, 16
@@ -0,0 +1,208 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to NV12 709 full range
+;amd64 AVX2
+;
+; notes
+;   same arithmetic as the SSE2 version, 16 pixels at a time
+;   width should be multiple of 16 and > 0
+;   height should be even and > 0
+
+%include "common.asm"
+
+PREPARE_RODATA
+    align 32
+    cd255  times 8 dd 255
+    cw128  times 16 dw 128
+    cw54   times 16 dw 54
+    cw183  times 16 dw 183
+    cw18   times 16 dw 18
+    cw29   times 16 dw 29
+    cw99   times 16 dw 99
+    cw116  times 16 dw 116
+    cw12   times 16 dw 12
+    cw2    times 16 dw 2
+    cbuv   db 0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15
+           db 0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15
+
+%define LWIDTH         [rsp + 24] ; width
+%define LHEIGHT        [rsp + 32] ; height
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_nv12_709fr_box_amd64_avx2(const char *s8, int src_stride,
+;                                      char *d8_y, int dst_stride_y,
+;                                      char *d8_uv, int dst_stride_uv,
+;                                      int width, int height);
+PROC a8r8g8b8_to_nv12_709fr_box_amd64_avx2
+    push rbx
+    push rbp
+
+    movsxd rsi, esi                 ; src_stride
+    movsxd rcx, ecx                 ; dst_stride_y
+    movsxd r9, r9d                  ; dst_stride_uv
+
+    vmovdqu ymm15, [lsym(cd255)]
+    vmovdqu ymm14, [lsym(cw128)]
+
+    mov ebx, LHEIGHT                ; ebx = height
+    shr ebx, 1                      ; doing 2 lines at a time
+
+row_loop1:
+    mov rax, rdi                    ; s8
+    mov r10, rdx                    ; d8_y
+    mov r11, r8                     ; d8_uv
+
+    mov ebp, LWIDTH                 ; ebp = width
+    shr ebp, 4                      ; doing 16 pixels at a time
+
+loop1:
+    ; first line
+    vmovdqu ymm0, [rax]                   ; 8 pixels, 32 bytes
+    vmovdqu ymm5, [rax + 32]              ; 8 pixels, 32 bytes
+    vperm2i128 ymm6, ymm0, ymm5, 0x20 ; pixels 0 - 3, 8 - 11
+    vperm2i128 ymm7, ymm0, ymm5, 0x31 ; pixels 4 - 7, 12 - 15
+
+    vpand ymm1, ymm6, ymm15         ; blue
+    vpand ymm0, ymm7, ymm15         ; blue
+    vpackssdw ymm1, ymm1, ymm0      ; ymm1 = 16 blues
+    vpsrld ymm2, ymm6, 8            ; green
+    vpand ymm2, ymm2, ymm15         ; green
+    vpsrld ymm0, ymm7, 8            ; green
+    vpand ymm0, ymm0, ymm15         ; green
+    vpackssdw ymm2, ymm2, ymm0      ; ymm2 = 16 greens
+    vpsrld ymm3, ymm6, 16           ; red
+    vpand ymm3, ymm3, ymm15         ; red
+    vpsrld ymm0, ymm7, 16           ; red
+    vpand ymm0, ymm0, ymm15         ; red
+    vpackssdw ymm3, ymm3, ymm0      ; ymm3 = 16 reds
+
+    ; _Y = (( 54 * _R + 183 * _G +  18 * _B) >> 8);
+    vpmullw ymm8, ymm1, [lsym(cw18)]
+    vpmullw ymm0, ymm2, [lsym(cw183)]
+    vpaddw ymm8, ymm8, ymm0
+    vpmullw ymm0, ymm3, [lsym(cw54)]
+    vpaddw ymm8, ymm8, ymm0
+    vpsrlw ymm8, ymm8, 8
+
+    ; _U = ((-29 * _R -  99 * _G + 128 * _B) >> 8) + 128;
+    vpmullw ymm9, ymm1, ymm14
+    vpmullw ymm0, ymm2, [lsym(cw99)]
+    vpsubw ymm9, ymm9, ymm0
+    vpmullw ymm0, ymm3, [lsym(cw29)]
+    vpsubw ymm9, ymm9, ymm0
+    vpsraw ymm9, ymm9, 8
+    vpaddw ymm9, ymm9, ymm14
+
+    ; _V = ((128 * _R - 116 * _G -  12 * _B) >> 8) + 128;
+    vpmullw ymm10, ymm3, ymm14
+    vpmullw ymm0, ymm2, [lsym(cw116)]
+    vpsubw ymm10, ymm10, ymm0
+    vpmullw ymm0, ymm1, [lsym(cw12)]
+    vpsubw ymm10, ymm10, ymm0
+    vpsraw ymm10, ymm10, 8
+    vpaddw ymm10, ymm10, ymm14
+
+    ; second line
+    vmovdqu ymm0, [rax + rsi]             ; 8 pixels, 32 bytes
+    vmovdqu ymm5, [rax + rsi + 32]        ; 8 pixels, 32 bytes
+    vperm2i128 ymm6, ymm0, ymm5, 0x20 ; pixels 0 - 3, 8 - 11
+    vperm2i128 ymm7, ymm0, ymm5, 0x31 ; pixels 4 - 7, 12 - 15
+
+    vpand ymm1, ymm6, ymm15         ; blue
+    vpand ymm0, ymm7, ymm15         ; blue
+    vpackssdw ymm1, ymm1, ymm0      ; ymm1 = 16 blues
+    vpsrld ymm2, ymm6, 8            ; green
+    vpand ymm2, ymm2, ymm15         ; green
+    vpsrld ymm0, ymm7, 8            ; green
+    vpand ymm0, ymm0, ymm15         ; green
+    vpackssdw ymm2, ymm2, ymm0      ; ymm2 = 16 greens
+    vpsrld ymm3, ymm6, 16           ; red
+    vpand ymm3, ymm3, ymm15         ; red
+    vpsrld ymm0, ymm7, 16           ; red
+    vpand ymm0, ymm0, ymm15         ; red
+    vpackssdw ymm3, ymm3, ymm0      ; ymm3 = 16 reds
+
+    ; _Y = (( 54 * _R + 183 * _G +  18 * _B) >> 8);
+    vpmullw ymm11, ymm1, [lsym(cw18)]
+    vpmullw ymm0, ymm2, [lsym(cw183)]
+    vpaddw ymm11, ymm11, ymm0
+    vpmullw ymm0, ymm3, [lsym(cw54)]
+    vpaddw ymm11, ymm11, ymm0
+    vpsrlw ymm11, ymm11, 8
+
+    ; _U = ((-29 * _R -  99 * _G + 128 * _B) >> 8) + 128;
+    vpmullw ymm4, ymm1, ymm14
+    vpmullw ymm0, ymm2, [lsym(cw99)]
+    vpsubw ymm4, ymm4, ymm0
+    vpmullw ymm0, ymm3, [lsym(cw29)]
+    vpsubw ymm4, ymm4, ymm0
+    vpsraw ymm4, ymm4, 8
+    vpaddw ymm4, ymm4, ymm14
+    vpaddw ymm9, ymm9, ymm4
+
+    ; _V = ((128 * _R - 116 * _G -  12 * _B) >> 8) + 128;
+    vpmullw ymm4, ymm3, ymm14
+    vpmullw ymm0, ymm2, [lsym(cw116)]
+    vpsubw ymm4, ymm4, ymm0
+    vpmullw ymm0, ymm1, [lsym(cw12)]
+    vpsubw ymm4, ymm4, ymm0
+    vpsraw ymm4, ymm4, 8
+    vpaddw ymm4, ymm4, ymm14
+    vpaddw ymm10, ymm10, ymm4
+
+    ; uv add and divide(average)
+    ; U and V can not leave 0 - 255 so no need to clamp before adding
+    vphaddw ymm9, ymm9, ymm10       ; u0-3 v0-3 u4-7 v4-7, pairs added
+    vpaddw ymm9, ymm9, [lsym(cw2)]  ; add 2
+    vpsrlw ymm9, ymm9, 2            ; div 4
+    vpackuswb ymm9, ymm9, ymm9
+    vpshufb ymm9, ymm9, [lsym(cbuv)] ; uvuvuvuv in each lane
+    vpermq ymm9, ymm9, 0x08
+    vmovdqu [r11], xmm9             ; out 16 bytes uvuvuvuvuvuvuvuv
+
+    vpackuswb ymm8, ymm8, ymm11     ; ya0-7 yb0-7 ya8-15 yb8-15
+    vpermq ymm8, ymm8, 0xD8         ; ya0-15 yb0-15
+    vmovdqu [r10], xmm8             ; out 16 bytes yyyyyyyyyyyyyyyy
+    vextracti128 [r10 + rcx], ymm8, 1 ; out 16 bytes yyyyyyyyyyyyyyyy
+
+    ; move right
+    lea rax, [rax + 64]
+    lea r10, [r10 + 16]
+    lea r11, [r11 + 16]
+
+    dec ebp
+    jnz loop1
+
+    lea rdi, [rdi + rsi * 2]        ; s8 += src_stride * 2
+    lea rdx, [rdx + rcx * 2]        ; d8_y += dst_stride_y * 2
+    add r8, r9                      ; d8_uv += dst_stride_uv
+
+    dec ebx
+    jnz row_loop1
+
+    vzeroupper
+    mov rax, 0                      ; return value
+    pop rbp
+    pop rbx
+    ret
+END_OF_FILE
@@ -0,0 +1,137 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to RGB332
+;amd64 AVX2
+;
+; notes
+;   width must be multiple of 32 and > 0
+;   height must be > 0
+;   dither points to 4 rows of 8 pixels that repeat every 4 pixels, added
+;   to each pixel with unsigned saturation before the bits are dropped,
+;   row 0 is used for the first line, all zero for no dithering
+
+%include "common.asm"
+
+PREPARE_RODATA
+    align 32
+    cdb    times 8 dd 0xC0
+    cdg    times 8 dd 0x38
+    cdr    times 8 dd 0x07
+    cdperm dd 0, 4, 1, 5, 2, 6, 3, 7
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9, the seventh is on the stack
+
+;int
+;a8r8g8b8_to_r3g3b2_box_amd64_avx2(const uint8_t *s8, int src_stride,
+;                                  uint8_t *d8, int dst_stride,
+;                                  int width, int height,
+;                                  const uint8_t *dither);
+PROC a8r8g8b8_to_r3g3b2_box_amd64_avx2
+    push rbx
+    push rbp
+
+    movsxd rsi, esi                 ; src_stride
+    movsxd rcx, ecx                 ; dst_stride
+    mov r10, [rsp + 24]             ; dither
+
+    vmovdqu ymm8, [lsym(cdb)]
+    vmovdqu ymm9, [lsym(cdg)]
+    vmovdqu ymm10, [lsym(cdr)]
+    vmovdqu ymm11, [lsym(cdperm)]
+
+    xor ebx, ebx                    ; ebx = line
+
+row_loop1:
+    mov eax, ebx
+    and eax, 3
+    shl eax, 5
+    vmovdqu ymm7, [r10 + rax]       ; dither for this line
+    mov rax, rdi                    ; s8
+    mov r11, rdx                    ; d8
+
+    mov ebp, r8d                    ; ebp = width
+    shr ebp, 5                      ; doing 32 pixels at a time
+
+loop1:
+    vmovdqu ymm0, [rax]             ; 8 pixels, 32 bytes
+    vmovdqu ymm1, [rax + 32]        ; 8 pixels, 32 bytes
+    vmovdqu ymm2, [rax + 64]        ; 8 pixels, 32 bytes
+    vmovdqu ymm3, [rax + 96]        ; 8 pixels, 32 bytes
+    vpaddusb ymm0, ymm0, ymm7       ; dither
+    vpaddusb ymm1, ymm1, ymm7       ; dither
+    vpaddusb ymm2, ymm2, ymm7       ; dither
+    vpaddusb ymm3, ymm3, ymm7       ; dither
+
+    ; (r >> 5) | (g >> 5) << 3 | (b >> 6) << 6
+    vpsrld ymm4, ymm0, 10           ; green
+    vpand ymm4, ymm4, ymm9
+    vpsrld ymm5, ymm0, 21           ; red
+    vpand ymm5, ymm5, ymm10
+    vpand ymm0, ymm0, ymm8         ; blue
+    vpor ymm0, ymm0, ymm4
+    vpor ymm0, ymm0, ymm5
+    vpsrld ymm4, ymm1, 10           ; green
+    vpand ymm4, ymm4, ymm9
+    vpsrld ymm5, ymm1, 21           ; red
+    vpand ymm5, ymm5, ymm10
+    vpand ymm1, ymm1, ymm8         ; blue
+    vpor ymm1, ymm1, ymm4
+    vpor ymm1, ymm1, ymm5
+    vpsrld ymm4, ymm2, 10           ; green
+    vpand ymm4, ymm4, ymm9
+    vpsrld ymm5, ymm2, 21           ; red
+    vpand ymm5, ymm5, ymm10
+    vpand ymm2, ymm2, ymm8         ; blue
+    vpor ymm2, ymm2, ymm4
+    vpor ymm2, ymm2, ymm5
+    vpsrld ymm4, ymm3, 10           ; green
+    vpand ymm4, ymm4, ymm9
+    vpsrld ymm5, ymm3, 21           ; red
+    vpand ymm5, ymm5, ymm10
+    vpand ymm3, ymm3, ymm8         ; blue
+    vpor ymm3, ymm3, ymm4
+    vpor ymm3, ymm3, ymm5
+    vpackssdw ymm0, ymm0, ymm1
+    vpackssdw ymm2, ymm2, ymm3
+    vpackuswb ymm0, ymm0, ymm2      ; groups of 4 pixels out of order
+    vpermd ymm0, ymm11, ymm0        ; 0-31
+    vmovdqu [r11], ymm0             ; out 32 pixels, 32 bytes
+
+    ; move right
+    lea rax, [rax + 128]
+    lea r11, [r11 + 32]
+
+    dec ebp
+    jnz loop1
+
+    add rdi, rsi                    ; s8 += src_stride
+    add rdx, rcx                    ; d8 += dst_stride
+
+    inc ebx
+    cmp ebx, r9d
+    jl row_loop1
+
+    vzeroupper
+    mov rax, 0                      ; return value
+    pop rbp
+    pop rbx
+    ret
+END_OF_FILE
@@ -0,0 +1,140 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to RGB332
+;amd64 SSE2
+;
+; notes
+;   width must be multiple of 16 and > 0
+;   height must be > 0
+;   dither points to 4 rows of 8 pixels that repeat every 4 pixels, added
+;   to each pixel with unsigned saturation before the bits are dropped,
+;   row 0 is used for the first line, all zero for no dithering
+
+%include "common.asm"
+
+PREPARE_RODATA
+    cdb    times 4 dd 0xC0
+    cdg    times 4 dd 0x38
+    cdr    times 4 dd 0x07
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9, the seventh is on the stack
+
+;int
+;a8r8g8b8_to_r3g3b2_box_amd64_sse2(const uint8_t *s8, int src_stride,
+;                                  uint8_t *d8, int dst_stride,
+;                                  int width, int height,
+;                                  const uint8_t *dither);
+PROC a8r8g8b8_to_r3g3b2_box_amd64_sse2
+    push rbx
+    push rbp
+
+    movsxd rsi, esi                 ; src_stride
+    movsxd rcx, ecx                 ; dst_stride
+    mov r10, [rsp + 24]             ; dither
+
+    movdqa xmm8, [lsym(cdb)]
+    movdqa xmm9, [lsym(cdg)]
+    movdqa xmm10, [lsym(cdr)]
+
+    xor ebx, ebx                    ; ebx = line
+
+row_loop1:
+    mov eax, ebx
+    and eax, 3
+    shl eax, 5
+    movdqu xmm7, [r10 + rax]        ; dither for this line
+    mov rax, rdi                    ; s8
+    mov r11, rdx                    ; d8
+
+    mov ebp, r8d                    ; ebp = width
+    shr ebp, 4                      ; doing 16 pixels at a time
+
+loop1:
+    movdqu xmm0, [rax]              ; 4 pixels, 16 bytes
+    movdqu xmm1, [rax + 16]         ; 4 pixels, 16 bytes
+    movdqu xmm2, [rax + 32]         ; 4 pixels, 16 bytes
+    movdqu xmm3, [rax + 48]         ; 4 pixels, 16 bytes
+    paddusb xmm0, xmm7              ; dither
+    paddusb xmm1, xmm7              ; dither
+    paddusb xmm2, xmm7              ; dither
+    paddusb xmm3, xmm7              ; dither
+
+    ; (r >> 5) | (g >> 5) << 3 | (b >> 6) << 6
+    movdqa xmm4, xmm0              ; green
+    psrld xmm4, 10
+    pand xmm4, xmm9
+    movdqa xmm5, xmm0              ; red
+    psrld xmm5, 21
+    pand xmm5, xmm10
+    pand xmm0, xmm8                 ; blue
+    por xmm0, xmm4
+    por xmm0, xmm5
+    movdqa xmm4, xmm1              ; green
+    psrld xmm4, 10
+    pand xmm4, xmm9
+    movdqa xmm5, xmm1              ; red
+    psrld xmm5, 21
+    pand xmm5, xmm10
+    pand xmm1, xmm8                 ; blue
+    por xmm1, xmm4
+    por xmm1, xmm5
+    movdqa xmm4, xmm2              ; green
+    psrld xmm4, 10
+    pand xmm4, xmm9
+    movdqa xmm5, xmm2              ; red
+    psrld xmm5, 21
+    pand xmm5, xmm10
+    pand xmm2, xmm8                 ; blue
+    por xmm2, xmm4
+    por xmm2, xmm5
+    movdqa xmm4, xmm3              ; green
+    psrld xmm4, 10
+    pand xmm4, xmm9
+    movdqa xmm5, xmm3              ; red
+    psrld xmm5, 21
+    pand xmm5, xmm10
+    pand xmm3, xmm8                 ; blue
+    por xmm3, xmm4
+    por xmm3, xmm5
+    packssdw xmm0, xmm1
+    packssdw xmm2, xmm3
+    packuswb xmm0, xmm2
+    movdqu [r11], xmm0              ; out 16 pixels, 16 bytes
+
+    ; move right
+    lea rax, [rax + 64]
+    lea r11, [r11 + 16]
+
+    dec ebp
+    jnz loop1
+
+    add rdi, rsi                    ; s8 += src_stride
+    add rdx, rcx                    ; d8 += dst_stride
+
+    inc ebx
+    cmp ebx, r9d
+    jl row_loop1
+
+    mov rax, 0                      ; return value
+    pop rbp
+    pop rbx
+    ret
+END_OF_FILE
@@ -0,0 +1,123 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to RGB565
+;amd64 AVX2
+;
+; notes
+;   width must be multiple of 16 and > 0
+;   height must be > 0
+;   dither points to 4 rows of 8 pixels that repeat every 4 pixels, added
+;   to each pixel with unsigned saturation before the bits are dropped,
+;   row 0 is used for the first line, all zero for no dithering
+
+%include "common.asm"
+
+PREPARE_RODATA
+    align 32
+    cdb    times 8 dd 0x001F
+    cdg    times 8 dd 0x07E0
+    cdr    times 8 dd 0xF800
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9, the seventh is on the stack
+
+;int
+;a8r8g8b8_to_r5g6b5_box_amd64_avx2(const uint8_t *s8, int src_stride,
+;                                  uint8_t *d8, int dst_stride,
+;                                  int width, int height,
+;                                  const uint8_t *dither);
+PROC a8r8g8b8_to_r5g6b5_box_amd64_avx2
+    push rbx
+    push rbp
+
+    movsxd rsi, esi                 ; src_stride
+    movsxd rcx, ecx                 ; dst_stride
+    mov r10, [rsp + 24]             ; dither
+
+    vmovdqu ymm8, [lsym(cdb)]
+    vmovdqu ymm9, [lsym(cdg)]
+    vmovdqu ymm10, [lsym(cdr)]
+
+    xor ebx, ebx                    ; ebx = line
+
+row_loop1:
+    mov eax, ebx
+    and eax, 3
+    shl eax, 5
+    vmovdqu ymm7, [r10 + rax]       ; dither for this line
+    mov rax, rdi                    ; s8
+    mov r11, rdx                    ; d8
+
+    mov ebp, r8d                    ; ebp = width
+    shr ebp, 4                      ; doing 16 pixels at a time
+
+loop1:
+    vmovdqu ymm0, [rax]             ; 8 pixels, 32 bytes
+    vmovdqu ymm1, [rax + 32]        ; 8 pixels, 32 bytes
+    vpaddusb ymm0, ymm0, ymm7       ; dither
+    vpaddusb ymm1, ymm1, ymm7       ; dither
+
+    ; (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3)
+    vpsrld ymm2, ymm0, 3            ; blue
+    vpand ymm2, ymm2, ymm8
+    vpsrld ymm3, ymm0, 5            ; green
+    vpand ymm3, ymm3, ymm9
+    vpor ymm2, ymm2, ymm3
+    vpsrld ymm0, ymm0, 8            ; red
+    vpand ymm0, ymm0, ymm10
+    vpor ymm0, ymm0, ymm2
+    vpsrld ymm4, ymm1, 3            ; blue
+    vpand ymm4, ymm4, ymm8
+    vpsrld ymm5, ymm1, 5            ; green
+    vpand ymm5, ymm5, ymm9
+    vpor ymm4, ymm4, ymm5
+    vpsrld ymm1, ymm1, 8            ; red
+    vpand ymm1, ymm1, ymm10
+    vpor ymm1, ymm1, ymm4
+
+    ; sign extend the low words so the signed pack keeps all 16 bits
+    vpslld ymm0, ymm0, 16
+    vpsrad ymm0, ymm0, 16
+    vpslld ymm1, ymm1, 16
+    vpsrad ymm1, ymm1, 16
+    vpackssdw ymm0, ymm0, ymm1      ; 0-3 8-11 4-7 12-15
+    vpermq ymm0, ymm0, 0xD8         ; 0-15
+    vmovdqu [r11], ymm0             ; out 16 pixels, 32 bytes
+
+    ; move right
+    lea rax, [rax + 64]
+    lea r11, [r11 + 32]
+
+    dec ebp
+    jnz loop1
+
+    add rdi, rsi                    ; s8 += src_stride
+    add rdx, rcx                    ; d8 += dst_stride
+
+    inc ebx
+    cmp ebx, r9d
+    jl row_loop1
+
+    vzeroupper
+    mov rax, 0                      ; return value
+    pop rbp
+    pop rbx
+    ret
+END_OF_FILE
@@ -0,0 +1,197 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to YUVALP and hash the source
+;amd64 AVX2
+;
+; notes
+;   same as a8r8g8b8_to_yuvalp_hash_box in rdpCapture.c, the hash lanes
+;   are in ymm8
+;   same arithmetic as the SSE2 version, 16 pixels at a time
+;   width must be multiple of 16 and > 0
+;   height must be > 0
+
+%include "common.asm"
+
+PREPARE_RODATA
+    align 32
+    cd255  times 8 dd 255
+    cw128  times 16 dw 128
+    cw77   times 16 dw 77
+    cw150  times 16 dw 150
+    cw29   times 16 dw 29
+    cw43   times 16 dw 43
+    cw85   times 16 dw 85
+    cw107  times 16 dw 107
+    cw21   times 16 dw 21
+    ; same as g_hash_keys in rdpCapture.c
+    hash_keys dq 0x9a133c88d1995dc2, 0x00f07b931b31ab50, 0x5d560270c4901989, 0x1ff2aef408e56d42
+              dq 0xee1b9b2c46734a79, 0x052faf5ee692b27d, 0x92a6d0e507329f29, 0x3058050576a063b3
+              dq 0x62aeb4051e876e2c, 0x27a0b27c273f0be1, 0x80c9ca84c046d56b, 0xe56d5023c6a24870
+              dq 0x36fd656a5e4afa1c, 0x05152f8ddf73a080, 0x3849b2c4ac0924b0, 0xbc7dc794922aff6b
+              dq 0xe7935bbafb62f14c, 0x598e82d1b84bcc62, 0x4ba06a9721675b02, 0xcd777269860ff52e
+              dq 0x3b9990099d17f11e, 0xec2e2951728779be, 0xaaf809f43d4093a8, 0x7fbf1213e430e2d2
+              dq 0x6d4cf05faa8f915e, 0x273dfb4c9b05a521, 0x8ad9b5f5013e51f9, 0x6789b14e3ed1c5bb
+              dq 0xcc98ef25636182b5, 0x0dd9567e3b30e778, 0x2b8980b1abff74fb, 0xa7604a688d325ce5
+    cq_rowkey times 4 dq 0x6d35dc34908cc9c1
+    cq_prime  times 4 dq 0x9e3779b1
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;The seventh is on the stack
+
+;int
+;a8r8g8b8_to_yuvalp_hash_box_amd64_avx2(const uint8_t *s8, int src_stride,
+;                                       uint8_t *d8, int dst_stride,
+;                                       int width, int height,
+;                                       uint64_t *hash);
+PROC a8r8g8b8_to_yuvalp_hash_box_amd64_avx2
+    push rbx
+    push rbp
+    push r12
+
+    mov rbp, [rsp + 32]             ; hash
+    vmovdqu ymm8, [rbp]             ; hash lanes 0 - 3
+    vmovdqu ymm11, [lsym(cq_prime)]
+    vmovdqu ymm12, [lsym(cq_rowkey)]
+
+    movsxd rsi, esi                 ; src_stride
+    movsxd rcx, ecx                 ; dst_stride
+    mov r10, rdi                    ; s8
+    mov r11, rdx                    ; d8
+    lea rdi, [lsym(hash_keys)]
+
+    vmovdqu ymm15, [lsym(cd255)]
+    vmovdqu ymm14, [lsym(cw128)]
+
+    mov ebx, r9d                    ; ebx = height
+
+row_loop1:
+    mov rax, r10                    ; s8
+    mov rdx, r11                    ; d8
+    xor r12d, r12d                  ; key offset
+
+    mov r9d, r8d                    ; r9d = width
+    shr r9d, 4                      ; doing 16 pixels at a time
+
+loop1:
+    vmovdqu ymm0, [rax]             ; 8 pixels, 32 bytes
+    vmovdqu ymm5, [rax + 32]        ; 8 pixels, 32 bytes
+    ; hash += word + lo32(word ^ key) * hi32(word ^ key)
+    vpxor ymm9, ymm0, [rdi + r12]
+    vpshufd ymm10, ymm9, 0xF5
+    vpmuludq ymm9, ymm9, ymm10
+    vpaddq ymm8, ymm8, ymm0
+    vpaddq ymm8, ymm8, ymm9
+    vpxor ymm9, ymm5, [rdi + r12 + 32]
+    vpshufd ymm10, ymm9, 0xF5
+    vpmuludq ymm9, ymm9, ymm10
+    vpaddq ymm8, ymm8, ymm5
+    vpaddq ymm8, ymm8, ymm9
+    add r12d, 64
+    and r12d, 255                   ; 32 keys
+    ; reorder so the in lane packs below keep the pixels in order
+    vperm2i128 ymm6, ymm0, ymm5, 0x20 ; pixels 0 - 3, 8 - 11
+    vperm2i128 ymm7, ymm0, ymm5, 0x31 ; pixels 4 - 7, 12 - 15
+
+    vpand ymm1, ymm6, ymm15         ; blue
+    vpand ymm0, ymm7, ymm15         ; blue
+    vpackssdw ymm1, ymm1, ymm0      ; ymm1 = 16 blues
+    vpsrld ymm2, ymm6, 8            ; green
+    vpand ymm2, ymm2, ymm15         ; green
+    vpsrld ymm0, ymm7, 8            ; green
+    vpand ymm0, ymm0, ymm15         ; green
+    vpackssdw ymm2, ymm2, ymm0      ; ymm2 = 16 greens
+    vpsrld ymm3, ymm6, 16           ; red
+    vpand ymm3, ymm3, ymm15         ; red
+    vpsrld ymm0, ymm7, 16           ; red
+    vpand ymm0, ymm0, ymm15         ; red
+    vpackssdw ymm3, ymm3, ymm0      ; ymm3 = 16 reds
+    vpsrld ymm4, ymm6, 24           ; alpha
+    vpsrld ymm0, ymm7, 24           ; alpha
+    vpackssdw ymm4, ymm4, ymm0      ; ymm4 = 16 alphas
+
+    ; _Y = (77 * _R + 150 * _G + 29 * _B) >> 8;
+    vpmullw ymm5, ymm1, [lsym(cw29)]
+    vpmullw ymm0, ymm2, [lsym(cw150)]
+    vpaddw ymm5, ymm5, ymm0
+    vpmullw ymm0, ymm3, [lsym(cw77)]
+    vpaddw ymm5, ymm5, ymm0
+    vpsrlw ymm5, ymm5, 8            ; ymm5 = 16 Ys
+
+    ; _U = ((-43 * _R - 85 * _G + 128 * _B) >> 8) + 128;
+    vpmullw ymm6, ymm1, ymm14
+    vpmullw ymm0, ymm2, [lsym(cw85)]
+    vpsubw ymm6, ymm6, ymm0
+    vpmullw ymm0, ymm3, [lsym(cw43)]
+    vpsubw ymm6, ymm6, ymm0
+    vpsraw ymm6, ymm6, 8
+    vpaddw ymm6, ymm6, ymm14        ; ymm6 = 16 Us
+
+    ; _V = ((128 * _R - 107 * _G -  21 * _B) >> 8) + 128;
+    vpmullw ymm7, ymm3, ymm14
+    vpmullw ymm0, ymm2, [lsym(cw107)]
+    vpsubw ymm7, ymm7, ymm0
+    vpmullw ymm0, ymm1, [lsym(cw21)]
+    vpsubw ymm7, ymm7, ymm0
+    vpsraw ymm7, ymm7, 8
+    vpaddw ymm7, ymm7, ymm14        ; ymm7 = 16 Vs
+
+    vpackuswb ymm5, ymm5, ymm6      ; y0-7 u0-7 y8-15 u8-15
+    vpermq ymm5, ymm5, 0xD8         ; y0-15 u0-15
+    vpackuswb ymm7, ymm7, ymm4      ; v0-7 a0-7 v8-15 a8-15
+    vpermq ymm7, ymm7, 0xD8         ; v0-15 a0-15
+    vmovdqu [rdx], xmm5             ; out 16 bytes yyyyyyyyyyyyyyyy
+    vextracti128 [rdx + 1 * 64 * 64], ymm5, 1 ; out 16 bytes uuuu...
+    vmovdqu [rdx + 2 * 64 * 64], xmm7 ; out 16 bytes vvvv...
+    vextracti128 [rdx + 3 * 64 * 64], ymm7, 1 ; out 16 bytes aaaa...
+
+    ; move right
+    lea rax, [rax + 64]
+    lea rdx, [rdx + 16]
+
+    dec r9d
+    jnz loop1
+
+    ; hash ^= hash >> 47; hash ^= row key; hash *= prime
+    vpsrlq ymm9, ymm8, 47
+    vpxor ymm8, ymm8, ymm9
+    vpxor ymm8, ymm8, ymm12
+    vpsrlq ymm9, ymm8, 32
+    vpmuludq ymm8, ymm8, ymm11
+    vpmuludq ymm9, ymm9, ymm11
+    vpsllq ymm9, ymm9, 32
+    vpaddq ymm8, ymm8, ymm9
+
+    add r10, rsi                    ; s8 += src_stride
+    add r11, rcx                    ; d8 += dst_stride
+
+    dec ebx
+    jnz row_loop1
+
+    vmovdqu [rbp], ymm8
+
+    vzeroupper
+    mov rax, 0                      ; return value
+    pop r12
+    pop rbp
+    pop rbx
+    ret
+END_OF_FILE
@@ -0,0 +1,242 @@
+;
+;Copyright 2024 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to YUVALP and hash the source
+;amd64 SSE2
+;
+; notes
+;   same as a8r8g8b8_to_yuvalp_hash_box in rdpCapture.c, the hash lanes
+;   are in xmm8 (0, 1) and xmm9 (2, 3)
+;   address s8 should be aligned on 16 bytes, will be slower if not
+;   width must be multiple of 8 and > 0
+;   height must be > 0
+
+%include "common.asm"
+
+PREPARE_RODATA
+    cd255  times 4 dd 255
+    cw128  times 8 dw 128
+    cw77   times 8 dw 77
+    cw150  times 8 dw 150
+    cw29   times 8 dw 29
+    cw43   times 8 dw 43
+    cw85   times 8 dw 85
+    cw107  times 8 dw 107
+    cw21   times 8 dw 21
+    ; same as g_hash_keys in rdpCapture.c
+    hash_keys dq 0x9a133c88d1995dc2, 0x00f07b931b31ab50, 0x5d560270c4901989, 0x1ff2aef408e56d42
+              dq 0xee1b9b2c46734a79, 0x052faf5ee692b27d, 0x92a6d0e507329f29, 0x3058050576a063b3
+              dq 0x62aeb4051e876e2c, 0x27a0b27c273f0be1, 0x80c9ca84c046d56b, 0xe56d5023c6a24870
+              dq 0x36fd656a5e4afa1c, 0x05152f8ddf73a080, 0x3849b2c4ac0924b0, 0xbc7dc794922aff6b
+              dq 0xe7935bbafb62f14c, 0x598e82d1b84bcc62, 0x4ba06a9721675b02, 0xcd777269860ff52e
+              dq 0x3b9990099d17f11e, 0xec2e2951728779be, 0xaaf809f43d4093a8, 0x7fbf1213e430e2d2
+              dq 0x6d4cf05faa8f915e, 0x273dfb4c9b05a521, 0x8ad9b5f5013e51f9, 0x6789b14e3ed1c5bb
+              dq 0xcc98ef25636182b5, 0x0dd9567e3b30e778, 0x2b8980b1abff74fb, 0xa7604a688d325ce5
+    cq_rowkey times 2 dq 0x6d35dc34908cc9c1
+    cq_prime  times 2 dq 0x9e3779b1
+
+%define LS8            [rsp +   0] ; s8
+%define LSRC_STRIDE    [rsp +   8] ; src_stride
+%define LD8            [rsp +  16] ; d8
+%define LDST_STRIDE    [rsp +  24] ; dst_stride
+%define LWIDTH         [rsp +  32] ; width
+%define LHEIGHT        [rsp +  40] ; height
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;The seventh is on the stack
+
+;int
+;a8r8g8b8_to_yuvalp_hash_box_amd64_sse2(const uint8_t *s8, int src_stride,
+;                                       uint8_t *d8, int dst_stride,
+;                                       int width, int height,
+;                                       uint64_t *hash);
+PROC a8r8g8b8_to_yuvalp_hash_box_amd64_sse2
+    push rbx
+    push rbp
+    sub rsp, 48                 ; local vars, 48 bytes
+
+    mov LS8, rdi                ; s8
+    mov LSRC_STRIDE, rsi        ; src_stride
+    mov LD8, rdx                ; d8
+    mov LDST_STRIDE, rcx        ; dst_stride
+    mov LWIDTH, r8              ; width
+    mov LHEIGHT, r9             ; height
+
+    mov r10, [rsp + 72]         ; hash
+    movdqu xmm8, [r10]          ; hash lanes 0, 1
+    movdqu xmm9, [r10 + 16]     ; hash lanes 2, 3
+    movdqa xmm15, [lsym(cq_prime)]
+    lea r11, [lsym(hash_keys)]
+
+    pxor xmm7, xmm7
+
+    mov ebx, LHEIGHT            ; ebx = height
+
+row_loop1:
+    mov rsi, LS8                ; s8
+    mov rdi, LD8                ; d8
+    xor r9d, r9d                ; key offset
+
+    mov ecx, LWIDTH             ; ecx = width
+    shr ecx, 3                  ; doing 8 pixels at a time
+
+loop1:
+    movdqu xmm0, [rsi]          ; 4 pixels, 16 bytes
+    ; hash += word + lo32(word ^ key) * hi32(word ^ key)
+    movdqa xmm10, xmm0
+    pxor xmm10, [r11 + r9]
+    pshufd xmm11, xmm10, 0xF5
+    pmuludq xmm10, xmm11
+    paddq xmm8, xmm0
+    paddq xmm8, xmm10
+    movdqa xmm1, xmm0           ; blue
+    pand xmm1, [lsym(cd255)]    ; blue
+    movdqa xmm2, xmm0           ; green
+    psrld xmm2, 8               ; green
+    pand xmm2, [lsym(cd255)]    ; green
+    movdqa xmm3, xmm0           ; red
+    psrld xmm3, 16              ; red
+    pand xmm3, [lsym(cd255)]    ; red
+    movdqa xmm4, xmm0           ; alpha
+    psrld xmm4, 24              ; alpha
+    pand xmm4, [lsym(cd255)]    ; alpha
+
+    movdqu xmm0, [rsi + 16]     ; 4 pixels, 16 bytes
+    movdqa xmm10, xmm0
+    pxor xmm10, [r11 + r9 + 16]
+    pshufd xmm11, xmm10, 0xF5
+    pmuludq xmm10, xmm11
+    paddq xmm9, xmm0
+    paddq xmm9, xmm10
+    add r9d, 32
+    and r9d, 255                ; 32 keys
+    movdqa xmm5, xmm0           ; alpha
+    psrld xmm5, 24              ; alpha
+    pand xmm5, [lsym(cd255)]    ; alpha
+    packssdw xmm4, xmm5         ; xmm4 = 8 alphas
+    packuswb xmm4, xmm7
+    movq [rdi + 3 * 64 * 64], xmm4  ; out 8 bytes aaaaaaaa
+    movdqa xmm4, xmm0           ; blue
+    pand xmm4, [lsym(cd255)]    ; blue
+    movdqa xmm5, xmm0           ; green
+    psrld xmm5, 8               ; green
+    pand xmm5, [lsym(cd255)]    ; green
+    movdqa xmm6, xmm0           ; red
+    psrld xmm6, 16              ; red
+    pand xmm6, [lsym(cd255)]    ; red
+
+    packssdw xmm1, xmm4         ; xmm1 = 8 blues
+    packssdw xmm2, xmm5         ; xmm2 = 8 greens
+    packssdw xmm3, xmm6         ; xmm3 = 8 reds
+
+    ; _Y = (77 * _R + 150 * _G + 29 * _B) >> 8;
+    movdqa xmm4, xmm1           ; blue
+    movdqa xmm5, xmm2           ; green
+    movdqa xmm6, xmm3           ; red
+    pmullw xmm4, [lsym(cw29)]
+    pmullw xmm5, [lsym(cw150)]
+    pmullw xmm6, [lsym(cw77)]
+    paddw xmm4, xmm5
+    paddw xmm4, xmm6
+    psrlw xmm4, 8
+    packuswb xmm4, xmm7
+    movq [rdi], xmm4            ; out 8 bytes yyyyyyyy
+
+    ; _U = ((-43 * _R - 85 * _G + 128 * _B) >> 8) + 128;
+    movdqa xmm4, xmm1           ; blue
+    movdqa xmm5, xmm2           ; green
+    movdqa xmm6, xmm3           ; red
+    pmullw xmm4, [lsym(cw128)]
+    pmullw xmm5, [lsym(cw85)]
+    pmullw xmm6, [lsym(cw43)]
+    psubw xmm4, xmm5
+    psubw xmm4, xmm6
+    psraw xmm4, 8
+    paddw xmm4, [lsym(cw128)]
+    packuswb xmm4, xmm7
+    movq [rdi + 1 * 64 * 64], xmm4  ; out 8 bytes uuuuuuuu
+
+    ; _V = ((128 * _R - 107 * _G -  21 * _B) >> 8) + 128;
+    movdqa xmm6, xmm1           ; blue
+    movdqa xmm5, xmm2           ; green
+    movdqa xmm4, xmm3           ; red
+    pmullw xmm4, [lsym(cw128)]
+    pmullw xmm5, [lsym(cw107)]
+    pmullw xmm6, [lsym(cw21)]
+    psubw xmm4, xmm5
+    psubw xmm4, xmm6
+    psraw xmm4, 8
+    paddw xmm4, [lsym(cw128)]
+    packuswb xmm4, xmm7
+    movq [rdi + 2 * 64 * 64], xmm4  ; out 8 bytes vvvvvvvv
+
+    ; move right
+    lea rsi, [rsi + 32]
+    lea rdi, [rdi + 8]
+
+    dec ecx
+    jnz loop1
+
+    ; hash ^= hash >> 47; hash ^= row key; hash *= prime
+    movdqa xmm10, xmm8
+    psrlq xmm10, 47
+    pxor xmm8, xmm10
+    pxor xmm8, [lsym(cq_rowkey)]
+    movdqa xmm10, xmm8
+    psrlq xmm10, 32
+    pmuludq xmm8, xmm15
+    pmuludq xmm10, xmm15
+    psllq xmm10, 32
+    paddq xmm8, xmm10
+    movdqa xmm10, xmm9
+    psrlq xmm10, 47
+    pxor xmm9, xmm10
+    pxor xmm9, [lsym(cq_rowkey)]
+    movdqa xmm10, xmm9
+    psrlq xmm10, 32
+    pmuludq xmm9, xmm15
+    pmuludq xmm10, xmm15
+    psllq xmm10, 32
+    paddq xmm9, xmm10
+
+    ; update s8
+    mov rax, LS8                ; s8
+    add rax, LSRC_STRIDE        ; s8 += src_stride
+    mov LS8, rax
+
+    ; update d8
+    mov rax, LD8                ; d8
+    add rax, LDST_STRIDE        ; d8 += dst_stride
+    mov LD8, rax
+
+    dec ebx
+    jnz row_loop1
+
+    mov r10, [rsp + 72]         ; hash
+    movdqu [r10], xmm8
+    movdqu [r10 + 16], xmm9
+
+    mov rax, 0                  ; return value
+    add rsp, 48                 ; local vars, 48 bytes
+    pop rbp
+    pop rbx
+    ret
+END_OF_FILE
@@ -53,4 +53,16 @@ PROC cpuid_amd64
     ; restore registers
     pop rbx
     ret
+
+;int
+;xgetbv_amd64(int ecx_in, int *eax, int *edx)
+
+PROC xgetbv_amd64
+    mov r8, rdx
+    mov ecx, edi
+    xgetbv
+    mov [rsi], eax
+    mov [r8], edx
+    mov eax, 0
+    ret
 END_OF_FILE
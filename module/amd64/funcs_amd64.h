@@ -27,6 +27,8 @@ amd64 asm functions
 int
 cpuid_amd64(int eax_in, int ecx_in, int *eax, int *ebx, int *ecx, int *edx);
 int
+xgetbv_amd64(int ecx_in, int *eax, int *edx);
+int
 yv12_to_rgb32_amd64_sse2(const uint8_t *yuvs, int width, int height, int *rgbs);
 int
 i420_to_rgb32_amd64_sse2(const uint8_t *yuvs, int width, int height, int *rgbs);
@@ -52,6 +54,70 @@ int
 a8r8g8b8_to_yuvalp_box_amd64_sse2(const uint8_t *s8, int src_stride,
                                   uint8_t *d8, int dst_stride,
                                   int width, int height);
+int
+a8r8g8b8_to_a8b8g8r8_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                    uint8_t *d8, int dst_stride,
+                                    int width, int height);
+int
+a8r8g8b8_to_nv12_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                uint8_t *d8_y, int dst_stride_y,
+                                uint8_t *d8_uv, int dst_stride_uv,
+                                int width, int height);
+int
+a8r8g8b8_to_nv12_709fr_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                      uint8_t *d8_y, int dst_stride_y,
+                                      uint8_t *d8_uv, int dst_stride_uv,
+                                      int width, int height);
+int
+a8r8g8b8_to_yuvalp_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                  uint8_t *d8, int dst_stride,
+                                  int width, int height);
+int
+a8r8g8b8_to_r5g6b5_box_amd64_sse2(const uint8_t *s8, int src_stride,
+                                  uint8_t *d8, int dst_stride,
+                                  int width, int height,
+                                  const uint8_t *dither);
+int
+a8r8g8b8_to_r5g6b5_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                  uint8_t *d8, int dst_stride,
+                                  int width, int height,
+                                  const uint8_t *dither);
+int
+a8r8g8b8_to_a1r5g5b5_box_amd64_sse2(const uint8_t *s8, int src_stride,
+                                    uint8_t *d8, int dst_stride,
+                                    int width, int height,
+                                    const uint8_t *dither);
+int
+a8r8g8b8_to_a1r5g5b5_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                    uint8_t *d8, int dst_stride,
+                                    int width, int height,
+                                    const uint8_t *dither);
+int
+a8r8g8b8_to_r3g3b2_box_amd64_sse2(const uint8_t *s8, int src_stride,
+                                  uint8_t *d8, int dst_stride,
+                                  int width, int height,
+                                  const uint8_t *dither);
+int
+a8r8g8b8_to_r3g3b2_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                  uint8_t *d8, int dst_stride,
+                                  int width, int height,
+                                  const uint8_t *dither);
+int
+a8r8g8b8_to_yuvalp_hash_box_amd64_sse2(const uint8_t *s8, int src_stride,
+                                       uint8_t *d8, int dst_stride,
+                                       int width, int height,
+                                       uint64_t *hash);
+int
+a8r8g8b8_to_yuvalp_hash_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                                       uint8_t *d8, int dst_stride,
+                                       int width, int height,
+                                       uint64_t *hash);
+int
+a8r8g8b8_solid_box_amd64_sse2(const uint8_t *s8, int src_stride,
+                              int width, int height, uint32_t *pixel);
+int
+a8r8g8b8_solid_box_amd64_avx2(const uint8_t *s8, int src_stride,
+                              int width, int height, uint32_t *pixel);
 
 #endif
 
@@ -43,8 +43,6 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define XRDP_KEYB_NAME "XRDPKEYB"
 #define XRDP_VERSION 1000
 
-#define RDP_MAX_TILES 4096
-
 #define COLOR8(r, g, b) \
     ((((r) >> 5) << 0)  | (((g) >> 5) << 3) | (((b) >> 6) << 6))
 #define COLOR15(r, g, b) \
@@ -108,6 +106,7 @@ struct image_data
     uint8_t *pixels;
     uint8_t *shmem_pixels;
     int shmem_fd;
+    int shmem_id; /* registered buffer id or -1 to send shmem_fd */
     int shmem_bytes;
     int shmem_offset;
     int shmem_lineBytes;
@@ -204,6 +203,13 @@ struct _rdpCounts
     CARD32 callCount[64 - 25];
 };
 
+struct rdp_op_prof
+{
+    uint64_t calls;
+    uint64_t wrap_ns; /* wrapper bookkeeping, the original op not counted */
+    uint64_t org_ns; /* the wrapped fb or glamor op */
+};
+
 typedef int (*yuv_to_rgb32_proc)(const uint8_t *yuvs, int width, int height, int *rgbs);
 
 typedef int (*copy_box_proc)(const uint8_t *s8, int src_stride,
@@ -214,6 +220,19 @@ typedef int (*copy_box_dst2_proc)(const uint8_t *s8, int src_stride,
                                   uint8_t *d8_y, int dst_stride_y,
                                   uint8_t *d8_uv, int dst_stride_uv,
                                   int width, int height);
+/* copy_box_proc with ordered dither, see rdpGetDither */
+typedef int (*copy_box_dither_proc)(const uint8_t *s8, int src_stride,
+                                    uint8_t *d8, int dst_stride,
+                                    int width, int height,
+                                    const uint8_t *dither);
+/* copy_box_proc that also hashes the source into a 4 lane state,
+   see a8r8g8b8_to_yuvalp_hash_box */
+typedef int (*copy_box_hash_proc)(const uint8_t *s8, int src_stride,
+                                  uint8_t *d8, int dst_stride,
+                                  int width, int height, uint64_t *hash);
+/* returns 1 if the box is one colour, see a8r8g8b8_solid_box */
+typedef int (*solid_box_proc)(const uint8_t *s8, int src_stride,
+                              int width, int height, uint32_t *pixel);
 
 /* move this to common header */
 struct _rdpRec
@@ -252,6 +271,13 @@ struct _rdpRec
     rdpPointer pointer;
     /* keyboard */
     rdpKeyboard keyboard;
+    /* absolute motion held back to merge with the next one, see
+       rdpInputFlush */
+    int coalesce_motion; /* boolean */
+    int input_thread; /* boolean, read xrdp on the server's input thread */
+    int motion_pending; /* boolean */
+    long motion_x;
+    long motion_y;
 
     /* RandR */
     RRSetConfigProcPtr rrSetConfig;
@@ -272,6 +298,9 @@ struct _rdpRec
     char uds_data[256];
     int disconnect_sck;
     char disconnect_uds[256];
+    /* stats queries, the listener belongs to the current client */
+    int control_stats; /* boolean */
+    char control_uds[256];
     rdpClientCon *clientConHead;
     rdpClientCon *clientConTail;
 
@@ -291,10 +320,15 @@ struct _rdpRec
     int idle_disconnect_timeout_s;
     CARD32 last_event_time_ms;
     CARD32 last_wheel_time_ms;
+    /* last key or button, damage soon after skips the frame pacing */
+    CARD32 last_input_time_ms;
 
     int conNumber;
 
     struct _rdpCounts counts;
+    /* per op costs, slots match counts, see RDP_PROF_BEGIN */
+    int profile_ops; /* boolean */
+    struct rdp_op_prof op_prof[64];
 
     yuv_to_rgb32_proc i420_to_rgb32;
     yuv_to_rgb32_proc yv12_to_rgb32;
@@ -309,6 +343,33 @@ struct _rdpRec
     copy_box_dst2_proc a8r8g8b8_to_nv12_box;
     copy_box_dst2_proc a8r8g8b8_to_nv12_709fr_box;
     copy_box_proc a8r8g8b8_to_yuvalp_box;
+    copy_box_hash_proc a8r8g8b8_to_yuvalp_hash_box;
+    solid_box_proc a8r8g8b8_solid_box;
+    copy_box_dither_proc a8r8g8b8_to_r5g6b5_box;
+    copy_box_dither_proc a8r8g8b8_to_a1r5g5b5_box;
+    copy_box_dither_proc a8r8g8b8_to_r3g3b2_box;
+    int low_bpp_dither; /* boolean */
+
+    /* capture worker threads, struct rdp_workers */
+    void *capture_workers;
+    int capture_threads;
+    /* frames that can be in flight, one shared memory buffer each,
+       0 picks a depth from what xrdp supports */
+    int shm_buffers;
+    /* client cache slots for GfxPro tiles, 0 is off */
+    int tile_cache_slots;
+    /* GfxPro screen copies, from the copy hints and found by the
+       capture, booleans */
+    int screen_copy;
+    int scroll_detect;
+    /* tiles of one colour not converted, GfxPro sends them as solid
+       fills, boolean */
+    int solid_fill;
+    /* frame rate range for the adaptive pacing */
+    int min_fps;
+    int max_fps;
+    /* ms after input that damage is sent without waiting, 0 is off */
+    int input_boost_ms;
 
     /* multimon */
     struct monitor_info minfo[16]; /* client monitor data */
@@ -45,11 +45,41 @@ capture
 #include "rdpReg.h"
 #include "rdpMisc.h"
 #include "rdpCapture.h"
+#include "rdpWorker.h"
+#include "rdpTileCache.h"
 
 #include "wyhash.h"
 /* hex digits of pi as a 64 bit int */
 #define WYHASH_SEED 0x3243f6a8885a308dull
 
+/* per word keys and row scramble for the a8r8g8b8_to_yuvalp_hash_box
+   lanes, the amd64 asm has a copy of these */
+static const uint64_t g_hash_keys[32] =
+{
+    0x9a133c88d1995dc2ull, 0x00f07b931b31ab50ull,
+    0x5d560270c4901989ull, 0x1ff2aef408e56d42ull,
+    0xee1b9b2c46734a79ull, 0x052faf5ee692b27dull,
+    0x92a6d0e507329f29ull, 0x3058050576a063b3ull,
+    0x62aeb4051e876e2cull, 0x27a0b27c273f0be1ull,
+    0x80c9ca84c046d56bull, 0xe56d5023c6a24870ull,
+    0x36fd656a5e4afa1cull, 0x05152f8ddf73a080ull,
+    0x3849b2c4ac0924b0ull, 0xbc7dc794922aff6bull,
+    0xe7935bbafb62f14cull, 0x598e82d1b84bcc62ull,
+    0x4ba06a9721675b02ull, 0xcd777269860ff52eull,
+    0x3b9990099d17f11eull, 0xec2e2951728779beull,
+    0xaaf809f43d4093a8ull, 0x7fbf1213e430e2d2ull,
+    0x6d4cf05faa8f915eull, 0x273dfb4c9b05a521ull,
+    0x8ad9b5f5013e51f9ull, 0x6789b14e3ed1c5bbull,
+    0xcc98ef25636182b5ull, 0x0dd9567e3b30e778ull,
+    0x2b8980b1abff74fbull, 0xa7604a688d325ce5ull
+};
+#define RDP_HASH_ROW_KEY 0x6d35dc34908cc9c1ull
+#define RDP_HASH_PRIME32 0x9e3779b1ull
+
+/* most rects the SufA16 and H.264 captures send after skipping unchanged
+   blocks */
+#define RDP_MAX_BLOCK_RECTS 64
+
 #if defined(XORGXRDP_GLAMOR)
 #include "rdpEgl.h"
 #include <glamor.h>
@@ -121,9 +151,10 @@ rdpFillBox_yuvalp(int ax, int ay,
    y = r *  0.299000 + g *  0.587000 + b *  0.114000;
    u = r * -0.168935 + g * -0.331665 + b *  0.500590;
    v = r *  0.499813 + g * -0.418531 + b * -0.081282; */
-/* 19595  38470   7471
-  -11071 -21736  32807
-   32756 -27429  -5327 */
+/* 77   150    29
+  -43   -85   128
+   128 -107   -21
+ * 8 bit fixed point, the same as the SIMD versions so all match exactly */
 int
 a8r8g8b8_to_yuvalp_box(const uint8_t *s8, int src_stride,
                        uint8_t *d8, int dst_stride,
@@ -157,9 +188,9 @@ a8r8g8b8_to_yuvalp_box(const uint8_t *s8, int src_stride,
         {
             pixel = *(s32++);
             RGB_SPLIT(a, r, g, b, pixel);
-            y = (r *  19595 + g *  38470 + b *   7471) >> 16;
-            u = (r * -11071 + g * -21736 + b *  32807) >> 16;
-            v = (r *  32756 + g * -27429 + b *  -5327) >> 16;
+            y = (r *  77 + g *  150 + b *  29) >> 8;
+            u = (r * -43 + g *  -85 + b * 128) >> 8;
+            v = (r * 128 + g * -107 + b * -21) >> 8;
             u = u + 128;
             v = v + 128;
             y = RDPCLAMP(y, 0, UCHAR_MAX);
@@ -178,11 +209,150 @@ a8r8g8b8_to_yuvalp_box(const uint8_t *s8, int src_stride,
 }
 
 /******************************************************************************/
+/* a8r8g8b8_to_yuvalp_box that also hashes the source pixels
+ * each pair of pixels is one 64 bit word, word k of a row is mixed with
+ * g_hash_keys[k % 32] and added to hash[k % 4], the lanes are scrambled
+ * at the end of each row, the SIMD versions must match this exactly
+ * hash is the state from rdpCaptureHashInit */
+int
+a8r8g8b8_to_yuvalp_hash_box(const uint8_t *s8, int src_stride,
+                            uint8_t *d8, int dst_stride,
+                            int width, int height, uint64_t *hash)
+{
+    uint8_t *yptr;
+    uint8_t *uptr;
+    uint8_t *vptr;
+    uint8_t *aptr;
+    const uint32_t *s32;
+    int jndex;
+    int kndex;
+    int lndex;
+    uint32_t pixel;
+    uint64_t word;
+    uint64_t mixed;
+    uint8_t a;
+    int r;
+    int g;
+    int b;
+    int y;
+    int u;
+    int v;
+
+    for (jndex = 0; jndex < height; jndex++)
+    {
+        s32 = (const uint32_t *) s8;
+        yptr = d8;
+        uptr = yptr + 64 * 64;
+        vptr = uptr + 64 * 64;
+        aptr = vptr + 64 * 64;
+        kndex = 0;
+        while (kndex < width)
+        {
+            pixel = s32[kndex];
+            if ((kndex & 1) == 0)
+            {
+                word = pixel;
+                if (kndex + 1 < width)
+                {
+                    word |= ((uint64_t) s32[kndex + 1]) << 32;
+                }
+                lndex = kndex >> 1;
+                mixed = word ^ g_hash_keys[lndex & 31];
+                hash[lndex & 3] += word + (mixed & 0xFFFFFFFF) * (mixed >> 32);
+            }
+            RGB_SPLIT(a, r, g, b, pixel);
+            y = (r *  77 + g *  150 + b *  29) >> 8;
+            u = (r * -43 + g *  -85 + b * 128) >> 8;
+            v = (r * 128 + g * -107 + b * -21) >> 8;
+            u = u + 128;
+            v = v + 128;
+            y = RDPCLAMP(y, 0, UCHAR_MAX);
+            u = RDPCLAMP(u, 0, UCHAR_MAX);
+            v = RDPCLAMP(v, 0, UCHAR_MAX);
+            *(yptr++) = y;
+            *(uptr++) = u;
+            *(vptr++) = v;
+            *(aptr++) = a;
+            kndex++;
+        }
+        for (lndex = 0; lndex < 4; lndex++)
+        {
+            hash[lndex] ^= hash[lndex] >> 47;
+            hash[lndex] ^= RDP_HASH_ROW_KEY;
+            hash[lndex] *= RDP_HASH_PRIME32;
+        }
+        d8 += dst_stride;
+        s8 += src_stride;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* returns 1 if every pixel in the box is the same, all 32 bits, 0 if not
+ * pixel is set to the first pixel either way */
+int
+a8r8g8b8_solid_box(const uint8_t *s8, int src_stride,
+                   int width, int height, uint32_t *pixel)
+{
+    const uint32_t *s32;
+    uint32_t first;
+    int index;
+    int jndex;
+
+    first = *((const uint32_t *) s8);
+    *pixel = first;
+    for (index = 0; index < height; index++)
+    {
+        s32 = (const uint32_t *) s8;
+        for (jndex = 0; jndex < width; jndex++)
+        {
+            if (s32[jndex] != first)
+            {
+                return 0;
+            }
+        }
+        s8 += src_stride;
+    }
+    return 1;
+}
+
+/******************************************************************************/
+static void
+rdpCaptureHashInit(uint64_t *hash, uint64_t seed)
+{
+    int index;
+
+    for (index = 0; index < 4; index++)
+    {
+        hash[index] = seed ^ g_hash_keys[index];
+    }
+}
+
+/******************************************************************************/
+static uint64_t
+rdpCaptureHashFinal(const uint64_t *hash)
+{
+    return wyhash((const void*)hash, 4 * sizeof(uint64_t), WYHASH_SEED, _wyp);
+}
+
+/******************************************************************************/
+/* the hash of a tile or block of one colour, wyhash reads 8 bytes at a time
+   so it is not used on the one pixel */
+static uint64_t
+rdpCaptureSolidHash(uint32_t pixel)
+{
+    return wyhash64(pixel, WYHASH_SEED);
+}
+
+/******************************************************************************/
+/* copy rects with no error checking
+ * convert ARGB32 to 64x64 linear planar YUVA and hash the source rects */
 static int
-rdpCopyBox_a8r8g8b8_to_yuvalp(rdpClientCon *clientCon, int ax, int ay,
-                              const uint8_t *src, int src_stride,
-                              uint8_t *dst, int dst_stride,
-                              BoxPtr rects, int num_rects)
+rdpCopyBox_a8r8g8b8_to_yuvalp_hash(rdpClientCon *clientCon, int ax, int ay,
+                                   const uint8_t *src, int src_stride,
+                                   uint8_t *dst, int dst_stride,
+                                   BoxPtr rects, int num_rects,
+                                   uint64_t *hash)
 {
     const uint8_t *s8;
     uint8_t *d8;
@@ -201,9 +371,9 @@ rdpCopyBox_a8r8g8b8_to_yuvalp(rdpClientCon *clientCon, int ax, int ay,
         d8 += box->x1 - ax;
         width = box->x2 - box->x1;
         height = box->y2 - box->y1;
-        clientCon->dev->a8r8g8b8_to_yuvalp_box(s8, src_stride,
-                                               d8, 64,
-                                               width, height);
+        clientCon->dev->a8r8g8b8_to_yuvalp_hash_box(s8, src_stride,
+                                                    d8, 64,
+                                                    width, height, hash);
     }
     return 0;
 }
@@ -270,11 +440,59 @@ rdpCopyBox_a8r8g8b8_to_a8b8g8r8(rdpClientCon *clientCon,
     return 0;
 }
 
+/******************************************************************************/
+/* 4x4 ordered dither, scaled in rdpGetDither to the bits each channel loses */
+static const uint8_t g_bayer4[4][4] =
+{
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 }
+};
+
+/* all zero, no dithering */
+static const uint8_t g_no_dither[4 * 32];
+
+/******************************************************************************/
+/* fill dither for a box that starts at x, y, 4 lines of 8 pixels as
+ * b, g, r, a bytes to add to the source pixel before dropping bits
+ * line 0 of dither goes with the first line of the box, the pattern
+ * repeats every 4 pixels so the SIMD code can use 4 or 8 pixels of it
+ * returns g_no_dither if dithering is off */
+static const uint8_t *
+rdpGetDither(rdpClientCon *clientCon, int x, int y,
+             int rbits, int gbits, int bbits, uint8_t *dither)
+{
+    int index;
+    int jndex;
+    int bayer;
+    uint8_t *d8;
+
+    if (!clientCon->dev->low_bpp_dither)
+    {
+        return g_no_dither;
+    }
+    d8 = dither;
+    for (index = 0; index < 4; index++)
+    {
+        for (jndex = 0; jndex < 8; jndex++)
+        {
+            bayer = g_bayer4[(y + index) & 3][(x + jndex) & 3];
+            d8[0] = (bayer << bbits) >> 4;
+            d8[1] = (bayer << gbits) >> 4;
+            d8[2] = (bayer << rbits) >> 4;
+            d8[3] = 0;
+            d8 += 4;
+        }
+    }
+    return dither;
+}
+
 /******************************************************************************/
 int
 a8r8g8b8_to_r5g6b5_box(const uint8_t *s8, int src_stride,
                        uint8_t *d8, int dst_stride,
-                       int width, int height)
+                       int width, int height, const uint8_t *dither)
 {
     int index;
     int jndex;
@@ -282,15 +500,22 @@ a8r8g8b8_to_r5g6b5_box(const uint8_t *s8, int src_stride,
     int green;
     int blue;
     const uint32_t *s32;
+    const uint8_t *drow;
+    const uint8_t *dpix;
     uint16_t *d16;
 
     for (index = 0; index < height; index++)
     {
         s32 = (const uint32_t *) s8;
         d16 = (uint16_t *) d8;
+        drow = dither + (index & 3) * 32;
         for (jndex = 0; jndex < width; jndex++)
         {
             SPLITCOLOR32(red, green, blue, *s32);
+            dpix = drow + (jndex & 3) * 4;
+            red = RDPMIN(red + dpix[2], UCHAR_MAX);
+            green = RDPMIN(green + dpix[1], UCHAR_MAX);
+            blue = RDPMIN(blue + dpix[0], UCHAR_MAX);
             *d16 = COLOR16(red, green, blue);
             s32++;
             d16++;
@@ -315,9 +540,11 @@ rdpCopyBox_a8r8g8b8_to_r5g6b5(rdpClientCon *clientCon,
     int width;
     int height;
     BoxPtr box;
-    copy_box_proc copy_box;
+    copy_box_dither_proc copy_box;
+    const uint8_t *dither;
+    uint8_t dither_data[4 * 32];
 
-    copy_box = a8r8g8b8_to_r5g6b5_box; /* TODO, simd */
+    copy_box = clientCon->dev->a8r8g8b8_to_r5g6b5_box;
     for (index = 0; index < num_rects; index++)
     {
         box = rects + index;
@@ -327,7 +554,9 @@ rdpCopyBox_a8r8g8b8_to_r5g6b5(rdpClientCon *clientCon,
         d8 += (box->x1 - dstx) * 2;
         width = box->x2 - box->x1;
         height = box->y2 - box->y1;
-        copy_box(s8, src_stride, d8, dst_stride, width, height);
+        dither = rdpGetDither(clientCon, box->x1, box->y1, 3, 2, 3,
+                              dither_data);
+        copy_box(s8, src_stride, d8, dst_stride, width, height, dither);
     }
     return 0;
 }
@@ -336,7 +565,7 @@ rdpCopyBox_a8r8g8b8_to_r5g6b5(rdpClientCon *clientCon,
 int
 a8r8g8b8_to_a1r5g5b5_box(const uint8_t *s8, int src_stride,
                          uint8_t *d8, int dst_stride,
-                         int width, int height)
+                         int width, int height, const uint8_t *dither)
 {
     int index;
     int jndex;
@@ -344,15 +573,22 @@ a8r8g8b8_to_a1r5g5b5_box(const uint8_t *s8, int src_stride,
     int green;
     int blue;
     const uint32_t *s32;
+    const uint8_t *drow;
+    const uint8_t *dpix;
     uint16_t *d16;
 
     for (index = 0; index < height; index++)
     {
         s32 = (const uint32_t *) s8;
         d16 = (uint16_t *) d8;
+        drow = dither + (index & 3) * 32;
         for (jndex = 0; jndex < width; jndex++)
         {
             SPLITCOLOR32(red, green, blue, *s32);
+            dpix = drow + (jndex & 3) * 4;
+            red = RDPMIN(red + dpix[2], UCHAR_MAX);
+            green = RDPMIN(green + dpix[1], UCHAR_MAX);
+            blue = RDPMIN(blue + dpix[0], UCHAR_MAX);
             *d16 = COLOR15(red, green, blue);
             s32++;
             d16++;
@@ -377,9 +613,11 @@ rdpCopyBox_a8r8g8b8_to_a1r5g5b5(rdpClientCon *clientCon,
     int width;
     int height;
     BoxPtr box;
-    copy_box_proc copy_box;
+    copy_box_dither_proc copy_box;
+    const uint8_t *dither;
+    uint8_t dither_data[4 * 32];
 
-    copy_box = a8r8g8b8_to_a1r5g5b5_box; /* TODO, simd */
+    copy_box = clientCon->dev->a8r8g8b8_to_a1r5g5b5_box;
     for (index = 0; index < num_rects; index++)
     {
         box = rects + index;
@@ -389,7 +627,9 @@ rdpCopyBox_a8r8g8b8_to_a1r5g5b5(rdpClientCon *clientCon,
         d8 += (box->x1 - dstx) * 2;
         width = box->x2 - box->x1;
         height = box->y2 - box->y1;
-        copy_box(s8, src_stride, d8, dst_stride, width, height);
+        dither = rdpGetDither(clientCon, box->x1, box->y1, 3, 3, 3,
+                              dither_data);
+        copy_box(s8, src_stride, d8, dst_stride, width, height, dither);
     }
     return 0;
 }
@@ -398,7 +638,7 @@ rdpCopyBox_a8r8g8b8_to_a1r5g5b5(rdpClientCon *clientCon,
 int
 a8r8g8b8_to_r3g3b2_box(const uint8_t *s8, int src_stride,
                        uint8_t *d8, int dst_stride,
-                       int width, int height)
+                       int width, int height, const uint8_t *dither)
 {
     int index;
     int jndex;
@@ -406,15 +646,22 @@ a8r8g8b8_to_r3g3b2_box(const uint8_t *s8, int src_stride,
     int green;
     int blue;
     const uint32_t *s32;
+    const uint8_t *drow;
+    const uint8_t *dpix;
     uint8_t *ld8;
 
     for (index = 0; index < height; index++)
     {
         s32 = (const uint32_t *) s8;
         ld8 = (uint8_t *) d8;
+        drow = dither + (index & 3) * 32;
         for (jndex = 0; jndex < width; jndex++)
         {
             SPLITCOLOR32(red, green, blue, *s32);
+            dpix = drow + (jndex & 3) * 4;
+            red = RDPMIN(red + dpix[2], UCHAR_MAX);
+            green = RDPMIN(green + dpix[1], UCHAR_MAX);
+            blue = RDPMIN(blue + dpix[0], UCHAR_MAX);
             *ld8 = COLOR8(red, green, blue);
             s32++;
             ld8++;
@@ -439,9 +686,11 @@ rdpCopyBox_a8r8g8b8_to_r3g3b2(rdpClientCon *clientCon,
     int width;
     int height;
     BoxPtr box;
-    copy_box_proc copy_box;
+    copy_box_dither_proc copy_box;
+    const uint8_t *dither;
+    uint8_t dither_data[4 * 32];
 
-    copy_box = a8r8g8b8_to_r3g3b2_box; /* TODO, simd */
+    copy_box = clientCon->dev->a8r8g8b8_to_r3g3b2_box;
     for (index = 0; index < num_rects; index++)
     {
         box = rects + index;
@@ -451,7 +700,9 @@ rdpCopyBox_a8r8g8b8_to_r3g3b2(rdpClientCon *clientCon,
         d8 += (box->x1 - dstx) * 1;
         width = box->x2 - box->x1;
         height = box->y2 - box->y1;
-        copy_box(s8, src_stride, d8, dst_stride, width, height);
+        dither = rdpGetDither(clientCon, box->x1, box->y1, 5, 5, 6,
+                              dither_data);
+        copy_box(s8, src_stride, d8, dst_stride, width, height, dither);
     }
     return 0;
 }
@@ -738,24 +989,6 @@ isShmStatusActive(enum shared_memory_status status) {
     }
 }
 
-/******************************************************************************/
-/* copy rects with no error checking */
-static uint64_t
-wyhash_rfx_tile(const uint8_t *src, int src_stride, int x, int y, uint64_t seed)
-{
-    int row;
-    uint64_t hash;
-    const uint8_t *s8;
-    hash = seed;
-    s8 = src + (y * src_stride) + (x * 4);
-    for(row = 0; row < 64; row++)
-    {
-        hash = wyhash((const void*)s8, 64 * 4, hash, _wyp);
-        s8 += src_stride;
-    }
-    return hash;
-}
-
 /******************************************************************************/
 static Bool
 rdpCaptureSimple(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
@@ -848,6 +1081,360 @@ rdpCaptureSimple(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
     return rv;
 }
 
+/******************************************************************************/
+static uint64_t
+wyhash_a16_block(const uint8_t *src, int src_stride, const BoxRec *rect,
+                 uint64_t seed)
+{
+    int row;
+    int height;
+    int bytes;
+    uint64_t hash;
+    const uint8_t *s8;
+
+    hash = seed;
+    height = rect->y2 - rect->y1;
+    bytes = (rect->x2 - rect->x1) * 4;
+    s8 = src + (rect->y1 * src_stride) + (rect->x1 * 4);
+    for (row = 0; row < height; row++)
+    {
+        hash = wyhash((const void*)s8, bytes, hash, _wyp);
+        s8 += src_stride;
+    }
+    return hash;
+}
+
+/******************************************************************************/
+/* the part of the changed blocks that is converted, a run of blocks of
+   one colour is in conv_rects only fill_rows high and is also in fills,
+   see rdpCaptureFillRows */
+struct capture_blocks
+{
+    BoxPtr conv_rects;
+    int num_conv_rects;
+    BoxPtr fills;
+    int num_fills;
+};
+
+/******************************************************************************/
+/* a run of blocks ends, add it to conv_rects and if it is of one colour
+   to fills */
+static void
+rdpCaptureBlocksEndRun(struct capture_blocks *blocks, const BoxRec *run,
+                       int solid, int fill_rows)
+{
+    BoxPtr conv_rect;
+
+    conv_rect = blocks->conv_rects + blocks->num_conv_rects;
+    blocks->num_conv_rects++;
+    *conv_rect = *run;
+    if (solid)
+    {
+        conv_rect->y2 = conv_rect->y1 + fill_rows;
+        blocks->fills[blocks->num_fills] = *run;
+        blocks->num_fills++;
+    }
+}
+
+/******************************************************************************/
+/* hash the 16x16 blocks under in_reg on a grid anchored at the capture
+   origin, the last row and column are moved in to stay inside srect
+   returns the changed blocks merged into rects and trims in_reg to them
+   or returns -1 if that takes more than max_rects
+   if fill_rows is not 0 a changed block of one colour is not hashed, its
+   hash is the colour's, and it joins a fill in blocks */
+static int
+rdpCaptureBlocks(rdpClientCon *clientCon, RegionPtr in_reg,
+                 const BoxRec *srect, const uint8_t *src,
+                 int src_stride, int mon_index, int fill_rows,
+                 BoxPtr rects, int max_rects,
+                 struct capture_blocks *blocks)
+{
+    BoxRec extents_rect;
+    BoxRec block;
+    BoxRec run;
+    BoxRec conv_run;
+    RegionRec block_reg;
+    RegionRec changed_reg;
+    uint64_t *crcs;
+    uint64_t crc;
+    uint32_t pixel;
+    uint32_t run_pixel;
+    solid_box_proc solid_box;
+    int crc_stride;
+    int num_crcs;
+    int num_rects;
+    int max_blocks;
+    int have_run;
+    int have_conv_run;
+    int conv_run_solid;
+    int changed;
+    int solid;
+    int overflow;
+    int bx;
+    int by;
+    int bx1;
+    int bx2;
+    int by1;
+    int by2;
+    int index;
+
+    crc_stride = (srect->x2 - srect->x1 + 15) / 16;
+    num_crcs = crc_stride * ((srect->y2 - srect->y1 + 15) / 16);
+    if (num_crcs != clientCon->num_rfx_crcs_alloc[mon_index])
+    {
+        LLOGLN(0, ("rdpCaptureBlocks: resize the crc list was %d now %d",
+               clientCon->num_rfx_crcs_alloc[mon_index], num_crcs));
+        clientCon->num_rfx_crcs_alloc[mon_index] = num_crcs;
+        free(clientCon->rfx_crcs[mon_index]);
+        clientCon->rfx_crcs[mon_index] = g_new0(uint64_t, num_crcs);
+    }
+    crcs = clientCon->rfx_crcs[mon_index];
+    solid_box = clientCon->dev->a8r8g8b8_solid_box;
+
+    extents_rect = *rdpRegionExtents(in_reg);
+    bx1 = (RDPMAX(extents_rect.x1, srect->x1) - srect->x1) / 16;
+    bx2 = (RDPMIN(extents_rect.x2, srect->x2) - srect->x1 + 15) / 16;
+    by1 = (RDPMAX(extents_rect.y1, srect->y1) - srect->y1) / 16;
+    by2 = (RDPMIN(extents_rect.y2, srect->y2) - srect->y1 + 15) / 16;
+
+    /* a run of either kind is at least one block */
+    max_blocks = RDPMAX((bx2 - bx1) * (by2 - by1), 1);
+    blocks->conv_rects = g_new(BoxRec, max_blocks);
+    blocks->num_conv_rects = 0;
+    blocks->fills = g_new(BoxRec, max_blocks);
+    blocks->num_fills = 0;
+
+    num_rects = 0;
+    overflow = 0;
+    run_pixel = 0;
+    for (by = by1; by < by2; by++)
+    {
+        block.y1 = srect->y1 + by * 16;
+        block.y2 = block.y1 + 16;
+        if (block.y2 > srect->y2)
+        {
+            block.y2 = srect->y2;
+            block.y1 = RDPMAX(block.y2 - 16, srect->y1);
+        }
+        have_run = 0;
+        have_conv_run = 0;
+        conv_run_solid = 0;
+        for (bx = bx1; bx <= bx2; bx++)
+        {
+            changed = 0;
+            solid = 0;
+            pixel = 0;
+            if (bx < bx2)
+            {
+                block.x1 = srect->x1 + bx * 16;
+                block.x2 = block.x1 + 16;
+                if (block.x2 > srect->x2)
+                {
+                    block.x2 = srect->x2;
+                    block.x1 = RDPMAX(block.x2 - 16, srect->x1);
+                }
+                if (rdpRegionContainsRect(in_reg, &block) != rgnOUT)
+                {
+                    if ((fill_rows > 0) &&
+                        solid_box(src + block.y1 * src_stride +
+                                  block.x1 * 4, src_stride,
+                                  block.x2 - block.x1, block.y2 - block.y1,
+                                  &pixel))
+                    {
+                        solid = 1;
+                        crc = rdpCaptureSolidHash(pixel);
+                    }
+                    else
+                    {
+                        crc = wyhash_a16_block(src, src_stride, &block,
+                                               WYHASH_SEED);
+                    }
+                    clientCon->tiles_hashed++;
+                    if (crc != crcs[by * crc_stride + bx])
+                    {
+                        crcs[by * crc_stride + bx] = crc;
+                        changed = 1;
+                        if (solid)
+                        {
+                            clientCon->tiles_solid++;
+                        }
+                    }
+                    else
+                    {
+                        clientCon->tiles_skipped++;
+                    }
+                }
+            }
+            /* what is converted, runs of changed blocks split where they
+               go from one colour to another */
+            if (have_conv_run)
+            {
+                if (changed && (solid == conv_run_solid) &&
+                    (!solid || (pixel == run_pixel)))
+                {
+                    conv_run.x2 = block.x2;
+                }
+                else
+                {
+                    rdpCaptureBlocksEndRun(blocks, &conv_run,
+                                           conv_run_solid, fill_rows);
+                    have_conv_run = 0;
+                }
+            }
+            if (changed && !have_conv_run)
+            {
+                conv_run = block;
+                conv_run_solid = solid;
+                run_pixel = pixel;
+                have_conv_run = 1;
+            }
+            /* a changed block extends the run only if it starts where
+               the run ends, the last column moved in overlaps and is a
+               run of its own so every rect stays a multiple of 16 */
+            if (changed && have_run && (run.x2 == block.x1))
+            {
+                run.x2 = block.x2;
+                continue;
+            }
+            if (have_run)
+            {
+                have_run = 0;
+                /* end of run, merge it with a run of the same width that
+                   ends where this block row starts, not with the last
+                   row moved in */
+                for (index = 0; index < num_rects; index++)
+                {
+                    if ((rects[index].x1 == run.x1) &&
+                        (rects[index].x2 == run.x2) &&
+                        (rects[index].y2 == run.y1))
+                    {
+                        rects[index].y2 = run.y2;
+                        break;
+                    }
+                }
+                if (index == num_rects)
+                {
+                    if (num_rects < max_rects)
+                    {
+                        rects[num_rects] = run;
+                        num_rects++;
+                    }
+                    else
+                    {
+                        /* keep going, every crc must match what is sent */
+                        overflow = 1;
+                    }
+                }
+            }
+            if (changed)
+            {
+                run = block;
+                have_run = 1;
+            }
+        }
+    }
+    if (overflow)
+    {
+        free(blocks->conv_rects);
+        free(blocks->fills);
+        return -1;
+    }
+
+    /* only report what is sent as dirty */
+    rdpRegionInit(&changed_reg, NullBox, 0);
+    for (index = 0; index < num_rects; index++)
+    {
+        rdpRegionInit(&block_reg, rects + index, 0);
+        rdpRegionUnion(&changed_reg, &changed_reg, &block_reg);
+        rdpRegionUninit(&block_reg);
+    }
+    rdpRegionIntersect(in_reg, in_reg, &changed_reg);
+    rdpRegionUninit(&changed_reg);
+    return num_rects;
+}
+
+/******************************************************************************/
+/* skip the 16x16 blocks that have not changed since they were last sent,
+   out_rects is replaced with the changed blocks unless the changes are
+   too scattered to merge into a few rects
+   blocks gets what to convert, runs of one colour are converted
+   fill_rows high, the least the conversion can do, and repeated with
+   rdpCaptureFillRows, blocks must be freed
+   the destination must still hold what was sent for the skipped blocks */
+static void
+rdpCaptureSkipBlocks(rdpClientCon *clientCon, RegionPtr in_reg,
+                     const BoxRec *srect, const uint8_t *src,
+                     int src_stride, struct image_data *id, int fill_rows,
+                     BoxPtr *out_rects, int *num_out_rects,
+                     struct capture_blocks *blocks)
+{
+    BoxPtr block_rects;
+    int num_block_rects;
+    int mon_index;
+
+    mon_index = (id->flags >> 28) & 0xF;
+    if (!clientCon->dev->solid_fill)
+    {
+        fill_rows = 0;
+    }
+    block_rects = g_new(BoxRec, RDP_MAX_BLOCK_RECTS);
+    num_block_rects = rdpCaptureBlocks(clientCon, in_reg, srect,
+                                       src, src_stride, mon_index,
+                                       fill_rows,
+                                       block_rects, RDP_MAX_BLOCK_RECTS,
+                                       blocks);
+    if (num_block_rects >= 0)
+    {
+        LLOGLN(10, ("rdpCaptureSkipBlocks: num_rects %d num_block_rects %d "
+               "num_fills %d", *num_out_rects, num_block_rects,
+               blocks->num_fills));
+        free(*out_rects);
+        *out_rects = block_rects;
+        *num_out_rects = num_block_rects;
+    }
+    else
+    {
+        free(block_rects);
+        /* convert it all */
+        blocks->conv_rects = g_new(BoxRec, RDPMAX(*num_out_rects, 1));
+        g_memcpy(blocks->conv_rects, *out_rects,
+                 *num_out_rects * sizeof(BoxRec));
+        blocks->num_conv_rects = *num_out_rects;
+        blocks->fills = NULL;
+        blocks->num_fills = 0;
+    }
+}
+
+/******************************************************************************/
+/* repeat the first row of each fill down to its last, bpp is the bytes
+   of a pixel in this plane, y_shift is 1 for the half height chroma */
+static void
+rdpCaptureFillRows(uint8_t *dst, int dst_stride, int bpp, int y_shift,
+                   const BoxRec *fills, int num_fills)
+{
+    uint8_t *s8;
+    uint8_t *d8;
+    int index;
+    int bytes;
+    int y;
+    int y2;
+
+    for (index = 0; index < num_fills; index++)
+    {
+        bytes = (fills[index].x2 - fills[index].x1) * bpp;
+        y = fills[index].y1 >> y_shift;
+        y2 = fills[index].y2 >> y_shift;
+        s8 = dst + y * dst_stride + fills[index].x1 * bpp;
+        d8 = s8;
+        for (y++; y < y2; y++)
+        {
+            d8 += dst_stride;
+            g_memcpy(d8, s8, bytes);
+        }
+    }
+}
+
 /******************************************************************************/
 /* make out_rects always multiple of 16 width and height */
 static Bool
@@ -857,26 +1444,14 @@ rdpCaptureSufA16(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
     BoxPtr psrc_rects;
     BoxRec rect;
     BoxRec srect;
-    const uint8_t *src_rect;
-    uint8_t *dst_rect;
+    struct capture_blocks blocks;
     int num_rects;
-    int src_bytespp;
-    int dst_bytespp;
     int width;
     int height;
-    int src_offset;
-    int dst_offset;
     int index;
-    int jndex;
-    int kndex;
-    int red;
-    int green;
-    int blue;
     int ex;
     int ey;
     Bool rv;
-    const uint32_t *s32;
-    uint32_t *d32;
     const uint8_t *src;
     uint8_t *dst;
     int src_stride;
@@ -955,46 +1530,487 @@ rdpCaptureSufA16(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
 
     if (dst_format == XRDP_a8b8g8r8)
     {
-        src_bytespp = 4;
-        dst_bytespp = 4;
+        rdpCaptureSkipBlocks(clientCon, in_reg, &srect, src, src_stride, id,
+                             1, out_rects, num_out_rects, &blocks);
+        rdpCopyBox_a8r8g8b8_to_a8b8g8r8(clientCon, src, src_stride, 0, 0,
+                                        dst, dst_stride, 0, 0,
+                                        blocks.conv_rects,
+                                        blocks.num_conv_rects);
+        rdpCaptureFillRows(dst, dst_stride, 4, 0,
+                           blocks.fills, blocks.num_fills);
+        free(blocks.conv_rects);
+        free(blocks.fills);
+    }
+    else
+    {
+        LLOGLN(0, ("rdpCaptureSufA16: unimplemented color conversion"));
+    }
+    return rv;
+}
 
-        for (index = 0; index < num_rects; index++)
-        {
-            /* get rect to copy */
-            rect = (*out_rects)[index];
+/******************************************************************************/
+/* one 64x64 tile for rdpCaptureGfxPro, hashed and converted by
+   rdpCaptureGfxProTileProc on any thread */
+struct gfxpro_tile
+{
+    BoxRec rect;
+    int rcode;
+    int crc_offset;
+    uint64_t crc;
+    RegionRec tile_reg; /* rgnPART only, the part of in_reg in the tile */
+    int solid; /* boolean, rgnIN of one colour, not converted */
+    uint32_t pixel; /* the colour if solid */
+};
+
+struct gfxpro_job
+{
+    rdpClientCon *clientCon;
+    const uint8_t *src;
+    int src_stride;
+    uint8_t *dst;
+    int dst_stride;
+    struct gfxpro_tile *tiles;
+    uint64_t *row_hashes; /* NULL if not looking for scrolls */
+    int row_stride;
+    int width;
+    int height;
+    int solid; /* boolean, look for tiles of one colour */
+    int cache; /* boolean, copy tiles from the client tile cache */
+};
 
-            /* get rect dimensions */
-            width = rect.x2 - rect.x1;
-            height = rect.y2 - rect.y1;
+/******************************************************************************/
+/* hash of one row of a 64 pixel wide strip, 0 is never returned, it
+   means not known */
+static uint64_t
+rdpCaptureRowHash(const uint8_t *src, int src_stride, int x, int y,
+                  int width)
+{
+    uint64_t hash;
+
+    src += y * src_stride + x * 4;
+    hash = wyhash((const void*)src, RDPMIN(XRDP_RFX_ALIGN, width - x) * 4,
+                  WYHASH_SEED, _wyp);
+    return (hash == 0) ? 1 : hash;
+}
+
+/******************************************************************************/
+/* rdp_worker_proc helper, the row hashes of one tile for
+   rdpCaptureGfxProScroll */
+static void
+rdpCaptureGfxProRowHashes(struct gfxpro_job *job, const BoxRec *rect)
+{
+    uint64_t *row_hashes;
+    int y;
+    int y2;
+
+    row_hashes = job->row_hashes + rect->x1 / XRDP_RFX_ALIGN;
+    y2 = RDPMIN(rect->y2, job->height);
+    for (y = rect->y1; y < y2; y++)
+    {
+        row_hashes[y * job->row_stride] =
+                rdpCaptureRowHash(job->src, job->src_stride, rect->x1, y,
+                                  job->width);
+    }
+}
+
+/******************************************************************************/
+/* rdp_worker_proc, only touches this tile's destination
+   the tile is converted and its source hashed in one pass, a whole tile
+   of one colour is not converted, its hash is the colour's */
+static void
+rdpCaptureGfxProTileProc(void *data, int index)
+{
+    struct gfxpro_job *job;
+    struct gfxpro_tile *tile;
+    BoxPtr rects;
+    int num_rects;
+    int x;
+    int y;
+    uint64_t seed;
+    uint64_t hash[4];
+    solid_box_proc solid_box;
+
+    job = (struct gfxpro_job *) data;
+    tile = job->tiles + index;
+    solid_box = job->clientCon->dev->a8r8g8b8_solid_box;
+    x = tile->rect.x1;
+    y = tile->rect.y1;
+    if (tile->rcode == rgnPART)
+    {
+        rdpFillBox_yuvalp(x, y, job->dst, job->dst_stride);
+        rects = REGION_RECTS(&(tile->tile_reg));
+        num_rects = REGION_NUM_RECTS(&(tile->tile_reg));
+        /* hex digits of pi as a 64 bit int */
+        seed = wyhash((const void*)rects, num_rects * sizeof(BoxRec),
+                      WYHASH_SEED, _wyp);
+        rdpCaptureHashInit(hash, seed);
+        rdpCopyBox_a8r8g8b8_to_yuvalp_hash(job->clientCon, x, y,
+                                           job->src, job->src_stride,
+                                           job->dst, job->dst_stride,
+                                           rects, num_rects, hash);
+        tile->crc = rdpCaptureHashFinal(hash);
+    }
+    else if (job->solid &&
+             solid_box(job->src + y * job->src_stride + x * 4,
+                       job->src_stride, XRDP_RFX_ALIGN, XRDP_RFX_ALIGN,
+                       &(tile->pixel)))
+    {
+        /* rgnIN of one colour, the client fills it */
+        tile->solid = TRUE;
+        tile->crc = rdpCaptureSolidHash(tile->pixel);
+    }
+    else /* rgnIN */
+    {
+        rdpCaptureHashInit(hash, WYHASH_SEED);
+        rdpCopyBox_a8r8g8b8_to_yuvalp_hash(job->clientCon, x, y,
+                                           job->src, job->src_stride,
+                                           job->dst, job->dst_stride,
+                                           &(tile->rect), 1, hash);
+        tile->crc = rdpCaptureHashFinal(hash);
+    }
+    if (job->row_hashes != NULL)
+    {
+        rdpCaptureGfxProRowHashes(job, &(tile->rect));
+    }
+}
 
-            /* point to start of each rect in respective memory */
-            src_offset = rect.y1 * src_stride + rect.x1 * src_bytespp;
-            dst_offset = rect.y1 * dst_stride + rect.x1 * dst_bytespp;
-            src_rect = src + src_offset;
-            dst_rect = dst + dst_offset;
+/******************************************************************************/
+/* the client no longer has what the capture last saw in box, box is in
+   monitor coordinates */
+void
+rdpCaptureInvalidate(rdpClientCon *clientCon, struct image_data *id,
+                     const BoxRec *box)
+{
+    int mon_index;
+    int stride;
+    int x;
+    int y;
+    int x1;
+    int x2;
+    int y1;
+    int y2;
+    uint64_t *crcs;
+    uint64_t *row_hashes;
 
-            /* copy one line at a time */
-            for (jndex = 0; jndex < height; jndex++)
+    mon_index = (id->flags >> 28) & 0xF;
+    stride = (id->width + 63) / 64;
+    x1 = RDPMAX(box->x1, 0) / XRDP_RFX_ALIGN;
+    x2 = (RDPMIN(box->x2, id->width) + 63) / XRDP_RFX_ALIGN;
+    crcs = clientCon->rfx_crcs[mon_index];
+    if ((crcs != NULL) && (clientCon->num_rfx_crcs_alloc[mon_index] ==
+                           stride * ((id->height + 63) / 64)))
+    {
+        y1 = RDPMAX(box->y1, 0) / XRDP_RFX_ALIGN;
+        y2 = (RDPMIN(box->y2, id->height) + 63) / XRDP_RFX_ALIGN;
+        for (y = y1; y < y2; y++)
+        {
+            for (x = x1; x < x2; x++)
             {
-                s32 = (const uint32_t *) src_rect;
-                d32 = (uint32_t *) dst_rect;
-                for (kndex = 0; kndex < width; kndex++)
-                {
-                    SPLITCOLOR32(red, green, blue, *s32);
-                    *d32 = COLOR24(red, green, blue);
-                    s32++;
-                    d32++;
-                }
-                src_rect += src_stride;
-                dst_rect += dst_stride;
+                crcs[y * stride + x] = 0;
             }
         }
     }
+    row_hashes = clientCon->row_hashes[mon_index];
+    if ((row_hashes != NULL) && (clientCon->num_row_hashes_alloc[mon_index] ==
+                                 stride * id->height))
+    {
+        y1 = RDPMAX(box->y1, 0);
+        y2 = RDPMIN(box->y2, id->height);
+        for (y = y1; y < y2; y++)
+        {
+            for (x = x1; x < x2; x++)
+            {
+                row_hashes[y * stride + x] = 0;
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/* find the vertical shift most rows of the middle strip agree on, the
+   rows are looked for where they were last frame, rows seen more than
+   once, like blank ones, do not vote
+   returns the shift or 0 */
+static int
+rdpCaptureGfxProVote(const uint64_t *cur, int cur_stride,
+                     const uint64_t *prev, int prev_stride, int y1, int y2)
+{
+    struct row_slot
+    {
+        uint64_t hash; /* 0 for an empty slot */
+        int y; /* -1 if the hash is on more than one row */
+    } *table;
+    int height;
+    int table_mask;
+    int *votes;
+    int num_voters;
+    int best;
+    int index;
+    int y;
+    uint64_t hash;
+
+    height = y2 - y1;
+    table_mask = 1;
+    while (table_mask < height * 2)
+    {
+        table_mask <<= 1;
+    }
+    table = g_new0(struct row_slot, table_mask);
+    table_mask--;
+    for (y = y1; y < y2; y++)
+    {
+        hash = prev[y * prev_stride];
+        if (hash == 0)
+        {
+            continue;
+        }
+        index = hash & table_mask;
+        while ((table[index].hash != 0) && (table[index].hash != hash))
+        {
+            index = (index + 1) & table_mask;
+        }
+        table[index].y = (table[index].hash == 0) ? y : -1;
+        table[index].hash = hash;
+    }
+    votes = g_new0(int, height * 2);
+    num_voters = 0;
+    for (y = y1; y < y2; y++)
+    {
+        hash = cur[(y - y1) * cur_stride];
+        index = hash & table_mask;
+        while ((table[index].hash != 0) && (table[index].hash != hash))
+        {
+            index = (index + 1) & table_mask;
+        }
+        if ((table[index].hash == hash) && (table[index].y >= 0) &&
+            (table[index].y != y))
+        {
+            votes[table[index].y - y + height]++;
+            num_voters++;
+        }
+    }
+    best = 0;
+    for (index = 1; index < height * 2; index++)
+    {
+        if (votes[index] > votes[best])
+        {
+            best = index;
+        }
+    }
+    index = votes[best];
+    free(table);
+    free(votes);
+    LLOGLN(10, ("rdpCaptureGfxProVote: dy %d votes %d of %d",
+           best - height, index, num_voters));
+    if ((index < 16) || (index * 4 < num_voters))
+    {
+        return 0;
+    }
+    return best - height;
+}
+
+/******************************************************************************/
+/* look for content that moved up or down in a single dirty rect, like a
+   scrolled page, the longest run of rows the client already has is
+   copied on the client with a surface to surface command and taken out
+   of in_reg
+   in_reg and the row hashes are in monitor coordinates */
+static void
+rdpCaptureGfxProScroll(rdpClientCon *clientCon, RegionPtr in_reg,
+                       struct gfxpro_job *job, struct image_data *id)
+{
+    struct rdp_screen_copy *copy;
+    const BoxRec *extents;
+    BoxRec box;
+    RegionRec reg;
+    uint64_t *prev;
+    uint64_t *cur;
+    int num_strips;
+    int s1;
+    int s2;
+    int s;
+    int y;
+    int y1;
+    int y2;
+    int ya;
+    int yb;
+    int run;
+    int dy;
+
+    if ((REGION_NUM_RECTS(in_reg) != 1) ||
+        (clientCon->num_frame_copies >= RDP_MAX_SCREEN_COPIES + 1))
+    {
+        return;
+    }
+    extents = rdpRegionExtents(in_reg);
+    s1 = (RDPMAX(extents->x1, 0) + 63) / XRDP_RFX_ALIGN;
+    if (extents->x2 >= job->width)
+    {
+        s2 = job->row_stride;
+    }
     else
     {
-        LLOGLN(0, ("rdpCaptureSufA16: unimplemented color conversion"));
+        s2 = extents->x2 / XRDP_RFX_ALIGN;
     }
-    return rv;
+    y1 = RDPMAX(extents->y1, 0);
+    y2 = RDPMIN(extents->y2, job->height);
+    num_strips = s2 - s1;
+    if ((num_strips < 4) || (y2 - y1 < 128))
+    {
+        return;
+    }
+    prev = job->row_hashes;
+    /* the middle strip first, most rects that change are not scrolls */
+    cur = g_new(uint64_t, (y2 - y1) * num_strips);
+    s = s1 + num_strips / 2;
+    for (y = y1; y < y2; y++)
+    {
+        cur[(y - y1) * num_strips + s - s1] =
+                rdpCaptureRowHash(job->src, job->src_stride,
+                                  s * XRDP_RFX_ALIGN, y, job->width);
+    }
+    dy = rdpCaptureGfxProVote(cur + s - s1, num_strips,
+                              prev + s, job->row_stride, y1, y2);
+    if (dy == 0)
+    {
+        free(cur);
+        return;
+    }
+    /* dy is where the rows were, check every strip of them */
+    for (y = y1; y < y2; y++)
+    {
+        for (s = s1; s < s2; s++)
+        {
+            if (s != s1 + num_strips / 2)
+            {
+                cur[(y - y1) * num_strips + s - s1] =
+                        rdpCaptureRowHash(job->src, job->src_stride,
+                                          s * XRDP_RFX_ALIGN, y, job->width);
+            }
+        }
+    }
+    ya = 0;
+    yb = 0;
+    run = 0;
+    for (y = y1; y < y2; y++)
+    {
+        if ((y + dy >= y1) && (y + dy < y2) &&
+            (memcmp(cur + (y - y1) * num_strips,
+                    prev + (y + dy) * job->row_stride + s1,
+                    num_strips * sizeof(uint64_t)) == 0))
+        {
+            run++;
+            if (run > yb - ya)
+            {
+                yb = y + 1;
+                ya = yb - run;
+            }
+        }
+        else
+        {
+            run = 0;
+        }
+    }
+    LLOGLN(10, ("rdpCaptureGfxProScroll: dy %d rows %d to %d", dy, ya, yb));
+    if (yb - ya < 32)
+    {
+        free(cur);
+        return;
+    }
+    box.x1 = s1 * XRDP_RFX_ALIGN;
+    box.y1 = ya;
+    box.x2 = RDPMIN(s2 * XRDP_RFX_ALIGN, job->width);
+    box.y2 = yb;
+    copy = clientCon->frame_copies + clientCon->num_frame_copies;
+    clientCon->num_frame_copies++;
+    copy->dst = box;
+    copy->dx = 0;
+    copy->dy = -dy;
+    /* the tiles under the copy are not what was last sent, the rows are
+       what the client will have */
+    rdpCaptureInvalidate(clientCon, id, &box);
+    for (y = ya; y < yb; y++)
+    {
+        memcpy(prev + y * job->row_stride + s1,
+               cur + (y - y1) * num_strips,
+               num_strips * sizeof(uint64_t));
+    }
+    free(cur);
+    rdpRegionInit(&reg, &box, 0);
+    rdpRegionSubtract(in_reg, in_reg, &reg);
+    rdpRegionUninit(&reg);
+    clientCon->scrolls_detected++;
+}
+
+/******************************************************************************/
+/* a changed tile the client has cached is copied from its cache instead
+   of being sent, other whole tiles are copied to the cache once drawn
+   partial tiles are hashed with their rects, they are not cached
+   returns TRUE if the tile is not to be sent */
+static Bool
+rdpCaptureGfxProCache(rdpClientCon *clientCon, struct gfxpro_tile *tile)
+{
+    struct rdp_tile_cache_ops *ops;
+    struct rdp_tile_cache_hit *hit;
+    struct rdp_tile_cache_store *store;
+    int slot;
+
+    if ((clientCon->tile_cache == NULL) || (tile->rcode != rgnIN))
+    {
+        return FALSE;
+    }
+    ops = clientCon->tile_cache_ops;
+    slot = rdpTileCacheFind(clientCon->tile_cache, tile->crc);
+    if (slot > 0)
+    {
+        if (ops->num_hits >= RDP_TILE_CACHE_FRAME_OPS)
+        {
+            return FALSE;
+        }
+        LLOGLN(10, ("rdpCaptureGfxProCache: hit slot %d at x %d y %d",
+               slot, tile->rect.x1, tile->rect.y1));
+        hit = ops->hits + ops->num_hits;
+        ops->num_hits++;
+        hit->slot = slot;
+        hit->x = tile->rect.x1;
+        hit->y = tile->rect.y1;
+        return TRUE;
+    }
+    if ((slot == 0) && (ops->num_stores < RDP_TILE_CACHE_FRAME_OPS))
+    {
+        store = ops->stores + ops->num_stores;
+        ops->num_stores++;
+        store->slot = rdpTileCacheAdd(clientCon->tile_cache, tile->crc);
+        store->key = tile->crc;
+        store->rect = tile->rect;
+    }
+    return FALSE;
+}
+
+/******************************************************************************/
+/* a changed tile of one colour is filled by the client, joined to the
+   fill on its left if that is the same colour */
+static void
+rdpCaptureGfxProFill(rdpClientCon *clientCon, struct gfxpro_tile *tile)
+{
+    struct rdp_solid_fill *fill;
+
+    if (clientCon->num_frame_fills > 0)
+    {
+        fill = clientCon->frame_fills + clientCon->num_frame_fills - 1;
+        if ((fill->pixel == tile->pixel) &&
+            (fill->rect.x2 == tile->rect.x1) &&
+            (fill->rect.y1 == tile->rect.y1) &&
+            (fill->rect.y2 == tile->rect.y2))
+        {
+            fill->rect.x2 = tile->rect.x2;
+            return;
+        }
+    }
+    fill = clientCon->frame_fills + clientCon->num_frame_fills;
+    clientCon->num_frame_fills++;
+    fill->rect = tile->rect;
+    fill->pixel = tile->pixel;
 }
 
 /******************************************************************************/
@@ -1005,22 +2021,25 @@ rdpCaptureGfxPro(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
     int x;
     int y;
     int out_rect_index;
-    int num_rects;
     int rcode;
-    BoxRec rect;
+    int index;
+    int num_tiles;
+    int num_cached;
+    int num_solid;
+    int max_tiles;
     BoxRec extents_rect;
-    BoxPtr rects;
-    RegionRec tile_reg;
+    BoxRec tiles_rect;
+    uint8_t *tile_map;
     const uint8_t *src;
     uint8_t *dst;
-    uint8_t *crc_dst;
     int src_stride;
     int dst_stride;
-    int crc_offset;
     int crc_stride;
-    uint64_t crc;
     int num_crcs;
     int mon_index;
+    struct gfxpro_tile *tiles;
+    struct gfxpro_tile *tile;
+    struct gfxpro_job job;
 
     LLOGLN(10, ("rdpCaptureGfxPro:"));
 
@@ -1031,13 +2050,6 @@ rdpCaptureGfxPro(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
         return FALSE;
     }
 
-    *out_rects = g_new(BoxRec, RDP_MAX_TILES);
-    if (*out_rects == NULL)
-    {
-        return FALSE;
-    }
-    out_rect_index = 0;
-
     rdpRegionTranslate(in_reg, -id->left, -id->top);
 
     src = id->pixels;
@@ -1060,89 +2072,153 @@ rdpCaptureGfxPro(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
         clientCon->rfx_crcs[mon_index] = g_new0(uint64_t, num_crcs);
     }
 
+    job.clientCon = clientCon;
+    job.src = src;
+    job.src_stride = src_stride;
+    job.dst = dst;
+    job.dst_stride = dst_stride;
+    job.row_hashes = NULL;
+    job.row_stride = crc_stride;
+    job.width = id->width;
+    job.height = id->height;
+    job.solid = clientCon->dev->solid_fill && clientCon->solid_fill &&
+                (clientCon->client_info.capture_code == CC_GFX_PRO);
+    /* only gfx frames carry the cache commands */
+    job.cache = (clientCon->tile_cache != NULL) &&
+                (clientCon->client_info.capture_code == CC_GFX_PRO);
+    if (clientCon->dev->scroll_detect && clientCon->screen_copy &&
+        (clientCon->client_info.capture_code == CC_GFX_PRO))
+    {
+        num_crcs = crc_stride * id->height;
+        if (num_crcs != clientCon->num_row_hashes_alloc[mon_index])
+        {
+            clientCon->num_row_hashes_alloc[mon_index] = num_crcs;
+            free(clientCon->row_hashes[mon_index]);
+            clientCon->row_hashes[mon_index] = g_new0(uint64_t, num_crcs);
+        }
+        job.row_hashes = clientCon->row_hashes[mon_index];
+        rdpCaptureGfxProScroll(clientCon, in_reg, &job, id);
+    }
+
+    /* pass 1, on the X main thread, find the tiles that need work
+       classify all the tiles in one go, in_reg is only trimmed at the end */
     extents_rect = *rdpRegionExtents(in_reg);
-    y = extents_rect.y1 & ~63;
-    while (y < extents_rect.y2)
+    tiles_rect.x1 = extents_rect.x1 & ~63;
+    tiles_rect.y1 = extents_rect.y1 & ~63;
+    tiles_rect.x2 = (extents_rect.x2 + 63) & ~63;
+    tiles_rect.y2 = (extents_rect.y2 + 63) & ~63;
+    max_tiles = ((tiles_rect.x2 - tiles_rect.x1) / XRDP_RFX_ALIGN) *
+                ((tiles_rect.y2 - tiles_rect.y1) / XRDP_RFX_ALIGN);
+    tile_map = g_new(uint8_t, RDPMAX(max_tiles, 1));
+    rdpRegionTileMap(in_reg, &tiles_rect, XRDP_RFX_ALIGN, tile_map);
+    tiles = g_new(struct gfxpro_tile, RDPMAX(max_tiles, 1));
+    num_tiles = 0;
+    index = 0;
+    y = tiles_rect.y1;
+    while (y < tiles_rect.y2)
     {
-        x = extents_rect.x1 & ~63;
-        while (x < extents_rect.x2)
+        x = tiles_rect.x1;
+        while (x < tiles_rect.x2)
         {
-            rect.x1 = x;
-            rect.y1 = y;
-            rect.x2 = rect.x1 + XRDP_RFX_ALIGN;
-            rect.y2 = rect.y1 + XRDP_RFX_ALIGN;
-            rcode = rdpRegionContainsRect(in_reg, &rect);
+            rcode = tile_map[index++];
             LLOGLN(10, ("rdpCaptureGfxPro: rcode %d", rcode));
-
-            if (rcode == rgnOUT)
+            if (rcode != rgnOUT)
             {
-                LLOGLN(10, ("rdpCaptureGfxPro: rgnOUT"));
-                rdpRegionInit(&tile_reg, &rect, 0);
-                rdpRegionSubtract(in_reg, in_reg, &tile_reg);
-                rdpRegionUninit(&tile_reg);
-            }
-            else
-            {
-                /* hex digits of pi as a 64 bit int */
-                crc = WYHASH_SEED;
+                tile = tiles + num_tiles;
+                num_tiles++;
+                tile->rect.x1 = x;
+                tile->rect.y1 = y;
+                tile->rect.x2 = x + XRDP_RFX_ALIGN;
+                tile->rect.y2 = y + XRDP_RFX_ALIGN;
+                tile->rcode = rcode;
+                tile->solid = FALSE;
+                tile->crc_offset = (y / XRDP_RFX_ALIGN) * crc_stride
+                                   + (x / XRDP_RFX_ALIGN);
                 if (rcode == rgnPART)
                 {
                     LLOGLN(10, ("rdpCaptureGfxPro: rgnPART"));
-                    rdpFillBox_yuvalp(x, y, dst, dst_stride);
-                    rdpRegionInit(&tile_reg, &rect, 0);
-                    rdpRegionIntersect(&tile_reg, in_reg, &tile_reg);
-                    rects = REGION_RECTS(&tile_reg);
-                    num_rects = REGION_NUM_RECTS(&tile_reg);
-                    crc = wyhash((const void*)rects, num_rects * sizeof(BoxRec), crc, _wyp);
-                    rdpCopyBox_a8r8g8b8_to_yuvalp(clientCon, x, y,
-                                                  src, src_stride,
-                                                  dst, dst_stride,
-                                                  rects, num_rects);
-                    crc_dst = dst + (y << 8) * (dst_stride >> 8) + (x << 8);
-                    crc = wyhash((const void*)crc_dst, 64 * 64 * 4, crc, _wyp);
-                    rdpRegionUninit(&tile_reg);
-                }
-                else /* rgnIN */
-                {
-                    LLOGLN(10, ("rdpCaptureGfxPro: rgnIN"));
-                    crc = wyhash_rfx_tile(src, src_stride, x, y, crc);
-                }
-                crc_offset = (y / XRDP_RFX_ALIGN) * crc_stride
-                             + (x / XRDP_RFX_ALIGN);
-                LLOGLN(10, ("rdpCaptureGfxPro: crc 0x%" PRIx64 " 0x%" PRIx64,
-                       crc, clientCon->rfx_crcs[mon_index][crc_offset]));
-                if (crc == clientCon->rfx_crcs[mon_index][crc_offset])
-                {
-                    LLOGLN(10, ("rdpCaptureGfxPro: crc skip at x %d y %d", x, y));
-                    rdpRegionInit(&tile_reg, &rect, 0);
-                    rdpRegionSubtract(in_reg, in_reg, &tile_reg);
-                    rdpRegionUninit(&tile_reg);
+                    rdpRegionInit(&(tile->tile_reg), &(tile->rect), 0);
+                    rdpRegionIntersect(&(tile->tile_reg), in_reg,
+                                       &(tile->tile_reg));
                 }
                 else
                 {
-                    /* lazily only do this if hash wasn't identical */
-                    if (rcode != rgnPART)
-                    {
-                        rdpCopyBox_a8r8g8b8_to_yuvalp(clientCon, x, y,
-                                src, src_stride,
-                                dst, dst_stride,
-                                &rect, 1);
-                    }
-                    clientCon->rfx_crcs[mon_index][crc_offset] = crc;
-                    (*out_rects)[out_rect_index] = rect;
-                    out_rect_index++;
-                    if (out_rect_index >= RDP_MAX_TILES)
-                    {
-                        free(*out_rects);
-                        *out_rects = NULL;
-                        return FALSE;
-                    }
+                    LLOGLN(10, ("rdpCaptureGfxPro: rgnIN"));
                 }
             }
             x += XRDP_RFX_ALIGN;
         }
         y += XRDP_RFX_ALIGN;
     }
+    free(tile_map);
+
+    /* pass 2, hash and convert the tiles, in parallel if there are
+       worker threads */
+    job.tiles = tiles;
+    rdpWorkersRun((struct rdp_workers *) (clientCon->dev->capture_workers),
+                  rdpCaptureGfxProTileProc, &job, num_tiles);
+
+    /* pass 3, on the X main thread, merge the results in tile order
+       the out rects can be as many as the tiles, they are sent in
+       several messages if needed */
+    *out_rects = g_new(BoxRec, RDPMAX(num_tiles, 1));
+    out_rect_index = 0;
+    num_cached = 0;
+    num_solid = 0;
+    clientCon->num_frame_fills = 0;
+    if (job.solid && (num_tiles > clientCon->num_frame_fills_alloc))
+    {
+        free(clientCon->frame_fills);
+        clientCon->frame_fills = g_new(struct rdp_solid_fill, num_tiles);
+        clientCon->num_frame_fills_alloc = num_tiles;
+    }
+    if (job.cache)
+    {
+        rdpTileCacheNewFrame(clientCon->tile_cache);
+        clientCon->tile_cache_ops->num_hits = 0;
+        clientCon->tile_cache_ops->num_stores = 0;
+    }
+    for (index = 0; index < num_tiles; index++)
+    {
+        tile = tiles + index;
+        if (tile->rcode == rgnPART)
+        {
+            rdpRegionUninit(&(tile->tile_reg));
+        }
+        LLOGLN(10, ("rdpCaptureGfxPro: crc 0x%" PRIx64 " 0x%" PRIx64,
+               tile->crc, clientCon->rfx_crcs[mon_index][tile->crc_offset]));
+        if (tile->crc == clientCon->rfx_crcs[mon_index][tile->crc_offset])
+        {
+            LLOGLN(10, ("rdpCaptureGfxPro: crc skip at x %d y %d",
+                   tile->rect.x1, tile->rect.y1));
+        }
+        else
+        {
+            clientCon->rfx_crcs[mon_index][tile->crc_offset] = tile->crc;
+            if (tile->solid)
+            {
+                rdpCaptureGfxProFill(clientCon, tile);
+                num_solid++;
+            }
+            else if (job.cache && rdpCaptureGfxProCache(clientCon, tile))
+            {
+                num_cached++;
+            }
+            else
+            {
+                (*out_rects)[out_rect_index] = tile->rect;
+                out_rect_index++;
+            }
+        }
+    }
+    free(tiles);
+    clientCon->tiles_hashed += num_tiles;
+    clientCon->tiles_skipped += num_tiles - out_rect_index - num_cached -
+                                num_solid;
+    clientCon->tiles_cached += num_cached;
+    clientCon->tiles_solid += num_solid;
+    /* the out rects are in tile order, drop the skipped tiles */
+    rdpRegionIntersectRects(in_reg, *out_rects, out_rect_index);
     *num_out_rects = out_rect_index;
     return TRUE;
 }
@@ -1155,6 +2231,8 @@ rdpCaptureSufA2(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
 {
     BoxPtr psrc_rects;
     BoxRec rect;
+    BoxRec srect;
+    struct capture_blocks blocks;
     int num_rects;
     int index;
     uint8_t *dst_uv;
@@ -1218,6 +2296,14 @@ rdpCaptureSufA2(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
     }
     else if (dst_format == XRDP_nv12)
     {
+        /* the one buffer keeps the unchanged blocks, the grid is even so
+           the chroma of a block is all its own */
+        srect.x1 = clientCon->cap_left & ~1;
+        srect.y1 = clientCon->cap_top & ~1;
+        srect.x2 = (clientCon->cap_left + clientCon->cap_width + 1) & ~1;
+        srect.y2 = (clientCon->cap_top + clientCon->cap_height + 1) & ~1;
+        rdpCaptureSkipBlocks(clientCon, in_reg, &srect, src, src_stride, id,
+                             2, out_rects, num_out_rects, &blocks);
         dst_uv = dst;
         dst_uv += clientCon->cap_width * clientCon->cap_height;
         rdpCopyBox_a8r8g8b8_to_nv12(clientCon,
@@ -1225,7 +2311,14 @@ rdpCaptureSufA2(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
                                     dst, dst_stride,
                                     dst_uv, dst_stride,
                                     0, 0,
-                                    *out_rects, num_rects);
+                                    blocks.conv_rects,
+                                    blocks.num_conv_rects);
+        rdpCaptureFillRows(dst, dst_stride, 1, 0,
+                           blocks.fills, blocks.num_fills);
+        rdpCaptureFillRows(dst_uv, dst_stride, 1, 1,
+                           blocks.fills, blocks.num_fills);
+        free(blocks.conv_rects);
+        free(blocks.fills);
     }
     else
     {
@@ -1243,6 +2336,8 @@ rdpCaptureGfxA2(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
 {
     BoxPtr psrc_rects;
     BoxRec rect;
+    BoxRec srect;
+    struct capture_blocks blocks;
     int num_rects;
     int index;
     uint8_t *dst_uv;
@@ -1311,6 +2406,13 @@ rdpCaptureGfxA2(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
 
     if (dst_format == XRDP_nv12_709fr)
     {
+        /* see rdpCaptureSufA2 */
+        srect.x1 = 0;
+        srect.y1 = 0;
+        srect.x2 = id->width & ~1;
+        srect.y2 = id->height & ~1;
+        rdpCaptureSkipBlocks(clientCon, in_reg, &srect, src, src_stride, id,
+                             2, out_rects, num_out_rects, &blocks);
         dst_uv = dst;
         dst_uv += id->width * id->height;
         rdpCopyBox_a8r8g8b8_to_nv12_709fr(clientCon,
@@ -1318,7 +2420,14 @@ rdpCaptureGfxA2(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
                                           dst, dst_stride,
                                           dst_uv, dst_stride,
                                           0, 0,
-                                          *out_rects, num_rects);
+                                          blocks.conv_rects,
+                                          blocks.num_conv_rects);
+        rdpCaptureFillRows(dst, dst_stride, 1, 0,
+                           blocks.fills, blocks.num_fills);
+        rdpCaptureFillRows(dst_uv, dst_stride, 1, 1,
+                           blocks.fills, blocks.num_fills);
+        free(blocks.conv_rects);
+        free(blocks.fills);
     }
     else
     {
@@ -1440,11 +2549,23 @@ rdpCaptureResetState(rdpClientCon *clientCon)
 {
     int mode;
     int i;
+    RegionRec reg;
 
     LLOGLN(10, ("rdpCapReset:"));
+    /* copies not sent yet are sent as pixels */
+    for (i = 0; i < clientCon->num_copies; i++)
+    {
+        rdpRegionInit(&reg, &(clientCon->copies[i].dst), 0);
+        rdpRegionUnion(clientCon->dirtyRegion, clientCon->dirtyRegion, &reg);
+        rdpRegionUninit(&reg);
+    }
+    clientCon->num_copies = 0;
+    clientCon->num_frame_copies = 0;
+    clientCon->num_frame_fills = 0;
     mode = clientCon->client_info.capture_code;
     switch (mode)
     {
+        case CC_SUF_A16:
         case 2:
         case 4:
             for (i = 0 ; i < 16; ++i)
@@ -1453,6 +2574,23 @@ rdpCaptureResetState(rdpClientCon *clientCon)
                 clientCon->rfx_crcs[i] = NULL;
                 clientCon->num_rfx_crcs_alloc[i] = 0;
                 clientCon->send_key_frame[i] = 1;
+                free(clientCon->row_hashes[i]);
+                clientCon->row_hashes[i] = NULL;
+                clientCon->num_row_hashes_alloc[i] = 0;
+            }
+            if (clientCon->tile_cache != NULL)
+            {
+                rdpTileCacheReset(clientCon->tile_cache);
+            }
+            break;
+        case CC_SUF_A2:
+        case CC_GFX_A2:
+            /* the block hashes, the buffer is new or the client lost it */
+            for (i = 0 ; i < 16; ++i)
+            {
+                free(clientCon->rfx_crcs[i]);
+                clientCon->rfx_crcs[i] = NULL;
+                clientCon->num_rfx_crcs_alloc[i] = 0;
             }
             break;
         default:
@@ -39,11 +39,27 @@ rdpCapture(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
 extern _X_EXPORT void
 rdpCaptureResetState(rdpClientCon *clientCon);
 
+extern _X_EXPORT void
+rdpCaptureInvalidate(rdpClientCon *clientCon, struct image_data *id,
+                     const BoxRec *box);
+
 extern _X_EXPORT int
 a8r8g8b8_to_a8b8g8r8_box(const uint8_t *s8, int src_stride,
                          uint8_t *d8, int dst_stride,
                          int width, int height);
 extern _X_EXPORT int
+a8r8g8b8_to_r5g6b5_box(const uint8_t *s8, int src_stride,
+                       uint8_t *d8, int dst_stride,
+                       int width, int height, const uint8_t *dither);
+extern _X_EXPORT int
+a8r8g8b8_to_a1r5g5b5_box(const uint8_t *s8, int src_stride,
+                         uint8_t *d8, int dst_stride,
+                         int width, int height, const uint8_t *dither);
+extern _X_EXPORT int
+a8r8g8b8_to_r3g3b2_box(const uint8_t *s8, int src_stride,
+                       uint8_t *d8, int dst_stride,
+                       int width, int height, const uint8_t *dither);
+extern _X_EXPORT int
 a8r8g8b8_to_nv12_box(const uint8_t *s8, int src_stride,
                      uint8_t *d8_y, int dst_stride_y,
                      uint8_t *d8_uv, int dst_stride_uv,
@@ -57,5 +73,12 @@ extern _X_EXPORT int
 a8r8g8b8_to_yuvalp_box(const uint8_t *s8, int src_stride,
                        uint8_t *d8, int dst_stride,
                        int width, int height);
+extern _X_EXPORT int
+a8r8g8b8_to_yuvalp_hash_box(const uint8_t *s8, int src_stride,
+                            uint8_t *d8, int dst_stride,
+                            int width, int height, uint64_t *hash);
+extern _X_EXPORT int
+a8r8g8b8_solid_box(const uint8_t *s8, int src_stride,
+                   int width, int height, uint32_t *pixel);
 
 #endif
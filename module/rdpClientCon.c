@@ -26,6 +26,8 @@ Client connection to xrdp
 #endif
 
 #include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,7 +35,10 @@ Client connection to xrdp
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/uio.h>
 #include <limits.h>
+#include <time.h>
+#include <unistd.h>
 
 /* this should be before all X11 .h files */
 #include <xorg-server.h>
@@ -43,6 +48,8 @@ Client connection to xrdp
 #include <xf86.h>
 #include <xf86_OSproc.h>
 
+#include <input.h>
+
 #include "rdp.h"
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
@@ -51,18 +58,63 @@ Client connection to xrdp
 #include "rdpReg.h"
 #include "rdpCapture.h"
 #include "rdpRandR.h"
+#include "rdpWorker.h"
+#include "rdpTileCache.h"
 
 #define LOG_LEVEL 1
 #define LLOGLN(_level, _args) \
     do { if (_level < LOG_LEVEL) { ErrorF _args ; ErrorF("\n"); } } while (0)
 
+/* most dirty or copy rects in one frame message, the message size is 16
+   bit and has to fit in out_s, bigger updates are sent as several frames */
+#define RDP_MAX_MSG_RECTS 1024
+/* most tile cache commands of each kind in one frame message, with the
+   rects and the screen copies they still fit in out_s */
+#define RDP_MAX_MSG_CACHE_OPS 256
+/* most solid fills in one frame message, what is left of out_s */
+#define RDP_MAX_MSG_FILLS 64
+
+/* gfx commands that go in a frame message with the tiles, GfxPro only
+   the copies are done first, then the copies from the tile cache and
+   the solid fills, then the tiles are drawn and copied to the tile
+   cache */
+struct rdp_frame_cmds
+{
+    struct rdp_screen_copy *copies;
+    int num_copies;
+    struct rdp_tile_cache_hit *hits;
+    int num_hits;
+    struct rdp_solid_fill *fills;
+    int num_fills;
+    struct rdp_tile_cache_store *stores;
+    int num_stores;
+};
+
 #define LTOUI32(_in) ((unsigned int)(_in))
 
+/* queued output xrdp does not take is a dead connection */
+#define RDP_OUT_MAX_BYTES (32 * 1024 * 1024)
+/* most queued buffers in one writev */
+#define RDP_OUT_IOV 16
+/* biggest message xrdp sends, client info is a few KB */
+#define RDP_MAX_RECV_MSG (1024 * 1024)
+
+#if XORG_VERSION_CURRENT >= XORG_VERSION_NUMERIC(1, 19, 0, 0, 0)
+/* the server has an input thread, InputThreadRegisterDev */
+#define XRDP_INPUT_THREAD 1
+#endif
+
 #define USE_MAX_OS_BYTES 1
 #define MAX_OS_BYTES (16 * 1024 * 1024)
 
+/* pacing before the first ack, the frame interval then follows the
+   ack round trip within XORGXRDP_MIN_FPS and XORGXRDP_MAX_FPS */
 #define MIN_MS_BETWEEN_FRAMES 40
 #define MIN_MS_TO_WAIT_FOR_MORE_UPDATES 4
+#define DEFAULT_MIN_FPS 10
+#define DEFAULT_MAX_FPS 60
+/* damage this soon after a key or button is sent right away */
+#define DEFAULT_INPUT_BOOST_MS 100
 
 /*
 0 GXclear,        0
@@ -105,14 +157,38 @@ static int g_rdp_opcodes[16] =
 
 static int
 rdpClientConDisconnect(rdpPtr dev, rdpClientCon *clientCon);
+static void
+rdpClientConFreeSharedMemory(rdpClientCon *clientCon);
 static CARD32
 rdpDeferredIdleDisconnectCallback(OsTimerPtr timer, CARD32 now, pointer arg);
 static void
 rdpScheduleDeferredUpdate(rdpClientCon *clientCon);
+static int
+rdpClientConHasUpdate(rdpClientCon *clientCon);
 static void
 rdpClientConProcessClientInfoMonitors(rdpPtr dev, rdpClientCon *clientCon);
 static int
 rdpSendMemoryAllocationComplete(rdpPtr dev, rdpClientCon *clientCon);
+static int
+rdpClientConFlushOut(rdpPtr dev, rdpClientCon *clientCon);
+static void
+rdpClientConFreeOut(rdpClientCon *clientCon);
+#if XORG_VERSION_CURRENT >= XORG_VERSION_NUMERIC(1, 18, 5, 0, 0)
+static void
+rdpClientConGotFd(ScreenPtr pScreen, int fd, int ready);
+#endif
+static int
+rdpClientConInputThreadAdd(ScreenPtr pScreen, rdpPtr dev,
+                           rdpClientCon *clientCon);
+static void
+rdpClientConInputThreadRemove(rdpClientCon *clientCon);
+static void
+rdpClientConLatencyLog(rdpClientCon *clientCon);
+static int
+rdpClientConControlOpen(ScreenPtr pScreen, rdpPtr dev,
+                        rdpClientCon *clientCon);
+static void
+rdpClientConControlClose(rdpPtr dev, rdpClientCon *clientCon);
 
 #if XORG_VERSION_CURRENT < XORG_VERSION_NUMERIC(1, 18, 5, 0, 0)
 
@@ -132,6 +208,40 @@ rdpClientConRemoveEnabledDevice(int fd)
     return 0;
 }
 
+/******************************************************************************/
+static CARD32
+rdpClientConOutTimerCallback(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    rdpClientCon *clientCon = (rdpClientCon *) arg;
+
+    clientCon->out_notify = FALSE;
+    rdpClientConFlushOut(clientCon->dev, clientCon);
+    return 0;
+}
+
+/******************************************************************************/
+/* no write notification in this server, poll the queue from a timer */
+static int
+rdpClientConSetWriteNotify(rdpClientCon *clientCon, int notify)
+{
+    if (notify == clientCon->out_notify)
+    {
+        return 0;
+    }
+    clientCon->out_notify = notify;
+    if (notify)
+    {
+        clientCon->out_timer = TimerSet(clientCon->out_timer, 0, 1,
+                                        rdpClientConOutTimerCallback,
+                                        clientCon);
+    }
+    else if (clientCon->out_timer != NULL)
+    {
+        TimerCancel(clientCon->out_timer);
+    }
+    return 0;
+}
+
 #else
 
 /******************************************************************************/
@@ -139,7 +249,7 @@ static void
 rdpClientConNotifyFdProcPtr(int fd, int ready, void *data)
 {
     ScreenPtr pScreen = (ScreenPtr) data;
-    rdpClientConCheck(pScreen);
+    rdpClientConGotFd(pScreen, fd, ready);
 }
 
 /******************************************************************************/
@@ -158,6 +268,55 @@ rdpClientConRemoveEnabledDevice(int fd)
     return 0;
 }
 
+/******************************************************************************/
+/* ask the server to tell us when the socket can take more
+   with input_thread, InputThreadRegisterDev owns sck, a server running
+   without an input thread puts its own read notify on it, so write
+   notify goes on a dup of sck that does not replace that */
+static int
+rdpClientConSetWriteNotify(rdpClientCon *clientCon, int notify)
+{
+    int mask;
+
+    if (notify == clientCon->out_notify)
+    {
+        return 0;
+    }
+    if (clientCon->input_thread)
+    {
+        if (clientCon->out_notify_sck < 0)
+        {
+            clientCon->out_notify_sck = dup(clientCon->sck);
+            if (clientCon->out_notify_sck < 0)
+            {
+                LLOGLN(0, ("rdpClientConSetWriteNotify: dup failed"));
+                return 1;
+            }
+        }
+        clientCon->out_notify = notify;
+        if (notify)
+        {
+            SetNotifyFd(clientCon->out_notify_sck,
+                        rdpClientConNotifyFdProcPtr, X_NOTIFY_WRITE,
+                        clientCon->dev->pScreen);
+        }
+        else
+        {
+            RemoveNotifyFd(clientCon->out_notify_sck);
+        }
+        return 0;
+    }
+    clientCon->out_notify = notify;
+    mask = X_NOTIFY_READ;
+    if (notify)
+    {
+        mask |= X_NOTIFY_WRITE;
+    }
+    SetNotifyFd(clientCon->sck, rdpClientConNotifyFdProcPtr, mask,
+                clientCon->dev->pScreen);
+    return 0;
+}
+
 #endif
 
 /******************************************************************************/
@@ -221,8 +380,10 @@ rdpClientConGotConnection(ScreenPtr pScreen, rdpPtr dev)
     clientCon = g_new0(rdpClientCon, 1);
     clientCon->shmemstatus = SHM_UNINITIALIZED;
     clientCon->updateRetries = 0;
+    clientCon->frameInterval = MIN_MS_BETWEEN_FRAMES;
+    clientCon->coalesceDelay = MIN_MS_TO_WAIT_FOR_MORE_UPDATES;
     clientCon->dev = dev;
-    clientCon->shmemfd = -1;
+    clientCon->out_notify_sck = -1;
     dev->last_event_time_ms = GetTimeInMillis();
     dev->do_dirty_ons = 1;
 
@@ -247,7 +408,11 @@ rdpClientConGotConnection(ScreenPtr pScreen, rdpPtr dev)
         clientCon->begin = FALSE;
         dev->conNumber++;
         clientCon->conNumber = dev->conNumber;
-        rdpClientConAddEnabledDevice(pScreen, clientCon->sck);
+        if (rdpClientConInputThreadAdd(pScreen, dev, clientCon) != 0)
+        {
+            rdpClientConAddEnabledDevice(pScreen, clientCon->sck);
+        }
+        rdpClientConControlOpen(pScreen, dev, clientCon);
     }
 
 #if 1
@@ -391,8 +556,17 @@ rdpClientConDisconnect(rdpPtr dev, rdpClientCon *clientCon)
         dev->disconnect_time_ms = GetTimeInMillis();
     }
 
+    rdpClientConLatencyLog(clientCon);
+    rdpClientConControlClose(dev, clientCon);
+    rdpClientConInputThreadRemove(clientCon);
     rdpClientConRemoveEnabledDevice(clientCon->sck);
     g_sck_close(clientCon->sck);
+    if (clientCon->out_notify_sck >= 0)
+    {
+        rdpClientConRemoveEnabledDevice(clientCon->out_notify_sck);
+        close(clientCon->out_notify_sck);
+        clientCon->out_notify_sck = -1;
+    }
     if (clientCon->maxOsBitmaps > 0)
     {
         for (index = 0; index < clientCon->maxOsBitmaps; index++)
@@ -417,25 +591,212 @@ rdpClientConDisconnect(rdpPtr dev, rdpClientCon *clientCon)
         TimerCancel(clientCon->updateTimer);
         TimerFree(clientCon->updateTimer);
     }
+    if (clientCon->out_timer != NULL)
+    {
+        TimerCancel(clientCon->out_timer);
+        TimerFree(clientCon->out_timer);
+    }
+    rdpClientConFreeOut(clientCon);
+    free(clientCon->recv_data);
     free_stream(clientCon->out_s);
     free_stream(clientCon->in_s);
-    if (clientCon->shmemptr != NULL)
+    rdpClientConFreeSharedMemory(clientCon);
+    rdpTileCacheDestroy(clientCon->tile_cache);
+    free(clientCon->tile_cache_ops);
+    for (index = 0; index < 16; index++)
     {
-        g_free_unmap_fd(clientCon->shmemptr,
-                        clientCon->shmemfd,
-                        clientCon->shmem_bytes);
+        free(clientCon->row_hashes[index]);
     }
+    free(clientCon->frame_fills);
     free(clientCon);
     return 0;
 }
 
 /*****************************************************************************/
-/* returns error */
+static void
+rdpClientConFreeOut(rdpClientCon *clientCon)
+{
+    struct rdp_out_buf *buf;
+    int index;
+
+    while (clientCon->out_head != NULL)
+    {
+        buf = clientCon->out_head;
+        clientCon->out_head = buf->next;
+        for (index = 0; index < buf->num_fds; index++)
+        {
+            close(buf->fds[index]);
+        }
+        free(buf);
+    }
+    clientCon->out_tail = NULL;
+    clientCon->out_bytes = 0;
+}
+
+/*****************************************************************************/
+/* append to the output queue, fds are duplicated because the caller
+   may close them before they go out, returns error */
+static int
+rdpClientConQueueOut(rdpPtr dev, rdpClientCon *clientCon,
+                     const char *data, int len, const int *fds, int num_fds)
+{
+    struct rdp_out_buf *buf;
+    int index;
+
+    if (clientCon->out_bytes + len > RDP_OUT_MAX_BYTES)
+    {
+        LLOGLN(0, ("rdpClientConQueueOut: xrdp is not reading, %d bytes "
+               "queued, disconnecting", clientCon->out_bytes));
+        clientCon->connected = FALSE;
+        return 1;
+    }
+    buf = (struct rdp_out_buf *) malloc(sizeof(struct rdp_out_buf) + len);
+    if (buf == NULL)
+    {
+        LLOGLN(0, ("rdpClientConQueueOut: malloc failed"));
+        clientCon->connected = FALSE;
+        return 1;
+    }
+    buf->next = NULL;
+    buf->data = (char *) (buf + 1);
+    memcpy(buf->data, data, len);
+    buf->len = len;
+    buf->offset = 0;
+    buf->num_fds = 0;
+    for (index = 0; index < num_fds; index++)
+    {
+        buf->fds[index] = dup(fds[index]);
+        if (buf->fds[index] == -1)
+        {
+            LLOGLN(0, ("rdpClientConQueueOut: dup failed"));
+            break;
+        }
+        buf->num_fds++;
+    }
+    if (clientCon->out_tail == NULL)
+    {
+        clientCon->out_head = buf;
+    }
+    else
+    {
+        clientCon->out_tail->next = buf;
+    }
+    clientCon->out_tail = buf;
+    clientCon->out_bytes += len;
+    rdpClientConSetWriteNotify(clientCon, TRUE);
+    return 0;
+}
+
+/*****************************************************************************/
+/* drop sent bytes from the head of the output queue */
+static void
+rdpClientConConsumeOut(rdpClientCon *clientCon, int sent)
+{
+    struct rdp_out_buf *buf;
+    int index;
+    int bytes;
+
+    while ((sent > 0) && (clientCon->out_head != NULL))
+    {
+        buf = clientCon->out_head;
+        /* the fds went with the first byte */
+        for (index = 0; index < buf->num_fds; index++)
+        {
+            close(buf->fds[index]);
+        }
+        buf->num_fds = 0;
+        bytes = RDPMIN(sent, buf->len - buf->offset);
+        buf->offset += bytes;
+        clientCon->out_bytes -= bytes;
+        sent -= bytes;
+        if (buf->offset < buf->len)
+        {
+            break;
+        }
+        clientCon->out_head = buf->next;
+        if (clientCon->out_head == NULL)
+        {
+            clientCon->out_tail = NULL;
+        }
+        free(buf);
+    }
+}
+
+/*****************************************************************************/
+/* send as much of the output queue as the socket takes, called when
+   the socket is writable, never waits, returns error */
+static int
+rdpClientConFlushOut(rdpPtr dev, rdpClientCon *clientCon)
+{
+    struct rdp_out_buf *buf;
+    struct iovec iov[RDP_OUT_IOV];
+    int count;
+    int sent;
+
+    while (clientCon->connected && (clientCon->out_head != NULL))
+    {
+        buf = clientCon->out_head;
+        if (buf->num_fds > 0)
+        {
+            /* one sendmsg per fd set so the fds stay on their byte */
+            sent = g_sck_send_fd_set(clientCon->sck, buf->data, buf->len,
+                                     buf->fds, buf->num_fds);
+        }
+        else
+        {
+            count = 0;
+            while ((buf != NULL) && (buf->num_fds == 0) &&
+                   (count < RDP_OUT_IOV))
+            {
+                iov[count].iov_base = buf->data + buf->offset;
+                iov[count].iov_len = buf->len - buf->offset;
+                count++;
+                buf = buf->next;
+            }
+            sent = g_sck_writev(clientCon->sck, iov, count);
+        }
+        if (sent == -1)
+        {
+            if (g_sck_last_error_would_block(clientCon->sck))
+            {
+                break;
+            }
+            LLOGLN(0, ("rdpClientConFlushOut: send failed"));
+            clientCon->connected = FALSE;
+            return 1;
+        }
+        if (sent == 0)
+        {
+            LLOGLN(0, ("rdpClientConFlushOut: send failed(returned zero)"));
+            clientCon->connected = FALSE;
+            return 1;
+        }
+        rdpClientConConsumeOut(clientCon, sent);
+    }
+    if (!clientCon->connected)
+    {
+        return 1;
+    }
+    if (clientCon->out_head != NULL)
+    {
+        rdpClientConSetWriteNotify(clientCon, TRUE);
+        return 0;
+    }
+    rdpClientConSetWriteNotify(clientCon, FALSE);
+    /* capture was held back while the queue was not empty */
+    if (rdpClientConHasUpdate(clientCon))
+    {
+        rdpScheduleDeferredUpdate(clientCon);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* returns error, whatever the socket does not take now is queued */
 static int
 rdpClientConSend(rdpPtr dev, rdpClientCon *clientCon, const char *data, int len)
 {
     int sent;
-    int retries = 0;
 
     LLOGLN(10, ("rdpClientConSend - sending %d bytes", len));
 
@@ -444,44 +805,73 @@ rdpClientConSend(rdpPtr dev, rdpClientCon *clientCon, const char *data, int len)
         return 1;
     }
 
-    while (len > 0)
+    if (clientCon->out_head == NULL)
     {
         sent = g_sck_send(clientCon->sck, data, len, 0);
-
         if (sent == -1)
         {
-            if (g_sck_last_error_would_block(clientCon->sck))
-            {
-                // Just because we couldn't after 100 retries
-                // does not mean we're disconnected.
-                if (retries > 100)
-                {
-                    return 0;
-                }
-                ++retries;
-                g_sleep(1);
-            }
-            else
+            if (!g_sck_last_error_would_block(clientCon->sck))
             {
                 LLOGLN(0, ("rdpClientConSend: g_tcp_send failed(returned -1)"));
                 clientCon->connected = FALSE;
                 return 1;
             }
+            sent = 0;
         }
-        else if (sent == 0)
+        else if (sent == 0 && len > 0)
         {
             LLOGLN(0, ("rdpClientConSend: g_tcp_send failed(returned zero)"));
             clientCon->connected = FALSE;
             return 1;
         }
+        data += sent;
+        len -= sent;
+    }
+    if (len > 0)
+    {
+        return rdpClientConQueueOut(dev, clientCon, data, len, NULL, 0);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* pass fds to xrdp, they go with a 4 byte "int" payload after the
+   message that refers to them, returns error */
+static int
+rdpClientConSendFds(rdpPtr dev, rdpClientCon *clientCon,
+                    const int *fds, int num_fds)
+{
+    int sent;
+
+    if (!clientCon->connected)
+    {
+        return 1;
+    }
+    if (clientCon->out_head == NULL)
+    {
+        sent = g_sck_send_fd_set(clientCon->sck, "int", 4,
+                                 (int *) fds, num_fds);
+        if (sent == -1)
+        {
+            if (!g_sck_last_error_would_block(clientCon->sck))
+            {
+                LLOGLN(0, ("rdpClientConSendFds: g_sck_send_fd_set failed"));
+                clientCon->connected = FALSE;
+                return 1;
+            }
+        }
+        else if (sent < 4)
+        {
+            /* the fds went with the first byte */
+            return rdpClientConQueueOut(dev, clientCon, "int" + sent,
+                                        4 - sent, NULL, 0);
+        }
         else
         {
-            data += sent;
-            len -= sent;
+            return 0;
         }
     }
-
-    return 0;
+    return rdpClientConQueueOut(dev, clientCon, "int", 4, fds, num_fds);
 }
 
 /******************************************************************************/
@@ -545,89 +935,87 @@ rdpClientConSendPending(rdpPtr dev, rdpClientCon *clientCon)
 }
 
 /******************************************************************************/
-/* returns error */
+/* one non blocking read into the receive buffer, returns error, the
+   caller drops the connection, it runs on the input thread too
+   *more is set when the buffer got filled and the socket may have more */
 static int
-rdpClientConRecv(rdpPtr dev, rdpClientCon *clientCon, char *data, int len)
+rdpClientConRecv(rdpPtr dev, rdpClientCon *clientCon, int *more)
 {
+    char *data;
     int rcvd;
+    int size;
 
-    if (!clientCon->connected)
-    {
-        return 1;
-    }
-
-    while (len > 0)
+    *more = FALSE;
+    if (clientCon->recv_bytes == clientCon->recv_size)
     {
-        rcvd = g_sck_recv(clientCon->sck, data, len, 0);
-
-        if (rcvd == -1)
-        {
-            if (g_sck_last_error_would_block(clientCon->sck))
-            {
-                g_sleep(1);
-            }
-            else
-            {
-                LLOGLN(0, ("rdpClientConRecv: g_sck_recv failed(returned -1)"));
-                clientCon->connected = FALSE;
-                return 1;
-            }
-        }
-        else if (rcvd == 0)
+        /* what is left after parsing is part of one message so this
+           stays below twice the biggest message */
+        size = RDPMAX(clientCon->recv_size * 2, 8192);
+        data = (char *) realloc(clientCon->recv_data, size);
+        if (data == NULL)
         {
-            LLOGLN(0, ("rdpClientConRecv: g_sck_recv failed(returned 0)"));
-            clientCon->connected = FALSE;
+            LLOGLN(0, ("rdpClientConRecv: realloc failed"));
             return 1;
         }
-        else
+        clientCon->recv_data = data;
+        clientCon->recv_size = size;
+    }
+    rcvd = g_sck_recv(clientCon->sck,
+                      clientCon->recv_data + clientCon->recv_bytes,
+                      clientCon->recv_size - clientCon->recv_bytes, 0);
+    if (rcvd == -1)
+    {
+        if (g_sck_last_error_would_block(clientCon->sck))
         {
-            data += rcvd;
-            len -= rcvd;
+            return 0;
         }
+        LLOGLN(0, ("rdpClientConRecv: g_sck_recv failed(returned -1)"));
+        return 1;
     }
-
+    if (rcvd == 0)
+    {
+        LLOGLN(0, ("rdpClientConRecv: g_sck_recv failed(returned 0)"));
+        return 1;
+    }
+    clientCon->recv_bytes += rcvd;
+    *more = clientCon->recv_bytes == clientCon->recv_size;
     return 0;
 }
 
 /******************************************************************************/
+/* length of the message at data if it has all arrived, 0 if not and
+   -1 on a bad length */
 static int
-rdpClientConRecvMsg(rdpPtr dev, rdpClientCon *clientCon)
+rdpClientConMsgLen(const char *data, int bytes)
 {
     int len;
-    int rv;
-    struct stream *s;
-
-    rv = 1;
 
-    s = clientCon->in_s;
-    if (s != 0)
+    if (bytes < 4)
     {
-        init_stream(s, 4);
-        rv = rdpClientConRecv(dev, clientCon, s->data, 4);
-
-        if (rv == 0)
-        {
-            s->end = s->data + 4;
-            in_uint32_le(s, len);
-
-            if (len > 3)
-            {
-                init_stream(s, len);
-                rv = rdpClientConRecv(dev, clientCon, s->data, len - 4);
-                if (rv == 0)
-                {
-                    s->end = s->data + len;
-                }
-            }
-        }
+        return 0;
     }
-
-    if (rv != 0)
+    len = (data[0] & 0xff) | ((data[1] & 0xff) << 8) |
+          ((data[2] & 0xff) << 16) | ((data[3] & 0xff) << 24);
+    if ((len < 4) || (len > RDP_MAX_RECV_MSG))
     {
-        LLOGLN(0, ("rdpClientConRecvMsg: error"));
+        LLOGLN(0, ("rdpClientConMsgLen: bad message length %d", len));
+        return -1;
+    }
+    if (bytes < len)
+    {
+        return 0;
     }
+    return len;
+}
 
-    return rv;
+/******************************************************************************/
+/* copy the body of a complete message to s for parsing */
+static void
+rdpClientConInitInMsg(struct stream *s, const char *data, int len)
+{
+    init_stream(s, len);
+    memcpy(s->data, data + 4, len - 4);
+    s->end = s->data + (len - 4);
 }
 
 /******************************************************************************/
@@ -659,13 +1047,41 @@ rdpClientConSendCaps(rdpPtr dev, rdpClientCon *clientCon)
     cap_bytes += 4;
 #endif
 
-    s_mark_end(ls);
-    len = (int)(ls->end - ls->data);
-    s_pop_layer(ls, iso_hdr);
-    out_uint16_le(ls, 2); /* caps */
-    out_uint16_le(ls, cap_count); /* num caps */
-    out_uint32_le(ls, cap_bytes); /* caps len after header */
-
+    /* shared memory buffers can be registered once, xrdp that knows
+       about this answers with msg 109 */
+    out_uint16_le(ls, 2);
+    out_uint16_le(ls, 4);
+    cap_count++;
+    cap_bytes += 4;
+
+    /* gfx frames can copy tiles to and from the client's cache, xrdp
+       that knows about this answers with msg 110 */
+    out_uint16_le(ls, 3);
+    out_uint16_le(ls, 4);
+    cap_count++;
+    cap_bytes += 4;
+
+    /* gfx frames can copy rects within the client's surface, xrdp that
+       knows about this answers with msg 111 */
+    out_uint16_le(ls, 4);
+    out_uint16_le(ls, 4);
+    cap_count++;
+    cap_bytes += 4;
+
+    /* gfx frames can fill rects with one colour, xrdp that knows about
+       this answers with msg 112 */
+    out_uint16_le(ls, 5);
+    out_uint16_le(ls, 4);
+    cap_count++;
+    cap_bytes += 4;
+
+    s_mark_end(ls);
+    len = (int)(ls->end - ls->data);
+    s_pop_layer(ls, iso_hdr);
+    out_uint16_le(ls, 2); /* caps */
+    out_uint16_le(ls, cap_count); /* num caps */
+    out_uint32_le(ls, cap_bytes); /* caps len after header */
+
     rv = rdpClientConSend(dev, clientCon, ls->data, len);
 
     if (rv != 0)
@@ -693,48 +1109,99 @@ rdpClientConProcessMsgVersion(rdpPtr dev, rdpClientCon *clientCon,
     return 0;
 }
 
+/******************************************************************************/
+static void
+rdpClientConFreeSharedMemory(rdpClientCon *clientCon)
+{
+    int index;
+    struct rdp_shm_buffer *buffer;
+
+    for (index = 0; index < clientCon->num_shm_buffers; index++)
+    {
+        buffer = clientCon->shm_buffers + index;
+        if (buffer->ptr != NULL)
+        {
+            g_free_unmap_fd(buffer->ptr, buffer->fd, clientCon->shmem_bytes);
+        }
+        buffer->ptr = NULL;
+        buffer->fd = -1;
+        buffer->rect_id = 0;
+    }
+    clientCon->num_shm_buffers = 0;
+    clientCon->shm_buffer_index = 0;
+    clientCon->shmem_bytes = 0;
+    clientCon->shm_buffers_registered = FALSE;
+}
+
 /**************************************************************************//**
  * Allocate shared memory
  *
  * This memory is shared with the xup driver in xrdp which avoids a lot
  * of unnecessary copying
  *
+ * There is a ring of num_buffers areas so a frame can be captured while
+ * xrdp is still encoding the one before
+ *
  * @param clientCon Client connection
- * @param bytes Size of area to attach
+ * @param bytes Size of each area to attach
+ * @param num_buffers Number of areas
  */
 static void
-rdpClientConAllocateSharedMemory(rdpClientCon *clientCon, int bytes)
+rdpClientConAllocateSharedMemory(rdpClientCon *clientCon, int bytes,
+                                 int num_buffers)
 {
     void *shmemptr;
     int shmemfd;
+    int index;
 
-    if (clientCon->shmemptr != NULL && clientCon->shmem_bytes == bytes)
+    num_buffers = RDPCLAMP(num_buffers, 1, RDP_MAX_SHM_BUFFERS);
+    if (clientCon->num_shm_buffers == num_buffers &&
+        clientCon->shmem_bytes == bytes)
     {
-        LLOGLN(0, ("rdpClientConAllocateSharedMemory: reusing shmemfd %d",
-               clientCon->shmemfd));
+        LLOGLN(0, ("rdpClientConAllocateSharedMemory: reusing %d buffers",
+               num_buffers));
         return;
     }
-    if (clientCon->shmemptr != NULL)
+    /* xrdp has its own mapping of any buffer still in flight */
+    rdpClientConFreeSharedMemory(clientCon);
+    for (index = 0; index < num_buffers; index++)
     {
-        g_free_unmap_fd(clientCon->shmemptr,
-                        clientCon->shmemfd,
-                        clientCon->shmem_bytes);
-        clientCon->shmemptr = NULL;
-        clientCon->shmemfd = -1;
-        clientCon->shmem_bytes = 0;
+        if (g_alloc_shm_map_fd(&shmemptr, &shmemfd, bytes) != 0)
+        {
+            LLOGLN(0, ("rdpClientConAllocateSharedMemory: g_alloc_shm_map_fd "
+                   "failed"));
+            break;
+        }
+        clientCon->shm_buffers[index].ptr = (uint8_t *) shmemptr;
+        clientCon->shm_buffers[index].fd = shmemfd;
+        clientCon->shm_buffers[index].rect_id = 0;
+        clientCon->num_shm_buffers++;
+        LLOGLN(0, ("rdpClientConAllocateSharedMemory: index %d shmemfd %d "
+               "shmemptr %p bytes %d", index, shmemfd, shmemptr, bytes));
     }
-    if (g_alloc_shm_map_fd(&shmemptr, &shmemfd, bytes) != 0)
+    clientCon->shmem_bytes = bytes;
+    clientCon->shm_buffer_index = 0;
+}
+
+/******************************************************************************/
+/* returns the index of a shared memory buffer xrdp is done with or -1
+   if all are still in flight, starts looking after the one used last */
+static int
+rdpClientConGetFreeShmBuffer(rdpClientCon *clientCon)
+{
+    int index;
+    int jndex;
+
+    for (jndex = 0; jndex < clientCon->num_shm_buffers; jndex++)
     {
-        LLOGLN(0, ("rdpClientConAllocateSharedMemory: g_alloc_shm_map_fd "
-               "failed"));
+        index = (clientCon->shm_buffer_index + jndex) %
+                clientCon->num_shm_buffers;
+        if (clientCon->shm_buffers[index].rect_id <= clientCon->rect_id_ack)
+        {
+            return index;
+        }
     }
-    clientCon->shmemptr = shmemptr;
-    clientCon->shmemfd = shmemfd;
-    clientCon->shmem_bytes = bytes;
-    LLOGLN(0, ("rdpClientConAllocateSharedMemory: shmemfd %d shmemptr %p "
-            "bytes %d",
-            clientCon->shmemfd, clientCon->shmemptr,
-            clientCon->shmem_bytes));
+    return -1;
 }
 
 /******************************************************************************/
@@ -769,6 +1236,7 @@ static void
 rdpClientConResizeAllMemoryAreas(rdpPtr dev, rdpClientCon *clientCon)
 {
     int bytes;
+    int num_buffers;
     int width = clientCon->client_info.display_sizes.session_width;
     int height = clientCon->client_info.display_sizes.session_height;
 
@@ -820,7 +1288,19 @@ rdpClientConResizeAllMemoryAreas(rdpPtr dev, rdpClientCon *clientCon)
         clientCon->cap_stride_bytes = clientCon->cap_width * clientCon->rdp_Bpp;
         shmemstatus = SHM_ACTIVE_PENDING;
     }
-    rdpClientConAllocateSharedMemory(clientCon, bytes);
+    /* the h264 encoders read the whole frame from the buffer so they
+       can only have one, the others only read the rects sent */
+    num_buffers = dev->shm_buffers;
+    if (num_buffers < 1)
+    {
+        /* without registration xrdp maps the buffer for every frame */
+        num_buffers = clientCon->shm_buffer_reg ? 2 : 1;
+    }
+    if (shmemstatus == SHM_H264_ACTIVE_PENDING)
+    {
+        num_buffers = 1;
+    }
+    rdpClientConAllocateSharedMemory(clientCon, bytes, num_buffers);
 
     if (clientCon->client_info.capture_format != 0)
     {
@@ -949,11 +1429,23 @@ rdpClientConProcessMsgClientInput(rdpPtr dev, rdpClientCon *clientCon)
 
     if (msg < 100)
     {
+#if defined(XRDP_INPUT_THREAD)
+        input_lock();
+#endif
         rdpInputKeyboardEvent(dev, msg, param1, param2, param3, param4);
+#if defined(XRDP_INPUT_THREAD)
+        input_unlock();
+#endif
     }
     else if (msg < 200)
     {
+#if defined(XRDP_INPUT_THREAD)
+        input_lock();
+#endif
         rdpInputMouseEvent(dev, msg, param1, param2, param3, param4);
+#if defined(XRDP_INPUT_THREAD)
+        input_unlock();
+#endif
     }
     else if (msg == 200) /* invalidate */
     {
@@ -963,6 +1455,8 @@ rdpClientConProcessMsgClientInput(rdpPtr dev, rdpClientCon *clientCon)
         cy = param2 & 0xffff;
         LLOGLN(0, ("rdpClientConProcessMsgClientInput: invalidate x %d y %d "
                "cx %d cy %d", x, y, cx, cy));
+        /* the client wants the pixels again, forget what was sent */
+        rdpCaptureResetState(clientCon);
         rdpClientConAddDirtyScreen(dev, clientCon, x, y, cx, cy);
     }
     else if (msg == 300) /* resize desktop */
@@ -1216,8 +1710,14 @@ rdpClientConProcessMsgClientInfo(rdpPtr dev, rdpClientCon *clientCon)
     }
 
     /* rdpLoadLayout */
+#if defined(XRDP_INPUT_THREAD)
+    input_lock();
+#endif
     rdpInputKeyboardEvent(dev, 18, (long)(&(clientCon->client_info)),
                           0, 0, 0);
+#if defined(XRDP_INPUT_THREAD)
+    input_unlock();
+#endif
 
     rdpSendMemoryAllocationComplete(dev, clientCon);
     rdpClientConAddDirtyScreen(dev, clientCon, 0, 0, clientCon->rdp_width,
@@ -1226,6 +1726,189 @@ rdpClientConProcessMsgClientInfo(rdpPtr dev, rdpClientCon *clientCon)
     return 0;
 }
 
+/******************************************************************************/
+/* remember when frame rect_id went out */
+static void
+rdpClientConPaceSent(rdpClientCon *clientCon, int rect_id)
+{
+    struct rdp_pace_slot *slot;
+
+    slot = clientCon->pace_slots +
+           ((unsigned int) rect_id % RDP_PACE_SLOTS);
+    slot->rect_id = rect_id;
+    slot->send_time = GetTimeInMillis();
+    slot->times = clientCon->frame_times;
+    slot->times.send = g_time_usec();
+}
+
+/******************************************************************************/
+static void
+rdpHistAdd(struct rdp_hist *hist, uint64_t value)
+{
+    unsigned int val;
+    int bucket;
+
+    val = value > UINT_MAX ? UINT_MAX : (unsigned int) value;
+    bucket = 0;
+    while ((bucket < RDP_HIST_BUCKETS - 1) && ((val >> (bucket + 1)) != 0))
+    {
+        bucket++;
+    }
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->sum += val;
+    hist->max = RDPMAX(hist->max, val);
+}
+
+/******************************************************************************/
+/* upper bound of the bucket that holds the pct percentile, 0 if empty */
+unsigned int
+rdpHistPercentile(const struct rdp_hist *hist, int pct)
+{
+    unsigned int want;
+    unsigned int seen;
+    int bucket;
+
+    if (hist->count == 0)
+    {
+        return 0;
+    }
+    want = (unsigned int) (((uint64_t) hist->count * pct + 99) / 100);
+    want = RDPMAX(want, 1);
+    seen = 0;
+    for (bucket = 0; bucket < RDP_HIST_BUCKETS; bucket++)
+    {
+        seen += hist->buckets[bucket];
+        if (seen >= want)
+        {
+            break;
+        }
+    }
+    if (bucket >= RDP_HIST_BUCKETS - 1)
+    {
+        return hist->max;
+    }
+    return RDPMIN((2u << bucket) - 1, hist->max);
+}
+
+/******************************************************************************/
+static uint64_t
+rdpTimeDiff(uint64_t later, uint64_t earlier)
+{
+    return later > earlier ? later - earlier : 0;
+}
+
+/******************************************************************************/
+/* the frame in slot was acked, add its times to the histograms */
+static void
+rdpClientConLatencyAck(rdpClientCon *clientCon, struct rdp_pace_slot *slot)
+{
+    struct rdp_frame_times *times;
+    struct rdp_hist *lat;
+    uint64_t now;
+    CARD32 now_ms;
+
+    times = &(slot->times);
+    lat = clientCon->latency;
+    now = g_time_usec();
+    if (times->damage != 0)
+    {
+        rdpHistAdd(lat + RDP_LAT_QUEUE,
+                   rdpTimeDiff(times->capture_start, times->damage));
+        rdpHistAdd(lat + RDP_LAT_TOTAL, rdpTimeDiff(now, times->damage));
+    }
+    rdpHistAdd(lat + RDP_LAT_CAPTURE,
+               rdpTimeDiff(times->capture_end, times->capture_start));
+    rdpHistAdd(lat + RDP_LAT_SEND,
+               rdpTimeDiff(times->send, times->capture_end));
+    rdpHistAdd(lat + RDP_LAT_ACK, rdpTimeDiff(now, times->send));
+    if (times->input_ms != 0)
+    {
+        /* input times are server milliseconds */
+        now_ms = GetTimeInMillis();
+        rdpHistAdd(lat + RDP_LAT_INPUT,
+                   (uint64_t) (now_ms - times->input_ms) * 1000);
+    }
+}
+
+/******************************************************************************/
+static void
+rdpClientConLatencyLog(rdpClientCon *clientCon)
+{
+    static const char *names[RDP_LAT_COUNT] =
+    {
+        "queue", "capture", "send", "ack", "total", "input"
+    };
+    struct rdp_hist *hist;
+    int index;
+
+    for (index = 0; index < RDP_LAT_COUNT; index++)
+    {
+        hist = clientCon->latency + index;
+        if (hist->count == 0)
+        {
+            continue;
+        }
+        LLOGLN(0, ("rdpClientConLatencyLog: %s us count %u avg %u "
+               "p50 %u p90 %u p99 %u max %u", names[index], hist->count,
+               (unsigned int) (hist->sum / hist->count),
+               rdpHistPercentile(hist, 50), rdpHistPercentile(hist, 90),
+               rdpHistPercentile(hist, 99), hist->max));
+    }
+}
+
+/******************************************************************************/
+/* rect_id_ack was just received, update the round trip estimate and
+   derive the frame interval and coalescing delay from it
+   the round trip covers capture to ack, that is encode, network and
+   client decode, with n buffers n frames can be in that pipe at once */
+static void
+rdpClientConPaceAck(rdpPtr dev, rdpClientCon *clientCon)
+{
+    struct rdp_pace_slot *slot;
+    int rtt;
+    int err;
+    int budget;
+    int min_ms;
+    int max_ms;
+
+    slot = clientCon->pace_slots +
+           ((unsigned int) clientCon->rect_id_ack % RDP_PACE_SLOTS);
+    if ((clientCon->rect_id_ack < 1) ||
+        (slot->rect_id != clientCon->rect_id_ack))
+    {
+        return;
+    }
+    slot->rect_id = 0;
+    rdpClientConLatencyAck(clientCon, slot);
+    rtt = (int) (GetTimeInMillis() - slot->send_time);
+    rtt = RDPMAX(rtt, 0);
+    if (clientCon->srtt8 == 0)
+    {
+        clientCon->srtt8 = RDPMAX(rtt, 1) * 8;
+        clientCon->rttvar4 = rtt * 2;
+    }
+    else
+    {
+        /* same gains as the tcp retransmit timer, 1/8 and 1/4 */
+        err = rtt - (clientCon->srtt8 >> 3);
+        clientCon->srtt8 = RDPMAX(clientCon->srtt8 + err, 1);
+        err = RDPMAX(err, -err);
+        clientCon->rttvar4 += err - (clientCon->rttvar4 >> 2);
+    }
+    budget = (clientCon->srtt8 >> 3) + (clientCon->rttvar4 >> 2);
+    budget /= RDPMAX(clientCon->num_shm_buffers, 1);
+    min_ms = 1000 / dev->max_fps;
+    max_ms = 1000 / dev->min_fps;
+    clientCon->frameInterval = RDPCLAMP(budget, min_ms, max_ms);
+    clientCon->coalesceDelay = RDPCLAMP(clientCon->frameInterval / 8, 1,
+                                        MIN_MS_TO_WAIT_FOR_MORE_UPDATES);
+    LLOGLN(10, ("rdpClientConPaceAck: rtt %d srtt %d rttvar %d "
+           "frameInterval %d coalesceDelay %d", rtt,
+           clientCon->srtt8 >> 3, clientCon->rttvar4 >> 2,
+           clientCon->frameInterval, clientCon->coalesceDelay));
+}
+
 /******************************************************************************/
 static int
 rdpClientConProcessMsgClientRegion(rdpPtr dev, rdpClientCon *clientCon)
@@ -1263,6 +1946,7 @@ rdpClientConProcessMsgClientRegion(rdpPtr dev, rdpClientCon *clientCon)
            box.x1, box.y1, box.x2, box.y2));
     rdpRegionSubtract(clientCon->shmRegion, clientCon->shmRegion, &reg);
     rdpRegionUninit(&reg);
+    rdpClientConPaceAck(dev, clientCon);
     rdpScheduleDeferredUpdate(clientCon);
     return 0;
 }
@@ -1284,6 +1968,10 @@ rdpClientConProcessMsgClientRegionEx(rdpPtr dev, rdpClientCon *clientCon)
         // Client just wishes to ack all in-flight frames
         clientCon->rect_id_ack = clientCon->rect_id;
     }
+    else
+    {
+        rdpClientConPaceAck(dev, clientCon);
+    }
     LLOGLN(10, ("rdpClientConProcessMsgClientRegionEx: flags 0x%8.8x", flags));
     LLOGLN(10, ("rdpClientConProcessMsgClientRegionEx: rect_id %d "
            "rect_id_ack %d", clientCon->rect_id, clientCon->rect_id_ack));
@@ -1314,12 +2002,84 @@ rdpClientConProcessMsgClientSuppressOutput(rdpPtr dev, rdpClientCon *clientCon)
     clientCon->suppress_output = suppress;
     if (suppress == 0)
     {
+        rdpCaptureResetState(clientCon);
         rdpClientConAddDirtyScreen(dev, clientCon, left, top,
                                    right - left, bottom - top);
     }
     return 0;
 }
 
+/******************************************************************************/
+/* xrdp can take shared memory buffers registered once, sent in answer
+   to cap 2 */
+static int
+rdpClientConProcessMsgClientShmBufferReg(rdpPtr dev, rdpClientCon *clientCon)
+{
+    LLOGLN(0, ("rdpClientConProcessMsgClientShmBufferReg: xrdp supports "
+           "shared memory buffer registration"));
+    clientCon->shm_buffer_reg = TRUE;
+    /* any ring already allocated gets registered before the next frame */
+    clientCon->shm_buffers_registered = FALSE;
+    return 0;
+}
+
+/******************************************************************************/
+/* xrdp can put cache commands in gfx frames, sent in answer to cap 3
+   with the number of cache slots the client has
+   the client info comes first, other sessions have no cache commands */
+static int
+rdpClientConProcessMsgClientTileCache(rdpPtr dev, rdpClientCon *clientCon)
+{
+    int num_slots;
+    struct stream *s;
+
+    s = clientCon->in_s;
+    in_uint32_le(s, num_slots);
+    if (clientCon->client_info.capture_code != CC_GFX_PRO)
+    {
+        LLOGLN(0, ("rdpClientConProcessMsgClientTileCache: capture code %d "
+               "is not gfx pro, no tile cache",
+               clientCon->client_info.capture_code));
+        num_slots = 0;
+    }
+    LLOGLN(0, ("rdpClientConProcessMsgClientTileCache: client cache slots "
+           "%d, using %d", num_slots, RDPMIN(num_slots, dev->tile_cache_slots)));
+    num_slots = RDPMIN(num_slots, dev->tile_cache_slots);
+    rdpTileCacheDestroy(clientCon->tile_cache);
+    clientCon->tile_cache = NULL;
+    free(clientCon->tile_cache_ops);
+    clientCon->tile_cache_ops = NULL;
+    if (num_slots > 0)
+    {
+        clientCon->tile_cache = rdpTileCacheCreate(num_slots);
+        clientCon->tile_cache_ops = g_new0(struct rdp_tile_cache_ops, 1);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* xrdp can put surface to surface copies in gfx frames, sent in answer
+   to cap 4 */
+static int
+rdpClientConProcessMsgClientScreenCopy(rdpPtr dev, rdpClientCon *clientCon)
+{
+    LLOGLN(0, ("rdpClientConProcessMsgClientScreenCopy: xrdp supports "
+           "surface to surface copies"));
+    clientCon->screen_copy = TRUE;
+    return 0;
+}
+
+/******************************************************************************/
+/* xrdp can put solid fills in gfx frames, sent in answer to cap 5 */
+static int
+rdpClientConProcessMsgClientSolidFill(rdpPtr dev, rdpClientCon *clientCon)
+{
+    LLOGLN(0, ("rdpClientConProcessMsgClientSolidFill: xrdp supports "
+           "solid fills"));
+    clientCon->solid_fill = TRUE;
+    return 0;
+}
+
 /******************************************************************************/
 static int
 rdpClientConProcessMsg(rdpPtr dev, rdpClientCon *clientCon)
@@ -1348,6 +2108,18 @@ rdpClientConProcessMsg(rdpPtr dev, rdpClientCon *clientCon)
         case 108: /* client suppress output */
             rdpClientConProcessMsgClientSuppressOutput(dev, clientCon);
             break;
+        case 109: /* client shm buffer registration */
+            rdpClientConProcessMsgClientShmBufferReg(dev, clientCon);
+            break;
+        case 110: /* client tile cache */
+            rdpClientConProcessMsgClientTileCache(dev, clientCon);
+            break;
+        case 111: /* client screen copy */
+            rdpClientConProcessMsgClientScreenCopy(dev, clientCon);
+            break;
+        case 112: /* client solid fill */
+            rdpClientConProcessMsgClientSolidFill(dev, clientCon);
+            break;
         default:
             LLOGLN(0, ("rdpClientConProcessMsg: unknown msg_type %d",
                    msg_type));
@@ -1357,84 +2129,725 @@ rdpClientConProcessMsg(rdpPtr dev, rdpClientCon *clientCon)
     return 0;
 }
 
+#if defined(XRDP_INPUT_THREAD)
+
 /******************************************************************************/
+/* keyboard and mouse messages, the ones the input thread handles */
 static int
-rdpClientConGotData(ScreenPtr pScreen, rdpPtr dev, rdpClientCon *clientCon)
+rdpClientConIsInputMsg(const char *data, int len)
 {
-    int rv;
-
-    LLOGLN(10, ("rdpClientConGotData:"));
+    int msg_type;
+    int msg;
 
-    rv = rdpClientConRecvMsg(dev, clientCon);
-    if (rv == 0)
+    if (len < 4 + 2 + 4 * 5)
     {
-        rv = rdpClientConProcessMsg(dev, clientCon);
+        return FALSE;
     }
-
-    return rv;
+    msg_type = (data[4] & 0xff) | ((data[5] & 0xff) << 8);
+    msg = (data[6] & 0xff) | ((data[7] & 0xff) << 8) |
+          ((data[8] & 0xff) << 16) | ((data[9] & 0xff) << 24);
+    return (msg_type == 103) && (msg >= 0) && (msg < 200);
 }
 
 /******************************************************************************/
-static int
-rdpClientConGotControlConnection(ScreenPtr pScreen, rdpPtr dev,
-                                 rdpClientCon *clientCon)
+/* wake the main thread, it picks up main_data or reaps the client */
+static void
+rdpClientConInputPoke(rdpClientCon *clientCon)
 {
-    LLOGLN(0, ("rdpClientConGotControlConnection:"));
-    return 0;
+    char c;
+
+    c = 0;
+    if (write(clientCon->input_pipe[1], &c, 1) != 1)
+    {
+        /* pipe full, the main thread has a wakeup pending anyway */
+    }
 }
 
 /******************************************************************************/
-static int
-rdpClientConGotControlData(ScreenPtr pScreen, rdpPtr dev,
-                           rdpClientCon *clientCon)
+/* runs on the input thread with the input lock held
+   a lost connection is left to the main thread in input_closed */
+static void
+rdpClientConInputThreadRead(int fd, int ready, void *data)
 {
-    LLOGLN(0, ("rdpClientConGotControlData:"));
-    return 0;
+    rdpClientCon *clientCon = (rdpClientCon *) data;
+    rdpPtr dev = clientCon->dev;
+    struct stream s;
+    char *msg_data;
+    char *main_data;
+    int msg_type;
+    int msg;
+    int param1;
+    int param2;
+    int param3;
+    int param4;
+    int more;
+    int len;
+    int size;
+    int offset;
+    int poke;
+    int closed;
+
+    pthread_mutex_lock(&(clientCon->input_mutex));
+    closed = clientCon->input_closed;
+    pthread_mutex_unlock(&(clientCon->input_mutex));
+    if (closed)
+    {
+        /* the socket stays readable until the main thread reaps the
+           client, wake it again instead of spinning here */
+        rdpClientConInputPoke(clientCon);
+        return;
+    }
+    poke = FALSE;
+    do
+    {
+        closed = rdpClientConRecv(dev, clientCon, &more) != 0;
+        offset = 0;
+        while (!closed)
+        {
+            msg_data = clientCon->recv_data + offset;
+            len = rdpClientConMsgLen(msg_data,
+                                     clientCon->recv_bytes - offset);
+            if (len < 0)
+            {
+                closed = TRUE;
+                break;
+            }
+            if (len == 0)
+            {
+                break;
+            }
+            offset += len;
+            if (rdpClientConIsInputMsg(msg_data, len))
+            {
+                g_memset(&s, 0, sizeof(s));
+                s.data = msg_data + 4;
+                s.p = s.data;
+                s.end = msg_data + len;
+                in_uint16_le(&s, msg_type);
+                in_uint32_le(&s, msg);
+                in_uint32_le(&s, param1);
+                in_uint32_le(&s, param2);
+                in_uint32_le(&s, param3);
+                in_uint32_le(&s, param4);
+                if (msg < 100)
+                {
+                    rdpInputKeyboardEvent(dev, msg, param1, param2,
+                                          param3, param4);
+                }
+                else
+                {
+                    rdpInputMouseEvent(dev, msg, param1, param2,
+                                       param3, param4);
+                }
+                continue;
+            }
+            /* everything else belongs to the main thread */
+            pthread_mutex_lock(&(clientCon->input_mutex));
+            if (clientCon->main_bytes + len > clientCon->main_size)
+            {
+                size = RDPMAX(clientCon->main_size * 2,
+                              clientCon->main_bytes + len);
+                main_data = (char *) realloc(clientCon->main_data, size);
+                if (main_data == NULL)
+                {
+                    /* the main thread still gets what is there */
+                    pthread_mutex_unlock(&(clientCon->input_mutex));
+                    LLOGLN(0, ("rdpClientConInputThreadRead: realloc "
+                           "failed"));
+                    closed = TRUE;
+                    break;
+                }
+                clientCon->main_data = main_data;
+                clientCon->main_size = size;
+            }
+            memcpy(clientCon->main_data + clientCon->main_bytes,
+                   msg_data, len);
+            clientCon->main_bytes += len;
+            pthread_mutex_unlock(&(clientCon->input_mutex));
+            poke = TRUE;
+        }
+        rdpInputFlush(dev);
+        if (offset > 0)
+        {
+            clientCon->recv_bytes -= offset;
+            memmove(clientCon->recv_data, clientCon->recv_data + offset,
+                    clientCon->recv_bytes);
+        }
+    } while (!closed && more);
+    if (closed)
+    {
+        pthread_mutex_lock(&(clientCon->input_mutex));
+        clientCon->input_closed = TRUE;
+        pthread_mutex_unlock(&(clientCon->input_mutex));
+    }
+    if (poke || closed)
+    {
+        rdpClientConInputPoke(clientCon);
+    }
 }
 
 /******************************************************************************/
-int
-rdpClientConCheck(ScreenPtr pScreen)
+/* main thread, process the messages the input thread passed on and
+   drop the connection if the input thread lost it */
+static void
+rdpClientConInputPipeNotify(int fd, int ready, void *data)
 {
-    rdpPtr dev;
-    rdpClientCon *clientCon;
-    rdpClientCon *nextCon;
-    fd_set rfds;
-    struct timeval time;
-    int max;
-    int sel;
-    int count;
-    char buf[8];
-
-    LLOGLN(10, ("rdpClientConCheck:"));
-    dev = rdpGetDevFromScreen(pScreen);
-    time.tv_sec = 0;
-    time.tv_usec = 0;
-    FD_ZERO(&rfds);
-    count = 0;
-    max = 0;
+    rdpClientCon *clientCon = (rdpClientCon *) data;
+    rdpPtr dev = clientCon->dev;
+    char buf[64];
+    char *main_data;
+    int main_bytes;
+    int offset;
+    int len;
+    int closed;
 
-    if (dev->disconnect_sck > 0)
+    while (read(fd, buf, sizeof(buf)) > 0)
     {
-        count++;
-        FD_SET(LTOUI32(dev->disconnect_sck), &rfds);
-        max = RDPMAX(dev->disconnect_sck, max);
     }
-
-    if (dev->listen_sck > 0)
+    pthread_mutex_lock(&(clientCon->input_mutex));
+    main_data = clientCon->main_data;
+    main_bytes = clientCon->main_bytes;
+    clientCon->main_data = NULL;
+    clientCon->main_size = 0;
+    clientCon->main_bytes = 0;
+    closed = clientCon->input_closed;
+    pthread_mutex_unlock(&(clientCon->input_mutex));
+    offset = 0;
+    while (clientCon->connected && (offset < main_bytes))
     {
-        count++;
-        FD_SET(LTOUI32(dev->listen_sck), &rfds);
-        max = RDPMAX(dev->listen_sck, max);
+        len = rdpClientConMsgLen(main_data + offset, main_bytes - offset);
+        if (len < 1)
+        {
+            break;
+        }
+        rdpClientConInitInMsg(clientCon->in_s, main_data + offset, len);
+        offset += len;
+        rdpClientConProcessMsg(dev, clientCon);
     }
-    clientCon = dev->clientConHead;
-    while (clientCon != NULL)
+    free(main_data);
+    if (closed)
     {
-        if (!clientCon->connected)
-        {
-            /* I/O error on this client - remove it */
-            nextCon = clientCon->next;
-            rdpClientConDisconnect(dev, clientCon);
+        /* rdpClientConCheck reaps it on this wakeup */
+        clientCon->connected = FALSE;
+    }
+}
+
+/******************************************************************************/
+/* read the xrdp socket on the input thread so keyboard and mouse do not
+   wait for capture, returns error if the socket is to be read on the
+   main thread instead */
+static int
+rdpClientConInputThreadAdd(ScreenPtr pScreen, rdpPtr dev,
+                           rdpClientCon *clientCon)
+{
+    if (!dev->input_thread)
+    {
+        return 1;
+    }
+    if (pipe(clientCon->input_pipe) != 0)
+    {
+        LLOGLN(0, ("rdpClientConInputThreadAdd: pipe failed"));
+        return 1;
+    }
+    g_sck_set_non_blocking(clientCon->input_pipe[0]);
+    g_sck_set_non_blocking(clientCon->input_pipe[1]);
+    pthread_mutex_init(&(clientCon->input_mutex), NULL);
+    clientCon->input_closed = FALSE;
+    SetNotifyFd(clientCon->input_pipe[0], rdpClientConInputPipeNotify,
+                X_NOTIFY_READ, clientCon);
+    clientCon->input_thread = TRUE;
+    if (!InputThreadRegisterDev(clientCon->sck, rdpClientConInputThreadRead,
+                                clientCon))
+    {
+        LLOGLN(0, ("rdpClientConInputThreadAdd: InputThreadRegisterDev "
+               "failed"));
+        rdpClientConInputThreadRemove(clientCon);
+        return 1;
+    }
+    LLOGLN(0, ("rdpClientConInputThreadAdd: reading sck %d on the input "
+           "thread", clientCon->sck));
+    return 0;
+}
+
+/******************************************************************************/
+static void
+rdpClientConInputThreadRemove(rdpClientCon *clientCon)
+{
+    if (!clientCon->input_thread)
+    {
+        return;
+    }
+    /* holds the input lock, the read proc is not running after this */
+    InputThreadUnregisterDev(clientCon->sck);
+    RemoveNotifyFd(clientCon->input_pipe[0]);
+    close(clientCon->input_pipe[0]);
+    close(clientCon->input_pipe[1]);
+    pthread_mutex_destroy(&(clientCon->input_mutex));
+    free(clientCon->main_data);
+    clientCon->main_data = NULL;
+    clientCon->main_size = 0;
+    clientCon->main_bytes = 0;
+    clientCon->input_thread = FALSE;
+}
+
+#else
+
+/******************************************************************************/
+static int
+rdpClientConInputThreadAdd(ScreenPtr pScreen, rdpPtr dev,
+                           rdpClientCon *clientCon)
+{
+    return 1;
+}
+
+/******************************************************************************/
+static void
+rdpClientConInputThreadRemove(rdpClientCon *clientCon)
+{
+}
+
+#endif
+
+/******************************************************************************/
+/* the socket is readable, take in what is there and process every
+   complete message, a partial one stays buffered for the next wakeup */
+static int
+rdpClientConGotData(ScreenPtr pScreen, rdpPtr dev, rdpClientCon *clientCon)
+{
+    int rv;
+    int more;
+    int len;
+    int offset;
+
+    LLOGLN(10, ("rdpClientConGotData:"));
+
+    if (!clientCon->connected)
+    {
+        return 1;
+    }
+    do
+    {
+        rv = rdpClientConRecv(dev, clientCon, &more);
+        if (rv != 0)
+        {
+            clientCon->connected = FALSE;
+        }
+        offset = 0;
+        while (clientCon->connected)
+        {
+            len = rdpClientConMsgLen(clientCon->recv_data + offset,
+                                     clientCon->recv_bytes - offset);
+            if (len < 0)
+            {
+                clientCon->connected = FALSE;
+                rv = 1;
+                break;
+            }
+            if (len == 0)
+            {
+                break;
+            }
+            rdpClientConInitInMsg(clientCon->in_s,
+                                  clientCon->recv_data + offset, len);
+            offset += len;
+            rdpClientConProcessMsg(dev, clientCon);
+        }
+        /* moves merged within this batch go out now */
+#if defined(XRDP_INPUT_THREAD)
+        input_lock();
+#endif
+        rdpInputFlush(dev);
+#if defined(XRDP_INPUT_THREAD)
+        input_unlock();
+#endif
+        if (offset > 0)
+        {
+            clientCon->recv_bytes -= offset;
+            memmove(clientCon->recv_data, clientCon->recv_data + offset,
+                    clientCon->recv_bytes);
+        }
+    } while ((rv == 0) && more && clientCon->connected);
+
+    return rv;
+}
+
+/******************************************************************************/
+/* the stats socket moves to the newest client, it is only created when
+   there is none to take over */
+static int
+rdpClientConControlOpen(ScreenPtr pScreen, rdpPtr dev,
+                        rdpClientCon *clientCon)
+{
+    rdpClientCon *oldCon;
+
+    if (!dev->control_stats)
+    {
+        return 0;
+    }
+    for (oldCon = dev->clientConHead; oldCon != NULL; oldCon = oldCon->next)
+    {
+        if (oldCon->sckControlListener > 0)
+        {
+            clientCon->sckControlListener = oldCon->sckControlListener;
+            clientCon->sckControl = oldCon->sckControl;
+            oldCon->sckControlListener = 0;
+            oldCon->sckControl = 0;
+            return 0;
+        }
+    }
+    unlink(dev->control_uds);
+    clientCon->sckControlListener = g_sck_local_socket_stream();
+    if (g_sck_local_bind(clientCon->sckControlListener,
+                         dev->control_uds) != 0)
+    {
+        LLOGLN(0, ("rdpClientConControlOpen: g_sck_local_bind failed "
+               "for %s", dev->control_uds));
+        g_sck_close(clientCon->sckControlListener);
+        clientCon->sckControlListener = 0;
+        return 1;
+    }
+    g_sck_listen(clientCon->sckControlListener);
+    g_chmod_hex(dev->control_uds, 0x0660);
+    rdpClientConAddEnabledDevice(pScreen, clientCon->sckControlListener);
+    return 0;
+}
+
+/******************************************************************************/
+static void
+rdpClientConControlClose(rdpPtr dev, rdpClientCon *clientCon)
+{
+    if (clientCon->sckControl > 0)
+    {
+        rdpClientConRemoveEnabledDevice(clientCon->sckControl);
+        g_sck_close(clientCon->sckControl);
+        clientCon->sckControl = 0;
+    }
+    if (clientCon->sckControlListener > 0)
+    {
+        rdpClientConRemoveEnabledDevice(clientCon->sckControlListener);
+        g_sck_close(clientCon->sckControlListener);
+        clientCon->sckControlListener = 0;
+        unlink(dev->control_uds);
+    }
+}
+
+/******************************************************************************/
+static int
+rdpClientConGotControlConnection(ScreenPtr pScreen, rdpPtr dev,
+                                 rdpClientCon *clientCon)
+{
+    int sck;
+
+    LLOGLN(10, ("rdpClientConGotControlConnection:"));
+    sck = g_sck_accept(clientCon->sckControlListener);
+    if (sck == -1)
+    {
+        LLOGLN(0, ("rdpClientConGotControlConnection: g_sck_accept failed"));
+        return 1;
+    }
+    /* one query connection at a time, the newest wins */
+    if (clientCon->sckControl > 0)
+    {
+        rdpClientConRemoveEnabledDevice(clientCon->sckControl);
+        g_sck_close(clientCon->sckControl);
+    }
+    clientCon->sckControl = sck;
+    g_sck_set_non_blocking(sck);
+    rdpClientConAddEnabledDevice(pScreen, sck);
+    return 0;
+}
+
+/******************************************************************************/
+struct rdp_stats_text
+{
+    char *data;
+    int size;
+    int bytes;
+};
+
+/******************************************************************************/
+static void
+rdpStatsPrintf(struct rdp_stats_text *text, const char *format, ...)
+printflike(2, 3);
+
+/******************************************************************************/
+static void
+rdpStatsPrintf(struct rdp_stats_text *text, const char *format, ...)
+{
+    va_list ap;
+    int len;
+
+    for (;;)
+    {
+        va_start(ap, format);
+        len = vsnprintf(text->data + text->bytes, text->size - text->bytes,
+                        format, ap);
+        va_end(ap);
+        if (len < 0)
+        {
+            return;
+        }
+        if (text->bytes + len < text->size)
+        {
+            text->bytes += len;
+            return;
+        }
+        text->size = RDPMAX(text->size * 2, text->bytes + len + 1);
+        text->data = (char *) xnfrealloc(text->data, text->size);
+    }
+}
+
+/******************************************************************************/
+/* GC op counters in dev->counts, in struct order */
+static const struct
+{
+    const char *name;
+    int offset;
+} g_op_counts[] =
+{
+#define RDP_OP_COUNT(_name)     { #_name, offsetof(struct _rdpCounts, rdp ## _name ## CallCount) }
+    RDP_OP_COUNT(FillSpans), RDP_OP_COUNT(SetSpans),
+    RDP_OP_COUNT(PutImage), RDP_OP_COUNT(CopyArea),
+    RDP_OP_COUNT(CopyPlane), RDP_OP_COUNT(PolyPoint),
+    RDP_OP_COUNT(Polylines), RDP_OP_COUNT(PolySegment),
+    RDP_OP_COUNT(PolyRectangle), RDP_OP_COUNT(PolyArc),
+    RDP_OP_COUNT(FillPolygon), RDP_OP_COUNT(PolyFillRect),
+    RDP_OP_COUNT(PolyFillArc), RDP_OP_COUNT(PolyText8),
+    RDP_OP_COUNT(PolyText16), RDP_OP_COUNT(ImageText8),
+    RDP_OP_COUNT(ImageText16), RDP_OP_COUNT(ImageGlyphBlt),
+    RDP_OP_COUNT(PolyGlyphBlt), RDP_OP_COUNT(PushPixels),
+    RDP_OP_COUNT(Composite), RDP_OP_COUNT(CopyWindow),
+    RDP_OP_COUNT(Trapezoids), RDP_OP_COUNT(Triangles),
+    RDP_OP_COUNT(CompositeRects)
+#undef RDP_OP_COUNT
+};
+
+/******************************************************************************/
+/* one "name value" pair per line, ends with a line that is just "end" */
+static void
+rdpClientConStatsText(rdpPtr dev, struct rdp_stats_text *text)
+{
+    static const char *lat_names[RDP_LAT_COUNT] =
+    {
+        "queue", "capture", "send", "ack", "total", "input"
+    };
+    rdpClientCon *clientCon;
+    struct rdp_out_buf *out;
+    struct rdp_hist *hist;
+    const char *counts;
+    int index;
+    int count;
+    int in_flight;
+
+    rdpStatsPrintf(text, "version 1\n");
+    counts = (const char *) &(dev->counts);
+    for (index = 0; index < (int) (sizeof(g_op_counts) /
+                                   sizeof(g_op_counts[0])); index++)
+    {
+        rdpStatsPrintf(text, "op.%s %u\n", g_op_counts[index].name,
+                       (unsigned int) *((const CARD32 *)
+                       (counts + g_op_counts[index].offset)));
+    }
+    for (clientCon = dev->clientConHead; clientCon != NULL;
+         clientCon = clientCon->next)
+    {
+#define RDP_STAT(_fmt, _val)         rdpStatsPrintf(text, "client.%d." _fmt "\n", clientCon->conNumber, _val)
+        RDP_STAT("frames_sent %llu",
+                 (unsigned long long) clientCon->frames_sent);
+        RDP_STAT("frames_skipped %llu",
+                 (unsigned long long) clientCon->frames_skipped);
+        RDP_STAT("frames_deferred %llu",
+                 (unsigned long long) clientCon->frames_deferred);
+        RDP_STAT("tiles_hashed %llu",
+                 (unsigned long long) clientCon->tiles_hashed);
+        RDP_STAT("tiles_skipped %llu",
+                 (unsigned long long) clientCon->tiles_skipped);
+        RDP_STAT("tiles_cached %llu",
+                 (unsigned long long) clientCon->tiles_cached);
+        RDP_STAT("tiles_solid %llu",
+                 (unsigned long long) clientCon->tiles_solid);
+        RDP_STAT("screen_copies %llu",
+                 (unsigned long long) clientCon->screen_copies);
+        RDP_STAT("scrolls_detected %llu",
+                 (unsigned long long) clientCon->scrolls_detected);
+        RDP_STAT("bytes_converted %llu",
+                 (unsigned long long) clientCon->bytes_converted);
+        count = 0;
+        for (out = clientCon->out_head; out != NULL; out = out->next)
+        {
+            count++;
+        }
+        in_flight = 0;
+        for (index = 0; index < clientCon->num_shm_buffers; index++)
+        {
+            if (clientCon->shm_buffers[index].rect_id >
+                clientCon->rect_id_ack)
+            {
+                in_flight++;
+            }
+        }
+        RDP_STAT("queue.out_bufs %d", count);
+        RDP_STAT("queue.out_bytes %d", clientCon->out_bytes);
+        RDP_STAT("queue.shm_in_flight %d", in_flight);
+        RDP_STAT("queue.shm_buffers %d", clientCon->num_shm_buffers);
+        RDP_STAT("queue.dirty_rects %d",
+                 (int) REGION_NUM_RECTS(clientCon->dirtyRegion));
+        RDP_STAT("pace.frame_interval_ms %d", clientCon->frameInterval);
+        RDP_STAT("pace.srtt_ms %d", clientCon->srtt8 >> 3);
+#undef RDP_STAT
+        for (index = 0; index < RDP_LAT_COUNT; index++)
+        {
+            hist = clientCon->latency + index;
+            rdpStatsPrintf(text, "client.%d.latency_us.%s count %u p50 %u "
+                           "p90 %u p99 %u max %u\n", clientCon->conNumber,
+                           lat_names[index], hist->count,
+                           rdpHistPercentile(hist, 50),
+                           rdpHistPercentile(hist, 90),
+                           rdpHistPercentile(hist, 99), hist->max);
+        }
+    }
+    rdpStatsPrintf(text, "end\n");
+}
+
+/******************************************************************************/
+/* GC op costs, one line per op that was called while profiling */
+static void
+rdpClientConProfileText(rdpPtr dev, struct rdp_stats_text *text)
+{
+    struct rdp_op_prof *prof;
+    int index;
+
+    rdpStatsPrintf(text, "version 1\n");
+    rdpStatsPrintf(text, "profile %d\n", dev->profile_ops);
+    for (index = 0; index < (int) (sizeof(g_op_counts) /
+                                   sizeof(g_op_counts[0])); index++)
+    {
+        prof = dev->op_prof + g_op_counts[index].offset / sizeof(CARD32);
+        if (prof->calls == 0)
+        {
+            continue;
+        }
+        rdpStatsPrintf(text, "prof.%s calls %llu wrap_ns %llu org_ns %llu\n",
+                       g_op_counts[index].name,
+                       (unsigned long long) prof->calls,
+                       (unsigned long long) prof->wrap_ns,
+                       (unsigned long long) prof->org_ns);
+    }
+    rdpStatsPrintf(text, "end\n");
+}
+
+/******************************************************************************/
+/* line based, "stats" gets the counters, "profile" the GC op costs,
+   "profile on", "profile off" and "profile reset" control the profiling
+   the reply is small enough for the socket buffer so it is sent without
+   queuing */
+static int
+rdpClientConGotControlData(ScreenPtr pScreen, rdpPtr dev,
+                           rdpClientCon *clientCon)
+{
+    struct rdp_stats_text text;
+    char buf[256];
+    int len;
+    int sent;
+
+    LLOGLN(10, ("rdpClientConGotControlData:"));
+    len = g_sck_recv(clientCon->sckControl, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+    {
+        if ((len == -1) && g_sck_last_error_would_block(clientCon->sckControl))
+        {
+            return 0;
+        }
+        rdpClientConRemoveEnabledDevice(clientCon->sckControl);
+        g_sck_close(clientCon->sckControl);
+        clientCon->sckControl = 0;
+        return 0;
+    }
+    buf[len] = 0;
+    g_memset(&text, 0, sizeof(text));
+    text.size = 16 * 1024;
+    text.data = g_new(char, text.size);
+    if (strncmp(buf, "stats", 5) == 0)
+    {
+        rdpClientConStatsText(dev, &text);
+    }
+    else if (strncmp(buf, "profile", 7) == 0)
+    {
+        if (strncmp(buf + 7, " on", 3) == 0)
+        {
+            dev->profile_ops = TRUE;
+        }
+        else if (strncmp(buf + 7, " off", 4) == 0)
+        {
+            dev->profile_ops = FALSE;
+        }
+        else if (strncmp(buf + 7, " reset", 6) == 0)
+        {
+            g_memset(dev->op_prof, 0, sizeof(dev->op_prof));
+        }
+        rdpClientConProfileText(dev, &text);
+    }
+    else
+    {
+        rdpStatsPrintf(&text, "error unknown command, try stats or "
+                       "profile\nend\n");
+    }
+    sent = g_sck_send(clientCon->sckControl, text.data, text.bytes, 0);
+    if (sent != text.bytes)
+    {
+        LLOGLN(0, ("rdpClientConGotControlData: sent %d of %d bytes",
+               sent, text.bytes));
+    }
+    free(text.data);
+    return 0;
+}
+
+#if XORG_VERSION_CURRENT < XORG_VERSION_NUMERIC(1, 18, 5, 0, 0)
+
+/******************************************************************************/
+/* servers without SetNotifyFd only tell us that some fd is ready */
+int
+rdpClientConCheck(ScreenPtr pScreen)
+{
+    rdpPtr dev;
+    rdpClientCon *clientCon;
+    rdpClientCon *nextCon;
+    fd_set rfds;
+    struct timeval time;
+    int max;
+    int sel;
+    int count;
+    char buf[8];
+
+    LLOGLN(10, ("rdpClientConCheck:"));
+    dev = rdpGetDevFromScreen(pScreen);
+    time.tv_sec = 0;
+    time.tv_usec = 0;
+    FD_ZERO(&rfds);
+    count = 0;
+    max = 0;
+
+    if (dev->disconnect_sck > 0)
+    {
+        count++;
+        FD_SET(LTOUI32(dev->disconnect_sck), &rfds);
+        max = RDPMAX(dev->disconnect_sck, max);
+    }
+
+    if (dev->listen_sck > 0)
+    {
+        count++;
+        FD_SET(LTOUI32(dev->listen_sck), &rfds);
+        max = RDPMAX(dev->listen_sck, max);
+    }
+    clientCon = dev->clientConHead;
+    while (clientCon != NULL)
+    {
+        if (!clientCon->connected)
+        {
+            /* I/O error on this client - remove it */
+            nextCon = clientCon->next;
+            rdpClientConDisconnect(dev, clientCon);
             clientCon = nextCon;
             continue;
         }
@@ -1540,6 +2953,115 @@ rdpClientConCheck(ScreenPtr pScreen)
     return 0;
 }
 
+#else
+
+/******************************************************************************/
+/* one of our sockets is ready, SetNotifyFd tells which */
+static void
+rdpClientConGotFd(ScreenPtr pScreen, int fd, int ready)
+{
+    rdpPtr dev;
+    rdpClientCon *clientCon;
+    char buf[8];
+
+    LLOGLN(10, ("rdpClientConGotFd: fd %d ready 0x%x", fd, ready));
+    dev = rdpGetDevFromScreen(pScreen);
+    if ((dev->listen_sck > 0) && (fd == dev->listen_sck))
+    {
+        rdpClientConGotConnection(pScreen, dev);
+        return;
+    }
+    if ((dev->disconnect_sck > 0) && (fd == dev->disconnect_sck))
+    {
+        if (g_sck_recv(dev->disconnect_sck, buf, sizeof(buf), 0))
+        {
+            LLOGLN(0, ("rdpClientConGotFd: got disconnection request"));
+
+            /* disconnect all clients */
+            while (dev->clientConHead != NULL)
+            {
+                rdpClientConDisconnect(dev, dev->clientConHead);
+            }
+        }
+        return;
+    }
+    for (clientCon = dev->clientConHead;
+            clientCon != NULL;
+            clientCon = clientCon->next)
+    {
+        if ((clientCon->out_notify_sck >= 0) &&
+            (fd == clientCon->out_notify_sck))
+        {
+            if (ready & X_NOTIFY_WRITE)
+            {
+                rdpClientConFlushOut(dev, clientCon);
+            }
+            return;
+        }
+        if (fd == clientCon->sck)
+        {
+            if (ready & X_NOTIFY_WRITE)
+            {
+                rdpClientConFlushOut(dev, clientCon);
+            }
+            /* the input thread reads the socket when it has it */
+            if ((ready & (X_NOTIFY_READ | X_NOTIFY_ERROR)) &&
+                !clientCon->input_thread)
+            {
+                if (rdpClientConGotData(pScreen, dev, clientCon) != 0)
+                {
+                    LLOGLN(0, ("rdpClientConGotFd: rdpClientConGotData failed"));
+                }
+            }
+            return;
+        }
+        if ((clientCon->sckControlListener > 0) &&
+            (fd == clientCon->sckControlListener))
+        {
+            if (rdpClientConGotControlConnection(pScreen, dev, clientCon) != 0)
+            {
+                LLOGLN(0, ("rdpClientConGotFd: rdpClientConGotControlConnection failed"));
+            }
+            return;
+        }
+        if ((clientCon->sckControl > 0) && (fd == clientCon->sckControl))
+        {
+            if (rdpClientConGotControlData(pScreen, dev, clientCon) != 0)
+            {
+                LLOGLN(0, ("rdpClientConGotFd: rdpClientConGotControlData failed"));
+            }
+            return;
+        }
+    }
+}
+
+/******************************************************************************/
+/* called on every server wakeup, sockets are handled from their own
+   notify callbacks so this only frees clients that had an I/O error */
+int
+rdpClientConCheck(ScreenPtr pScreen)
+{
+    rdpPtr dev;
+    rdpClientCon *clientCon;
+    rdpClientCon *nextCon;
+
+    dev = rdpGetDevFromScreen(pScreen);
+    clientCon = dev->clientConHead;
+    while (clientCon != NULL)
+    {
+        nextCon = clientCon->next;
+        if (!clientCon->connected)
+        {
+            /* I/O error on this client - remove it */
+            rdpClientConDisconnect(dev, clientCon);
+        }
+        clientCon = nextCon;
+    }
+    return 0;
+}
+
+#endif
+
 /******************************************************************************/
 int
 rdpClientConInit(rdpPtr dev)
@@ -1603,6 +3125,25 @@ rdpClientConInit(rdpPtr dev)
         rdpClientConAddEnabledDevice(dev->pScreen, dev->disconnect_sck);
     }
 
+    /* stats socket, created with the first client */
+    g_sprintf(dev->control_uds, "%s/xrdp_stats_display_%s", socket_dir, display);
+    dev->control_stats = TRUE;
+    ptext = getenv("XORGXRDP_STATS_SOCKET");
+    if (ptext != 0)
+    {
+        dev->control_stats = atoi(ptext) != 0;
+    }
+    LLOGLN(0, ("rdpClientConInit: stats socket [%d] %s",
+               dev->control_stats, dev->control_uds));
+
+    /* time the GC op wrappers from the start */
+    ptext = getenv("XORGXRDP_PROFILE_OPS");
+    if (ptext != 0)
+    {
+        dev->profile_ops = atoi(ptext) != 0;
+    }
+    LLOGLN(0, ("rdpClientConInit: profile ops [%d]", dev->profile_ops));
+
     /* disconnect idle */
     ptext = getenv("XRDP_SESMAN_MAX_IDLE_TIME");
     if (ptext != 0)
@@ -1649,6 +3190,142 @@ rdpClientConInit(rdpPtr dev)
     LLOGLN(0, ("rdpClientConInit: kill disconnected [%d] timeout [%d] sec",
                dev->do_kill_disconnected, dev->disconnect_timeout_s));
 
+    /* ordered dither for 16 and 8 bpp clients */
+    ptext = getenv("XORGXRDP_LOW_BPP_DITHER");
+    if (ptext != 0)
+    {
+        dev->low_bpp_dither = atoi(ptext) != 0;
+    }
+    LLOGLN(0, ("rdpClientConInit: low bpp dither [%d]",
+               dev->low_bpp_dither));
+
+    /* capture threads, including the X main thread, 1 disables */
+    if (dev->capture_workers == NULL)
+    {
+        dev->capture_threads = RDPCLAMP(sysconf(_SC_NPROCESSORS_ONLN), 1, 4);
+        ptext = getenv("XORGXRDP_CAPTURE_THREADS");
+        if (ptext != 0)
+        {
+            i = atoi(ptext);
+            if (i > 0)
+            {
+                dev->capture_threads = RDPMIN(i, RDP_MAX_WORKERS);
+            }
+        }
+        dev->capture_workers = rdpWorkersCreate(dev->capture_threads);
+    }
+    LLOGLN(0, ("rdpClientConInit: capture threads [%d]",
+               dev->capture_threads));
+
+    /* frames in flight, 0 means 2 when xrdp supports buffer
+       registration and 1 when it maps the buffer for every frame */
+    dev->shm_buffers = 0;
+    ptext = getenv("XORGXRDP_SHM_BUFFERS");
+    if (ptext != 0)
+    {
+        i = atoi(ptext);
+        if (i > 0)
+        {
+            dev->shm_buffers = RDPMIN(i, RDP_MAX_SHM_BUFFERS);
+        }
+    }
+    LLOGLN(0, ("rdpClientConInit: shared memory buffers [%d]%s",
+               dev->shm_buffers, dev->shm_buffers < 1 ? " (auto)" : ""));
+
+    /* GfxPro tiles kept in the client's cache, 0 disables, xrdp can
+       lower it to what the client has */
+    dev->tile_cache_slots = RDP_TILE_CACHE_SLOTS;
+    ptext = getenv("XORGXRDP_TILE_CACHE");
+    if (ptext != 0)
+    {
+        dev->tile_cache_slots = RDPMAX(atoi(ptext), 0);
+    }
+    LLOGLN(0, ("rdpClientConInit: tile cache slots [%d]",
+               dev->tile_cache_slots));
+
+    /* GfxPro window moves and scrolls sent as copies on the client's
+       surface, and scrolls found by comparing rows of the capture */
+    dev->screen_copy = TRUE;
+    ptext = getenv("XORGXRDP_SCREEN_COPY");
+    if (ptext != 0)
+    {
+        dev->screen_copy = atoi(ptext) != 0;
+    }
+    dev->scroll_detect = dev->screen_copy;
+    ptext = getenv("XORGXRDP_SCROLL_DETECT");
+    if (ptext != 0)
+    {
+        dev->scroll_detect = dev->screen_copy && (atoi(ptext) != 0);
+    }
+    LLOGLN(0, ("rdpClientConInit: screen copy [%d] scroll detect [%d]",
+               dev->screen_copy, dev->scroll_detect));
+
+    /* tiles of one colour, GfxPro sends a fill, the other captures
+       convert one row of them and repeat it */
+    dev->solid_fill = TRUE;
+    ptext = getenv("XORGXRDP_SOLID_FILL");
+    if (ptext != 0)
+    {
+        dev->solid_fill = atoi(ptext) != 0;
+    }
+    LLOGLN(0, ("rdpClientConInit: solid fill [%d]", dev->solid_fill));
+
+    /* read xrdp on the server's input thread where there is one */
+    dev->input_thread = FALSE;
+#if defined(XRDP_INPUT_THREAD)
+    dev->input_thread = TRUE;
+    ptext = getenv("XORGXRDP_INPUT_THREAD");
+    if (ptext != 0)
+    {
+        dev->input_thread = atoi(ptext) != 0;
+    }
+#endif
+    LLOGLN(0, ("rdpClientConInit: input thread [%d]", dev->input_thread));
+
+    /* merge runs of absolute pointer moves that arrive together */
+    dev->coalesce_motion = TRUE;
+    ptext = getenv("XORGXRDP_COALESCE_MOTION");
+    if (ptext != 0)
+    {
+        dev->coalesce_motion = atoi(ptext) != 0;
+    }
+    LLOGLN(0, ("rdpClientConInit: coalesce motion [%d]",
+               dev->coalesce_motion));
+
+    /* frame rate range the pacing may pick from the ack round trip */
+    dev->min_fps = DEFAULT_MIN_FPS;
+    dev->max_fps = DEFAULT_MAX_FPS;
+    ptext = getenv("XORGXRDP_MIN_FPS");
+    if (ptext != 0)
+    {
+        i = atoi(ptext);
+        if (i > 0)
+        {
+            dev->min_fps = RDPMIN(i, 1000);
+        }
+    }
+    ptext = getenv("XORGXRDP_MAX_FPS");
+    if (ptext != 0)
+    {
+        i = atoi(ptext);
+        if (i > 0)
+        {
+            dev->max_fps = RDPMIN(i, 1000);
+        }
+    }
+    dev->max_fps = RDPMAX(dev->max_fps, dev->min_fps);
+    LLOGLN(0, ("rdpClientConInit: fps range [%d, %d]",
+               dev->min_fps, dev->max_fps));
+
+    /* first frame after a key or button skips the pacing */
+    dev->input_boost_ms = DEFAULT_INPUT_BOOST_MS;
+    ptext = getenv("XORGXRDP_INPUT_BOOST_MS");
+    if (ptext != 0)
+    {
+        dev->input_boost_ms = RDPCLAMP(atoi(ptext), 0, 1000);
+    }
+    LLOGLN(0, ("rdpClientConInit: input boost ms [%d]",
+               dev->input_boost_ms));
 
     return 0;
 }
@@ -1689,6 +3366,9 @@ rdpClientConDeinit(rdpPtr dev)
         }
     }
 
+    rdpWorkersDestroy((struct rdp_workers *) (dev->capture_workers));
+    dev->capture_workers = NULL;
+
     return 0;
 }
 
@@ -2194,8 +3874,8 @@ rdpClientConSetCursorShmFd(rdpPtr dev, rdpClientCon *clientCon,
         memcpy(shmemptr, cur_data, width * height * Bpp);
         memcpy(shmemptr + width * height * Bpp, cur_mask, width * height / 8);
         rdpClientConSendPending(clientCon->dev, clientCon);
-        rv = g_sck_send_fd_set(clientCon->sck, "int", 4, &fd, 1);
-        LLOGLN(10, ("rdpClientConSetCursorShmFd: g_sck_send_fd_set rv %d", rv));
+        rv = rdpClientConSendFds(dev, clientCon, &fd, 1);
+        LLOGLN(10, ("rdpClientConSetCursorShmFd: rdpClientConSendFds rv %d", rv));
         g_free_unmap_fd(shmemptr, fd, shmsize);
     }
     return rv;
@@ -2601,43 +4281,163 @@ out_rects_dr(struct stream *s,
 }
 
 /******************************************************************************/
+/* capture start as UTC time of day in the STARTFRAME layout,
+   hours << 22 | minutes << 16 | seconds << 10 | milliseconds */
+static CARD32
+rdpClientConFrameTimeStamp(rdpClientCon *clientCon)
+{
+    struct timespec ts;
+    struct tm tm;
+    uint64_t ago;
+    uint64_t ms;
+    time_t secs;
+
+    /* capture_start is monotonic, take its age off the wall clock */
+    ago = g_time_usec() - clientCon->frame_times.capture_start;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ms = (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    ms -= RDPMIN(ago / 1000, ms);
+    secs = (time_t) (ms / 1000);
+    if (gmtime_r(&secs, &tm) == NULL)
+    {
+        return 0;
+    }
+    return (CARD32) ((tm.tm_hour << 22) | (tm.tm_min << 16) |
+                     (tm.tm_sec << 10) | (ms % 1000));
+}
+
+/******************************************************************************/
+/* gfx surface to surface copies, in the order they were done on the
+   screen, before anything else in the frame */
+static void
+out_surface_to_surface(struct stream *s, int surface_id,
+                       struct rdp_screen_copy *copies, int num_copies)
+{
+    int index;
+    BoxRec box;
+
+    for (index = 0; index < num_copies; index++)
+    {
+        box = copies[index].dst;
+        /* XR_RDPGFX_CMDID_SURFACETOSURFACE */
+        out_uint16_le(s, 0x0005);
+        out_uint16_le(s, 0);                    /* flags */
+        out_uint32_le(s, 8 + 18);               /* cmd_bytes */
+        out_uint16_le(s, surface_id);           /* surface_id_src */
+        out_uint16_le(s, surface_id);           /* surface_id_dst */
+        out_uint16_le(s, box.x1 - copies[index].dx); /* rect_src */
+        out_uint16_le(s, box.y1 - copies[index].dy);
+        out_uint16_le(s, box.x2 - copies[index].dx);
+        out_uint16_le(s, box.y2 - copies[index].dy);
+        out_uint16_le(s, 1);                    /* num dest points */
+        out_uint16_le(s, box.x1);
+        out_uint16_le(s, box.y1);
+    }
+}
+
+/******************************************************************************/
+/* gfx cache commands, tiles copied from the client's cache before the
+   frame is drawn */
+static void
+out_cache_to_surface(struct stream *s, int surface_id,
+                     struct rdp_tile_cache_hit *hits, int num_hits)
+{
+    int index;
+
+    for (index = 0; index < num_hits; index++)
+    {
+        /* XR_RDPGFX_CMDID_CACHETOSURFACE */
+        out_uint16_le(s, 0x0007);
+        out_uint16_le(s, 0);                    /* flags */
+        out_uint32_le(s, 8 + 10);               /* cmd_bytes */
+        out_uint16_le(s, hits[index].slot);     /* cache_slot */
+        out_uint16_le(s, surface_id);           /* surface_id */
+        out_uint16_le(s, 1);                    /* num dest points */
+        out_uint16_le(s, hits[index].x);
+        out_uint16_le(s, hits[index].y);
+    }
+}
+
+/******************************************************************************/
+/* gfx solid fills, tiles of one colour, one rect each */
+static void
+out_solid_fill(struct stream *s, int surface_id,
+               struct rdp_solid_fill *fills, int num_fills)
+{
+    int index;
+
+    for (index = 0; index < num_fills; index++)
+    {
+        /* XR_RDPGFX_CMDID_SOLIDFILL */
+        out_uint16_le(s, 0x0004);
+        out_uint16_le(s, 0);                    /* flags */
+        out_uint32_le(s, 8 + 16);               /* cmd_bytes */
+        out_uint16_le(s, surface_id);           /* surface_id */
+        /* fill_pixel, b g r xa */
+        out_uint32_le(s, fills[index].pixel | 0xFF000000);
+        out_uint16_le(s, 1);                    /* fill_rect_count */
+        out_uint16_le(s, fills[index].rect.x1);
+        out_uint16_le(s, fills[index].rect.y1);
+        out_uint16_le(s, fills[index].rect.x2);
+        out_uint16_le(s, fills[index].rect.y2);
+    }
+}
+
+/******************************************************************************/
+/* gfx cache commands, tiles copied to the client's cache after the frame
+   is drawn */
+static void
+out_surface_to_cache(struct stream *s, int surface_id,
+                     struct rdp_tile_cache_store *stores, int num_stores)
+{
+    int index;
+
+    for (index = 0; index < num_stores; index++)
+    {
+        /* XR_RDPGFX_CMDID_SURFACETOCACHE */
+        out_uint16_le(s, 0x0006);
+        out_uint16_le(s, 0);                    /* flags */
+        out_uint32_le(s, 8 + 20);               /* cmd_bytes */
+        out_uint16_le(s, surface_id);           /* surface_id */
+        /* cache_key */
+        out_uint32_le(s, (uint32_t) (stores[index].key & 0xFFFFFFFF));
+        out_uint32_le(s, (uint32_t) (stores[index].key >> 32));
+        out_uint16_le(s, stores[index].slot);   /* cache_slot */
+        out_uint16_le(s, stores[index].rect.x1);
+        out_uint16_le(s, stores[index].rect.y1);
+        out_uint16_le(s, stores[index].rect.x2);
+        out_uint16_le(s, stores[index].rect.y2);
+    }
+}
+
+/******************************************************************************/
+/* one frame message, the rect and command counts must fit in a message,
+   see RDP_MAX_MSG_RECTS, RDP_MAX_SCREEN_COPIES, RDP_MAX_MSG_CACHE_OPS
+   and RDP_MAX_MSG_FILLS
+   the commands are GfxPro only */
 static int
-rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
-                               struct image_data *id,
-                               RegionPtr dirtyReg,
-                               BoxPtr copyRects, int numCopyRects)
+rdpClientConSendPaintRectShmFdMsg(rdpPtr dev, rdpClientCon *clientCon,
+                                  struct image_data *id,
+                                  BoxPtr dirtyRects, int num_rects_d,
+                                  BoxPtr copyRects, int num_rects_c,
+                                  const struct rdp_frame_cmds *cmds)
 {
     int size;
-    int num_rects_d;
-    int num_rects_c;
     struct stream *s;
     enum xrdp_capture_code capture_code;
     int start_frame_bytes;
+    int cmds_bytes;
     int wiretosurface1_bytes;
     int wiretosurface2_bytes;
     int end_frame_bytes;
     int surface_id;
+    CARD32 time_stamp;
 
-    LLOGLN(10, ("rdpClientConSendPaintRectShmFd:"));
-    LLOGLN(10, ("rdpClientConSendPaintRectShmFd: cap_left %d cap_top %d "
-           "cap_width %d cap_height %d",
-           clientCon->cap_left, clientCon->cap_top,
-           clientCon->cap_width, clientCon->cap_height));
-    LLOGLN(10, ("rdpClientConSendPaintRectShmFd: id->flags 0x%8.8X "
-           "id->left %d id->top %d id->width %d id->height %d",
-           id->flags, id->left, id->top, id->width, id->height));
+    LLOGLN(10, ("rdpClientConSendPaintRectShmFdMsg: num_rects_d %d "
+           "num_rects_c %d", num_rects_d, num_rects_c));
 
     capture_code = clientCon->client_info.capture_code;
-    LLOGLN(10, ("rdpClientConSendPaintRectShmFd: capture_code %d",
-           capture_code));
-
-    num_rects_d = REGION_NUM_RECTS(dirtyReg);
-    num_rects_c = numCopyRects;
-    if ((num_rects_c < 1) || (num_rects_d < 1))
-    {
-        LLOGLN(10, ("rdpClientConSendPaintRectShmFd: nothing to send"));
-        return 0;
-    }
+    time_stamp = rdpClientConFrameTimeStamp(clientCon);
 
     rdpClientConBeginUpdate(dev, clientCon);
 
@@ -2646,14 +4446,19 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
         /* non gfx */
         size = 2 + 2 + 2 + num_rects_d * 8 + 2 + num_rects_c * 8;
         size += 4 + 4 + 4 + 4 + 2 + 2 + 2 + 2;
+        if (id->shmem_id >= 0)
+        {
+            size += 2;
+        }
         rdpClientConPreCheck(dev, clientCon, size);
 
         s = clientCon->out_s;
-        out_uint16_le(s, 64);
+        /* 66 is 64 with a registered buffer id instead of an fd */
+        out_uint16_le(s, id->shmem_id >= 0 ? 66 : 64);
         out_uint16_le(s, size);
         clientCon->count++;
 
-        out_rects_dr(s, REGION_RECTS(dirtyReg), num_rects_d,
+        out_rects_dr(s, dirtyRects, num_rects_d,
                      copyRects, num_rects_c);
 
         out_uint32_le(s, id->flags);
@@ -2675,32 +4480,55 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
             out_uint16_le(s, clientCon->cap_width);
             out_uint16_le(s, clientCon->cap_height);
         }
-        rdpClientConSendPending(clientCon->dev, clientCon);
-        g_sck_send_fd_set(clientCon->sck, "int", 4, &(id->shmem_fd), 1);
+        if (id->shmem_id >= 0)
+        {
+            out_uint16_le(s, id->shmem_id);
+        }
+        else
+        {
+            rdpClientConSendPending(clientCon->dev, clientCon);
+            rdpClientConSendFds(dev, clientCon, &(id->shmem_fd), 1);
+        }
     }
     else if (capture_code == CC_GFX_PRO) /* gfx pro rfx */
     {
         start_frame_bytes = 8 + 8;
-        wiretosurface2_bytes = 8 + 13 +
-                               2 + num_rects_d * 8 +
-                               2 + num_rects_c * 8 +
-                               8;
+        cmds_bytes = cmds->num_copies * (8 + 18) +
+                     cmds->num_hits * (8 + 10) +
+                     cmds->num_fills * (8 + 16) +
+                     cmds->num_stores * (8 + 20);
+        /* a frame that is all copies has nothing to encode */
+        wiretosurface2_bytes = 0;
+        if (num_rects_c > 0)
+        {
+            wiretosurface2_bytes = 8 + 13 +
+                                   2 + num_rects_d * 8 +
+                                   2 + num_rects_c * 8 +
+                                   8;
+        }
         end_frame_bytes = 8 + 4;
 
         size = 2 + 2;                   /* header */
         size += 4;                      /* message 62 cmd_bytes */
         size += start_frame_bytes;      /* start frame message */
+        size += cmds_bytes;             /* copy, cache and fill messages */
         size += wiretosurface2_bytes;   /* frame message */
         size += end_frame_bytes;        /* end frame message */
         size += 4;                      /* message 62 data_bytes */
+        if (id->shmem_id >= 0)
+        {
+            size += 2;                  /* message 67 buffer id */
+        }
 
         rdpClientConPreCheck(dev, clientCon, size);
         s = clientCon->out_s;
-        out_uint16_le(s, 62);
+        /* 67 is 62 with a registered buffer id instead of an fd */
+        out_uint16_le(s, id->shmem_id >= 0 ? 67 : 62);
         out_uint16_le(s, size);
         clientCon->count++;
 
         out_uint32_le(s, start_frame_bytes +
+                        cmds_bytes +
                         wiretosurface2_bytes +
                         end_frame_bytes); /* total of cmd_bytes */
 
@@ -2711,27 +4539,51 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
         out_uint16_le(s, 0);                    /* flags */
         out_uint32_le(s, start_frame_bytes);    /* cmd_bytes */
         out_uint32_le(s, clientCon->rect_id);   /* frame_id */
-        out_uint32_le(s, 0);                    /* time_stamp */
+        out_uint32_le(s, time_stamp);           /* time_stamp */
 
         surface_id = (id->flags >> 28) & 0xF;
-        /* XR_RDPGFX_CMDID_WIRETOSURFACE_2 */
-        out_uint16_le(s, 0x0002);
-        out_uint16_le(s, 0);                    /* flags */
-        out_uint32_le(s, wiretosurface2_bytes); /* cmd_bytes */
-        out_uint16_le(s, surface_id);           /* surface_id */
-        out_uint16_le(s, 0x0009);               /* codec_id */
-        out_uint32_le(s, 0);                    /* codec_context_id */
-        out_uint8(s, 0x20);                     /* pixel_format */
+        if (cmds->num_copies > 0)
+        {
+            out_surface_to_surface(s, surface_id, cmds->copies,
+                                   cmds->num_copies);
+        }
+        if (cmds->num_hits > 0)
+        {
+            out_cache_to_surface(s, surface_id, cmds->hits,
+                                 cmds->num_hits);
+        }
+        if (cmds->num_fills > 0)
+        {
+            out_solid_fill(s, surface_id, cmds->fills, cmds->num_fills);
+        }
 
-        out_uint32_le(s, id->flags);            /* flags */
+        if (num_rects_c > 0)
+        {
+            /* XR_RDPGFX_CMDID_WIRETOSURFACE_2 */
+            out_uint16_le(s, 0x0002);
+            out_uint16_le(s, 0);                /* flags */
+            out_uint32_le(s, wiretosurface2_bytes); /* cmd_bytes */
+            out_uint16_le(s, surface_id);       /* surface_id */
+            out_uint16_le(s, 0x0009);           /* codec_id */
+            out_uint32_le(s, 0);                /* codec_context_id */
+            out_uint8(s, 0x20);                 /* pixel_format */
 
-        out_rects_dr(s, REGION_RECTS(dirtyReg), num_rects_d,
-                     copyRects, num_rects_c);
+            out_uint32_le(s, id->flags);        /* flags */
 
-        out_uint16_le(s, id->left);
-        out_uint16_le(s, id->top);
-        out_uint16_le(s, id->width);
-        out_uint16_le(s, id->height);
+            out_rects_dr(s, dirtyRects, num_rects_d,
+                         copyRects, num_rects_c);
+
+            out_uint16_le(s, id->left);
+            out_uint16_le(s, id->top);
+            out_uint16_le(s, id->width);
+            out_uint16_le(s, id->height);
+        }
+
+        if (cmds->num_stores > 0)
+        {
+            out_surface_to_cache(s, surface_id, cmds->stores,
+                                 cmds->num_stores);
+        }
 
         /* XR_RDPGFX_CMDID_ENDFRAME */
         out_uint16_le(s, 0x000C);
@@ -2739,15 +4591,27 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
         out_uint32_le(s, end_frame_bytes);      /* cmd_bytes */
         out_uint32_le(s, clientCon->rect_id);   /* frame_id */
 
-        if ((id->shmem_bytes > 0) && ((id->flags & 1) == 0))
+        if ((num_rects_c > 0) &&
+            (id->shmem_bytes > 0) && ((id->flags & 1) == 0))
         {
             out_uint32_le(s, id->shmem_bytes);  /* shmem_bytes */
-            rdpClientConSendPending(clientCon->dev, clientCon);
-            g_sck_send_fd_set(clientCon->sck, "int", 4, &(id->shmem_fd), 1);
+            if (id->shmem_id >= 0)
+            {
+                out_uint16_le(s, id->shmem_id); /* buffer id */
+            }
+            else
+            {
+                rdpClientConSendPending(clientCon->dev, clientCon);
+                rdpClientConSendFds(dev, clientCon, &(id->shmem_fd), 1);
+            }
         }
         else
         {
             out_uint32_le(s, 0);                /* shmem_bytes */
+            if (id->shmem_id >= 0)
+            {
+                out_uint16_le(s, id->shmem_id); /* buffer id */
+            }
         }
     }
     else if (capture_code == CC_GFX_A2) /* gfx h264 */
@@ -2765,10 +4629,15 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
         size += wiretosurface1_bytes;   /* frame message */
         size += end_frame_bytes;        /* end frame message */
         size += 4;                      /* message 62 data_bytes */
+        if (id->shmem_id >= 0)
+        {
+            size += 2;                  /* message 67 buffer id */
+        }
 
         rdpClientConPreCheck(dev, clientCon, size);
         s = clientCon->out_s;
-        out_uint16_le(s, 62);
+        /* 67 is 62 with a registered buffer id instead of an fd */
+        out_uint16_le(s, id->shmem_id >= 0 ? 67 : 62);
         out_uint16_le(s, size);
         clientCon->count++;
 
@@ -2783,7 +4652,7 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
         out_uint16_le(s, 0);                    /* flags */
         out_uint32_le(s, start_frame_bytes);    /* cmd_bytes */
         out_uint32_le(s, clientCon->rect_id);   /* frame_id */
-        out_uint32_le(s, 0);                    /* time_stamp */
+        out_uint32_le(s, time_stamp);           /* time_stamp */
 
         surface_id = (id->flags >> 28) & 0xF;
         /* XR_RDPGFX_CMDID_WIRETOSURFACE_1 */
@@ -2796,7 +4665,7 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
 
         out_uint32_le(s, id->flags);            /* flags */
 
-        out_rects_dr(s, REGION_RECTS(dirtyReg), num_rects_d,
+        out_rects_dr(s, dirtyRects, num_rects_d,
                      copyRects, num_rects_c);
 
         out_uint16_le(s, id->left);
@@ -2813,12 +4682,23 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
         if ((id->shmem_bytes > 0) && ((id->flags & 1) == 0))
         {
             out_uint32_le(s, id->shmem_bytes);  /* shmem_bytes */
-            rdpClientConSendPending(clientCon->dev, clientCon);
-            g_sck_send_fd_set(clientCon->sck, "int", 4, &(id->shmem_fd), 1);
+            if (id->shmem_id >= 0)
+            {
+                out_uint16_le(s, id->shmem_id); /* buffer id */
+            }
+            else
+            {
+                rdpClientConSendPending(clientCon->dev, clientCon);
+                rdpClientConSendFds(dev, clientCon, &(id->shmem_fd), 1);
+            }
         }
         else
         {
             out_uint32_le(s, 0);                /* shmem_bytes */
+            if (id->shmem_id >= 0)
+            {
+                out_uint16_le(s, id->shmem_id); /* buffer id */
+            }
         }
     }
 
@@ -2827,6 +4707,221 @@ rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
     return 0;
 }
 
+/******************************************************************************/
+static int
+rdpClientConSendPaintRectShmFd(rdpPtr dev, rdpClientCon *clientCon,
+                               struct image_data *id,
+                               RegionPtr dirtyReg,
+                               BoxPtr copyRects, int numCopyRects)
+{
+    RegionRec chunk_reg;
+    BoxPtr chunk_rects;
+    int num_rects_d;
+    int num_chunk_rects;
+    int index;
+    struct rdp_frame_cmds cmds;
+    struct rdp_tile_cache_ops *ops;
+    int num_hits;
+    int num_fills;
+    int num_stores;
+
+    LLOGLN(10, ("rdpClientConSendPaintRectShmFd:"));
+    LLOGLN(10, ("rdpClientConSendPaintRectShmFd: cap_left %d cap_top %d "
+           "cap_width %d cap_height %d",
+           clientCon->cap_left, clientCon->cap_top,
+           clientCon->cap_width, clientCon->cap_height));
+    LLOGLN(10, ("rdpClientConSendPaintRectShmFd: id->flags 0x%8.8X "
+           "id->left %d id->top %d id->width %d id->height %d",
+           id->flags, id->left, id->top, id->width, id->height));
+
+    /* gfx commands the capture left for this frame, the screen copies,
+       the copies from the tile cache and the solid fills go in the first
+       message and the copies to the tile cache after the last, once the
+       tiles they copy are drawn, any that do not fit with the tiles are
+       sent as frames of their own */
+    g_memset(&cmds, 0, sizeof(cmds));
+    cmds.copies = clientCon->frame_copies;
+    cmds.num_copies = clientCon->num_frame_copies;
+    clientCon->num_frame_copies = 0;
+    cmds.fills = clientCon->frame_fills;
+    num_fills = clientCon->num_frame_fills;
+    clientCon->num_frame_fills = 0;
+    num_hits = 0;
+    num_stores = 0;
+    ops = clientCon->tile_cache_ops;
+    if (ops != NULL)
+    {
+        cmds.hits = ops->hits;
+        cmds.stores = ops->stores;
+        num_hits = ops->num_hits;
+        num_stores = ops->num_stores;
+        ops->num_hits = 0;
+        ops->num_stores = 0;
+    }
+    while ((num_hits > RDP_MAX_MSG_CACHE_OPS) ||
+           (num_fills > RDP_MAX_MSG_FILLS))
+    {
+        cmds.num_hits = RDPMIN(num_hits, RDP_MAX_MSG_CACHE_OPS);
+        cmds.num_fills = RDPMIN(num_fills, RDP_MAX_MSG_FILLS);
+        rdpClientConSendPaintRectShmFdMsg(dev, clientCon, id,
+                                          NULL, 0, NULL, 0, &cmds);
+        cmds.num_copies = 0;
+        cmds.hits += cmds.num_hits;
+        num_hits -= cmds.num_hits;
+        cmds.fills += cmds.num_fills;
+        num_fills -= cmds.num_fills;
+    }
+    cmds.num_hits = num_hits;
+    cmds.num_fills = num_fills;
+
+    num_rects_d = REGION_NUM_RECTS(dirtyReg);
+    if ((numCopyRects < 1) || (num_rects_d < 1))
+    {
+        if ((cmds.num_copies > 0) || (cmds.num_hits > 0) ||
+            (cmds.num_fills > 0))
+        {
+            rdpClientConSendPaintRectShmFdMsg(dev, clientCon, id,
+                                              NULL, 0, NULL, 0, &cmds);
+        }
+        LLOGLN(10, ("rdpClientConSendPaintRectShmFd: nothing to send"));
+        return 0;
+    }
+    if ((numCopyRects <= RDP_MAX_MSG_RECTS) &&
+        (num_rects_d <= RDP_MAX_MSG_RECTS))
+    {
+        cmds.num_stores = RDPMIN(num_stores, RDP_MAX_MSG_CACHE_OPS);
+        rdpClientConSendPaintRectShmFdMsg(dev, clientCon, id,
+                                          REGION_RECTS(dirtyReg),
+                                          num_rects_d,
+                                          copyRects, numCopyRects, &cmds);
+        cmds.stores += cmds.num_stores;
+        num_stores -= cmds.num_stores;
+    }
+    else
+    {
+        /* too many rects for one message, send the copy rects in chunks
+           as separate frames, each with the part of the dirty region it
+           covers, only the tile lists get this big and those are in y x
+           order */
+        LLOGLN(10, ("rdpClientConSendPaintRectShmFd: chunking num_rects_d "
+               "%d num_rects_c %d", num_rects_d, numCopyRects));
+        for (index = 0; index < numCopyRects; index += RDP_MAX_MSG_RECTS)
+        {
+            chunk_rects = copyRects + index;
+            num_chunk_rects = RDPMIN(numCopyRects - index,
+                                     RDP_MAX_MSG_RECTS);
+            rdpRegionInit(&chunk_reg, NullBox, 0);
+            rdpRegionCopy(&chunk_reg, dirtyReg);
+            rdpRegionIntersectRects(&chunk_reg, chunk_rects,
+                                    num_chunk_rects);
+            num_rects_d = REGION_NUM_RECTS(&chunk_reg);
+            if (num_rects_d > RDP_MAX_MSG_RECTS)
+            {
+                /* the copy rects cover the dirty part of the chunk */
+                rdpClientConSendPaintRectShmFdMsg(dev, clientCon, id,
+                                                  chunk_rects,
+                                                  num_chunk_rects,
+                                                  chunk_rects,
+                                                  num_chunk_rects, &cmds);
+                cmds.num_copies = 0;
+                cmds.num_hits = 0;
+                cmds.num_fills = 0;
+            }
+            else if ((num_rects_d > 0) || (cmds.num_copies > 0) ||
+                     (cmds.num_hits > 0) || (cmds.num_fills > 0))
+            {
+                rdpClientConSendPaintRectShmFdMsg(dev, clientCon, id,
+                                                  REGION_RECTS(&chunk_reg),
+                                                  num_rects_d,
+                                                  chunk_rects,
+                                                  num_rects_d > 0 ?
+                                                  num_chunk_rects : 0,
+                                                  &cmds);
+                cmds.num_copies = 0;
+                cmds.num_hits = 0;
+                cmds.num_fills = 0;
+            }
+            rdpRegionUninit(&chunk_reg);
+        }
+    }
+    cmds.num_copies = 0;
+    cmds.num_hits = 0;
+    cmds.num_fills = 0;
+    while (num_stores > 0)
+    {
+        cmds.num_stores = RDPMIN(num_stores, RDP_MAX_MSG_CACHE_OPS);
+        rdpClientConSendPaintRectShmFdMsg(dev, clientCon, id,
+                                          NULL, 0, NULL, 0, &cmds);
+        cmds.stores += cmds.num_stores;
+        num_stores -= cmds.num_stores;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* a capture is about to start, the frame is the first after an input
+   if that input came since the last frame */
+static void
+rdpClientConFrameTimesStart(rdpClientCon *clientCon)
+{
+    struct rdp_frame_times *times;
+    CARD32 input_ms;
+
+    times = &(clientCon->frame_times);
+    g_memset(times, 0, sizeof(*times));
+    times->capture_start = g_time_usec();
+    times->damage = clientCon->damage_time;
+    input_ms = clientCon->dev->last_input_time_ms;
+    if ((input_ms != 0) && (input_ms != clientCon->input_seen_ms))
+    {
+        times->input_ms = input_ms;
+        clientCon->input_seen_ms = input_ms;
+    }
+}
+
+/******************************************************************************/
+/* move the screen copies on this monitor to the frame, the tiles they
+   land on are not what the capture last saw any more
+   returns the number of copies */
+static int
+rdpClientConTakeCopies(rdpClientCon *clientCon, BoxPtr cap_rect,
+                       struct image_data *id)
+{
+    struct rdp_screen_copy *copy;
+    struct rdp_screen_copy *frame_copy;
+    int index;
+    int num_copies;
+
+    clientCon->num_frame_copies = 0;
+    num_copies = 0;
+    for (index = 0; index < clientCon->num_copies; index++)
+    {
+        copy = clientCon->copies + index;
+        if ((copy->dst.x1 >= cap_rect->x1) && (copy->dst.y1 >= cap_rect->y1) &&
+            (copy->dst.x2 <= cap_rect->x2) && (copy->dst.y2 <= cap_rect->y2))
+        {
+            frame_copy = clientCon->frame_copies +
+                         clientCon->num_frame_copies;
+            clientCon->num_frame_copies++;
+            frame_copy->dst.x1 = copy->dst.x1 - cap_rect->x1;
+            frame_copy->dst.y1 = copy->dst.y1 - cap_rect->y1;
+            frame_copy->dst.x2 = copy->dst.x2 - cap_rect->x1;
+            frame_copy->dst.y2 = copy->dst.y2 - cap_rect->y1;
+            frame_copy->dx = copy->dx;
+            frame_copy->dy = copy->dy;
+            rdpCaptureInvalidate(clientCon, id, &(frame_copy->dst));
+        }
+        else
+        {
+            /* another monitor */
+            clientCon->copies[num_copies++] = *copy;
+        }
+    }
+    clientCon->num_copies = num_copies;
+    clientCon->screen_copies += clientCon->num_frame_copies;
+    return clientCon->num_frame_copies;
+}
+
 /******************************************************************************/
 /* this is called to capture a rect from the screen, if in a multi monitor
    session, this will get called for each monitor
@@ -2841,6 +4936,8 @@ rdpCapRect(rdpClientCon *clientCon, BoxPtr cap_rect, int mon,
     BoxPtr rects;
     BoxRec rect;
     int num_rects;
+    int num_copies;
+    int index;
 
     cap_dirty = rdpRegionCreate(cap_rect, 0);
     LLOGLN(10, ("rdpCapRect: cap_rect x1 %d y1 %d x2 %d y2 %d",
@@ -2859,15 +4956,31 @@ rdpCapRect(rdpClientCon *clientCon, BoxPtr cap_rect, int mon,
     /* make a copy of cap_dirty because it may get altered */
     cap_dirty_save = rdpRegionCreate(NullBox, 0);
     rdpRegionCopy(cap_dirty_save, cap_dirty);
-    if (num_rects > 0)
+    num_copies = rdpClientConTakeCopies(clientCon, cap_rect, id);
+    if ((num_rects > 0) || (num_copies > 0))
     {
         rects = 0;
         num_rects = 0;
         LLOGLN(10, ("rdpCapRect: capture_code %d",
                     clientCon->client_info.capture_code));
+        rdpClientConFrameTimesStart(clientCon);
         if (rdpCapture(clientCon, cap_dirty, &rects, &num_rects, id))
         {
+            clientCon->frame_times.capture_end = g_time_usec();
             LLOGLN(10, ("rdpCapRect: num_rects %d", num_rects));
+            if ((num_rects < 1) && (clientCon->num_frame_copies < 1) &&
+                (clientCon->num_frame_fills < 1) &&
+                ((clientCon->tile_cache_ops == NULL) ||
+                 (clientCon->tile_cache_ops->num_hits < 1)))
+            {
+                clientCon->frames_skipped++;
+            }
+            for (index = 0; index < num_rects; index++)
+            {
+                clientCon->bytes_converted += 4 *
+                        (rects[index].x2 - rects[index].x1) *
+                        (rects[index].y2 - rects[index].y1);
+            }
             if (clientCon->send_key_frame[mon])
             {
                 clientCon->send_key_frame[mon] = 0;
@@ -2885,11 +4998,94 @@ rdpCapRect(rdpClientCon *clientCon, BoxPtr cap_rect, int mon,
     }
     rdpRegionSubtract(clientCon->dirtyRegion, clientCon->dirtyRegion,
                       cap_dirty_save);
+    if (!rdpClientConHasUpdate(clientCon))
+    {
+        clientCon->damage_time = 0;
+    }
     rdpRegionDestroy(cap_dirty);
     rdpRegionDestroy(cap_dirty_save);
     return 0;
 }
 
+/******************************************************************************/
+/* send the fds of the whole ring once, later paint messages refer to a
+   buffer by its index, a new ring replaces the old one in xrdp */
+static int
+rdpClientConRegisterShmBuffers(rdpPtr dev, rdpClientCon *clientCon)
+{
+    struct stream *s;
+    int fds[RDP_MAX_SHM_BUFFERS];
+    int index;
+    int size;
+    int rv;
+
+    LLOGLN(0, ("rdpClientConRegisterShmBuffers: num_shm_buffers %d "
+           "shmem_bytes %d", clientCon->num_shm_buffers,
+           clientCon->shmem_bytes));
+    size = 2 + 2 + 2 + 4 + clientCon->num_shm_buffers * 2;
+    rdpClientConPreCheck(dev, clientCon, size);
+    s = clientCon->out_s;
+    out_uint16_le(s, 65); /* register shm buffers */
+    out_uint16_le(s, size);
+    clientCon->count++;
+    out_uint16_le(s, clientCon->num_shm_buffers);
+    out_uint32_le(s, clientCon->shmem_bytes);
+    for (index = 0; index < clientCon->num_shm_buffers; index++)
+    {
+        out_uint16_le(s, index); /* buffer id */
+        fds[index] = clientCon->shm_buffers[index].fd;
+    }
+    rdpClientConSendPending(dev, clientCon);
+    rv = 0;
+    if (clientCon->num_shm_buffers > 0)
+    {
+        rv = rdpClientConSendFds(dev, clientCon, fds,
+                                 clientCon->num_shm_buffers);
+    }
+    if (rv != 0)
+    {
+        LLOGLN(0, ("rdpClientConRegisterShmBuffers: rdpClientConSendFds "
+               "failed"));
+        return 1;
+    }
+    clientCon->shm_buffers_registered = TRUE;
+    return 0;
+}
+
+/******************************************************************************/
+/* capture into shared memory buffer 'buffer' and mark it in flight if
+   anything was sent from it */
+static int
+rdpCapRectShm(rdpClientCon *clientCon, BoxPtr cap_rect, int mon,
+              struct image_data *id, int buffer)
+{
+    int rect_id;
+
+    if (clientCon->shm_buffer_reg && !clientCon->shm_buffers_registered)
+    {
+        rdpClientConRegisterShmBuffers(clientCon->dev, clientCon);
+    }
+    clientCon->shm_buffer_index = buffer;
+    rdpClientConGetScreenImageRect(clientCon->dev, clientCon, id);
+    id->left = cap_rect->x1;
+    id->top = cap_rect->y1;
+    id->width = cap_rect->x2 - cap_rect->x1;
+    id->height = cap_rect->y2 - cap_rect->y1;
+    id->flags = (mon & 0xF) << 28;
+    rect_id = clientCon->rect_id;
+    rdpCapRect(clientCon, cap_rect, mon, id);
+    if (clientCon->rect_id != rect_id)
+    {
+        /* a frame sent in chunks is acked by its last rect_id */
+        clientCon->frames_sent++;
+        clientCon->shm_buffers[buffer].rect_id = clientCon->rect_id;
+        rdpClientConPaceSent(clientCon, clientCon->rect_id);
+        clientCon->shm_buffer_index = (buffer + 1) %
+                                      clientCon->num_shm_buffers;
+    }
+    return 0;
+}
+
 /******************************************************************************/
 static CARD32
 rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
@@ -2897,6 +5093,7 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
     rdpClientCon *clientCon = (rdpClientCon *)arg;
     struct image_data id;
     int index;
+    int buffer;
     int monitor_index;
     int monitor_count;
     BoxRec cap_rect;
@@ -2915,10 +5112,25 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
                clientCon->shmemstatus, clientCon->rect_id, clientCon->rect_id_ack));
         return 0;
     }
-    if ((clientCon->rect_id > clientCon->rect_id_ack) ||
-        /* do not allow captures until we have the client_info */
-        clientCon->client_info.size == 0)
+    /* do not allow captures until we have the client_info */
+    if (clientCon->client_info.size == 0)
+    {
+        return 0;
+    }
+    /* xrdp is not taking what was already sent, draining the output
+       queue reschedules */
+    if (clientCon->out_head != NULL)
+    {
+        LLOGLN(10, ("rdpDeferredUpdateCallback: %d bytes queued",
+               clientCon->out_bytes));
+        clientCon->frames_deferred++;
+        return 0;
+    }
+    /* all shared memory buffers in flight, the next ack reschedules */
+    buffer = rdpClientConGetFreeShmBuffer(clientCon);
+    if (buffer < 0)
     {
+        clientCon->frames_deferred++;
         return 0;
     }
     clientCon->lastUpdateTime = now;
@@ -2930,12 +5142,7 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
         cap_rect.y1 = 0;
         cap_rect.x2 = clientCon->rdp_width;
         cap_rect.y2 = clientCon->rdp_height;
-        rdpClientConGetScreenImageRect(clientCon->dev, clientCon, &id);
-        id.left = cap_rect.x1;
-        id.top = cap_rect.y1;
-        id.width = cap_rect.x2 - cap_rect.x1;
-        id.height = cap_rect.y2 - cap_rect.y1;
-        rdpCapRect(clientCon, &cap_rect, 0, &id);
+        rdpCapRectShm(clientCon, &cap_rect, 0, &id, buffer);
     }
     else
     {
@@ -2943,8 +5150,9 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
         monitor_count = clientCon->dev->monitorCount;
         while (monitor_index < monitor_count)
         {
-            // Did we get anything from the last monitor?
-            if (clientCon->rect_id > clientCon->rect_id_ack)
+            // Is there a buffer left for this monitor?
+            buffer = rdpClientConGetFreeShmBuffer(clientCon);
+            if (buffer < 0)
             {
                 LLOGLN(10, ("rdpDeferredUpdateCallback: reschedule rect_id %d "
                        "rect_id_ack %d",
@@ -2958,13 +5166,7 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
             cap_rect.y1 = clientCon->dev->minfo[index].top;
             cap_rect.x2 = clientCon->dev->minfo[index].right + 1;
             cap_rect.y2 = clientCon->dev->minfo[index].bottom + 1;
-            rdpClientConGetScreenImageRect(clientCon->dev, clientCon, &id);
-            id.left = cap_rect.x1;
-            id.top = cap_rect.y1;
-            id.width = cap_rect.x2 - cap_rect.x1;
-            id.height = cap_rect.y2 - cap_rect.y1;
-            id.flags = (index & 0xF) << 28;
-            rdpCapRect(clientCon, &cap_rect, index, &id);
+            rdpCapRectShm(clientCon, &cap_rect, index, &id, buffer);
             monitor_index++;
         }
         if (monitor_index == monitor_count)
@@ -2972,9 +5174,10 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
             /* gone through all monitors, nothing changed */
             rdpRegionDestroy(clientCon->dirtyRegion);
             clientCon->dirtyRegion = rdpRegionCreate(NullBox, 0);
+            clientCon->num_copies = 0;
         }
     }
-    if (rdpRegionNotEmpty(clientCon->dirtyRegion))
+    if (rdpClientConHasUpdate(clientCon))
     {
         rdpScheduleDeferredUpdate(clientCon);
     }
@@ -2983,6 +5186,28 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
 }
 
 
+/******************************************************************************/
+/* true when there was a key or button since the last frame and not long
+   ago, the frame that shows its effect should not wait for pacing */
+static int
+rdpClientConInputBoost(rdpClientCon *clientCon, CARD32 now)
+{
+    rdpPtr dev;
+    CARD32 input_time;
+
+    dev = clientCon->dev;
+    if (dev->input_boost_ms < 1)
+    {
+        return FALSE;
+    }
+    input_time = dev->last_input_time_ms;
+    if ((int) (input_time - clientCon->lastUpdateTime) <= 0)
+    {
+        return FALSE;
+    }
+    return (now - input_time) <= (CARD32) dev->input_boost_ms;
+}
+
 /******************************************************************************/
 static void
 rdpScheduleDeferredUpdate(rdpClientCon *clientCon)
@@ -2991,16 +5216,31 @@ rdpScheduleDeferredUpdate(rdpClientCon *clientCon)
     uint32_t msToWait;
     uint32_t minNextUpdateTime;
 
+    curTime = (uint32_t) GetTimeInMillis();
+    if (rdpClientConInputBoost(clientCon, curTime))
+    {
+        /* pull a paced update in too, the callback still waits for
+           shared memory and the output queue */
+        LLOGLN(10, ("rdpScheduleDeferredUpdate: input boost"));
+        clientCon->updateTimer = TimerSet(clientCon->updateTimer, 0, 1,
+                                          rdpDeferredUpdateCallback,
+                                          clientCon);
+        if (!clientCon->updateScheduled)
+        {
+            clientCon->updateScheduled = TRUE;
+            ++clientCon->updateRetries;
+        }
+        return;
+    }
     if (clientCon->updateScheduled)
     {
         return;
     }
-    curTime = (uint32_t) GetTimeInMillis();
     /* use two separate delays in order to limit the update rate and wait a bit
        for more changes before sending an update. Always waiting the longer
        delay would introduce unnecessarily much latency. */
-    msToWait = MIN_MS_TO_WAIT_FOR_MORE_UPDATES;
-    minNextUpdateTime = clientCon->lastUpdateTime + MIN_MS_BETWEEN_FRAMES;
+    msToWait = clientCon->coalesceDelay;
+    minNextUpdateTime = clientCon->lastUpdateTime + clientCon->frameInterval;
     /* the first check is to gracefully handle the infrequent case of
        the time wrapping around */
     if(clientCon->lastUpdateTime < curTime &&
@@ -3017,12 +5257,25 @@ rdpScheduleDeferredUpdate(rdpClientCon *clientCon)
     ++clientCon->updateRetries;
 }
 
+/******************************************************************************/
+/* true if there is something for the next frame */
+static int
+rdpClientConHasUpdate(rdpClientCon *clientCon)
+{
+    return rdpRegionNotEmpty(clientCon->dirtyRegion) ||
+           (clientCon->num_copies > 0);
+}
+
 /******************************************************************************/
 int
 rdpClientConAddDirtyScreenReg(rdpPtr dev, rdpClientCon *clientCon,
                               RegionPtr reg)
 {
     LLOGLN(10, ("rdpClientConAddDirtyScreenReg:"));
+    if (clientCon->damage_time == 0)
+    {
+        clientCon->damage_time = g_time_usec();
+    }
     rdpRegionUnion(clientCon->dirtyRegion, clientCon->dirtyRegion, reg);
     rdpScheduleDeferredUpdate(clientCon);
     return 0;
@@ -3061,6 +5314,8 @@ void
 rdpClientConGetScreenImageRect(rdpPtr dev, rdpClientCon *clientCon,
                                struct image_data *id)
 {
+    int index;
+
     id->left = 0;
     id->top = 0;
     id->width = dev->width;
@@ -3070,8 +5325,19 @@ rdpClientConGetScreenImageRect(rdpPtr dev, rdpClientCon *clientCon,
     id->lineBytes = dev->paddedWidthInBytes;
     id->flags = 0;
     id->pixels = dev->pfbMemory;
-    id->shmem_pixels = clientCon->shmemptr;
-    id->shmem_fd = clientCon->shmemfd;
+    index = clientCon->shm_buffer_index;
+    if (index < clientCon->num_shm_buffers)
+    {
+        id->shmem_pixels = clientCon->shm_buffers[index].ptr;
+        id->shmem_fd = clientCon->shm_buffers[index].fd;
+        id->shmem_id = clientCon->shm_buffers_registered ? index : -1;
+    }
+    else
+    {
+        id->shmem_pixels = NULL;
+        id->shmem_fd = -1;
+        id->shmem_id = -1;
+    }
     id->shmem_bytes = clientCon->shmem_bytes;
     id->shmem_offset = 0;
     id->shmem_lineBytes = clientCon->shmem_lineBytes;
@@ -3098,6 +5364,153 @@ rdpClientConAddAllReg(rdpPtr dev, RegionPtr reg, DrawablePtr pDrawable)
     return 0;
 }
 
+/******************************************************************************/
+/* true if the box and where it was copied from are on one monitor */
+static int
+rdpClientConCopyOnMonitor(rdpClientCon *clientCon, const BoxRec *box,
+                          int dx, int dy)
+{
+    rdpPtr dev;
+    BoxRec both;
+    int index;
+
+    dev = clientCon->dev;
+    both.x1 = RDPMIN(box->x1, box->x1 - dx);
+    both.y1 = RDPMIN(box->y1, box->y1 - dy);
+    both.x2 = RDPMAX(box->x2, box->x2 - dx);
+    both.y2 = RDPMAX(box->y2, box->y2 - dy);
+    if (dev->monitorCount < 1)
+    {
+        return (both.x1 >= 0) && (both.y1 >= 0) &&
+               (both.x2 <= clientCon->rdp_width) &&
+               (both.y2 <= clientCon->rdp_height);
+    }
+    for (index = 0; index < dev->monitorCount; index++)
+    {
+        if ((both.x1 >= dev->minfo[index].left) &&
+            (both.y1 >= dev->minfo[index].top) &&
+            (both.x2 <= dev->minfo[index].right + 1) &&
+            (both.y2 <= dev->minfo[index].bottom + 1))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/******************************************************************************/
+/* the pixels in reg were copied on the screen from dx, dy away, on a
+   GfxPro client xrdp does the same copy on the surface instead of the
+   pixels being sent again, anything else just makes reg dirty
+   the client's copy reads what the client has, parts of the source that
+   are dirty stay dirty where they land */
+static int
+rdpClientConAddCopy(rdpPtr dev, rdpClientCon *clientCon, RegionPtr reg,
+                    int dx, int dy)
+{
+    RegionRec src_reg;
+    BoxPtr rects;
+    int num_rects;
+    int index;
+    int band;
+    int band_end;
+    int rect;
+
+    num_rects = REGION_NUM_RECTS(reg);
+    if (num_rects < 1)
+    {
+        return 0;
+    }
+    if (!dev->screen_copy || !clientCon->screen_copy || dev->glamor ||
+        (clientCon->client_info.capture_code != CC_GFX_PRO) ||
+        ((dx == 0) && (dy == 0)) ||
+        (clientCon->num_copies + num_rects > RDP_MAX_SCREEN_COPIES))
+    {
+        return rdpClientConAddDirtyScreenReg(dev, clientCon, reg);
+    }
+    rects = REGION_RECTS(reg);
+    for (index = 0; index < num_rects; index++)
+    {
+        if (!rdpClientConCopyOnMonitor(clientCon, rects + index, dx, dy))
+        {
+            return rdpClientConAddDirtyScreenReg(dev, clientCon, reg);
+        }
+    }
+    LLOGLN(10, ("rdpClientConAddCopy: num_rects %d dx %d dy %d",
+           num_rects, dx, dy));
+    if (clientCon->damage_time == 0)
+    {
+        clientCon->damage_time = g_time_usec();
+    }
+    rdpRegionInit(&src_reg, NullBox, 0);
+    rdpRegionCopy(&src_reg, reg);
+    rdpRegionTranslate(&src_reg, -dx, -dy);
+    rdpRegionIntersect(&src_reg, &src_reg, clientCon->dirtyRegion);
+    rdpRegionTranslate(&src_reg, dx, dy);
+    rdpRegionSubtract(clientCon->dirtyRegion, clientCon->dirtyRegion, reg);
+    rdpRegionUnion(clientCon->dirtyRegion, clientCon->dirtyRegion,
+                   &src_reg);
+    rdpRegionUninit(&src_reg);
+    /* the client copies one rect at a time, order them so no rect is
+       written before it is read, like miCopyRegion, the rects are in
+       bands of the same y, top to bottom, left to right */
+    index = (dy > 0) ? num_rects - 1 : 0;
+    while ((index >= 0) && (index < num_rects))
+    {
+        band = index;
+        band_end = index;
+        if (dy > 0)
+        {
+            while ((band > 0) && (rects[band - 1].y1 == rects[index].y1))
+            {
+                band--;
+            }
+        }
+        else
+        {
+            while ((band_end + 1 < num_rects) &&
+                   (rects[band_end + 1].y1 == rects[index].y1))
+            {
+                band_end++;
+            }
+        }
+        for (rect = 0; rect <= band_end - band; rect++)
+        {
+            clientCon->copies[clientCon->num_copies].dst =
+                    rects[dx > 0 ? band_end - rect : band + rect];
+            clientCon->copies[clientCon->num_copies].dx = dx;
+            clientCon->copies[clientCon->num_copies].dy = dy;
+            clientCon->num_copies++;
+        }
+        index = (dy > 0) ? band - 1 : band_end + 1;
+    }
+    rdpScheduleDeferredUpdate(clientCon);
+    return 0;
+}
+
+/******************************************************************************/
+/* reg on the screen was copied from dx, dy away, see rdpClientConAddCopy */
+int
+rdpClientConAddAllCopy(rdpPtr dev, RegionPtr reg, int dx, int dy,
+                       DrawablePtr pDrawable)
+{
+    rdpClientCon *clientCon;
+    Bool drw_is_vis;
+
+    drw_is_vis = XRDP_DRAWABLE_IS_VISIBLE(dev, pDrawable);
+    if (!drw_is_vis)
+    {
+        return 0;
+    }
+    clientCon = dev->clientConHead;
+    while (clientCon != NULL)
+    {
+        rdpClientConAddCopy(dev, clientCon, reg, dx, dy);
+        clientCon = clientCon->next;
+    }
+    return 0;
+}
+
 /******************************************************************************/
 int
 rdpClientConAddAllBox(rdpPtr dev, BoxPtr box, DrawablePtr pDrawable)
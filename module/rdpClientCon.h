@@ -21,6 +21,8 @@ Client connection to xrdp
 
 */
 
+#include <pthread.h>
+
 #include <xorg-server.h>
 #include <xorgVersion.h>
 #include <xf86.h>
@@ -49,6 +51,91 @@ struct rdpup_os_bitmap
     int stamp;
 };
 
+/* most shared memory buffers in the ring, see XORGXRDP_SHM_BUFFERS */
+#define RDP_MAX_SHM_BUFFERS 8
+
+/* one shared memory buffer of the ring, it is free for the next capture
+   once xrdp has acked rect_id, the last frame sent from it */
+struct rdp_shm_buffer
+{
+    uint8_t *ptr;
+    int fd;
+    int rect_id;
+};
+
+/* most screen copies waiting for a frame, see rdpClientConAddAllCopy */
+#define RDP_MAX_SCREEN_COPIES 64
+
+/* a rect of the screen that was copied from dx, dy away, the source is
+   dst moved by -dx, -dy */
+struct rdp_screen_copy
+{
+    BoxRec dst;
+    int dx;
+    int dy;
+};
+
+/* a rect of one colour, a8r8g8b8, the client fills it instead of it
+   being encoded */
+struct rdp_solid_fill
+{
+    BoxRec rect;
+    uint32_t pixel;
+};
+
+/* data xrdp has not taken yet, sent when the socket is writable */
+struct rdp_out_buf
+{
+    struct rdp_out_buf *next;
+    char *data;
+    int len;
+    int offset; /* bytes already sent */
+    int num_fds; /* go with the first byte, own copies */
+    int fds[RDP_MAX_SHM_BUFFERS];
+};
+
+/* frames remembered to measure the ack round trip */
+#define RDP_PACE_SLOTS 16
+
+/* where a frame's time went, microseconds from g_time_usec */
+struct rdp_frame_times
+{
+    uint64_t damage; /* oldest damage in the frame */
+    uint64_t capture_start;
+    uint64_t capture_end;
+    uint64_t send;
+    CARD32 input_ms; /* key or button the frame is the first after, or 0 */
+};
+
+struct rdp_pace_slot
+{
+    int rect_id;
+    CARD32 send_time; /* millisecond timestamp */
+    struct rdp_frame_times times;
+};
+
+/* log2 buckets, bucket n counts values from 2^n up to 2^(n + 1) us */
+#define RDP_HIST_BUCKETS 24
+
+struct rdp_hist
+{
+    unsigned int count;
+    unsigned int max;
+    uint64_t sum;
+    unsigned int buckets[RDP_HIST_BUCKETS];
+};
+
+enum rdp_latency
+{
+    RDP_LAT_QUEUE = 0, /* first damage to capture start */
+    RDP_LAT_CAPTURE, /* capture start to end */
+    RDP_LAT_SEND, /* capture end to message queued */
+    RDP_LAT_ACK, /* message queued to ack, encode, network and decode */
+    RDP_LAT_TOTAL, /* first damage to ack */
+    RDP_LAT_INPUT, /* key or button to ack of the first frame after */
+    RDP_LAT_COUNT
+};
+
 enum shared_memory_status {
     SHM_UNINITIALIZED = 0,
     SHM_RESIZING,
@@ -69,7 +156,34 @@ struct _rdpClientCon
     int sckControlListener;
     int sckControl;
     struct stream *out_s;
-    struct stream *in_s;
+    struct stream *in_s; /* the message being processed */
+
+    /* bytes received but not parsed yet, see rdpClientConGotData */
+    char *recv_data;
+    int recv_size;
+    int recv_bytes;
+
+    /* the socket is read on the server's input thread, input goes to
+       the drivers from there, other messages are passed to the main
+       thread in main_data and input_pipe wakes it up */
+    int input_thread; /* boolean */
+    int input_pipe[2];
+    pthread_mutex_t input_mutex;
+    char *main_data; /* whole messages, as on the wire */
+    int main_size;
+    int main_bytes;
+    int input_closed; /* boolean, the input thread lost the connection,
+                         connected is only changed on the main thread */
+
+    /* output queue, everything sent goes through it once it is not
+       empty so the order on the socket is kept */
+    struct rdp_out_buf *out_head;
+    struct rdp_out_buf *out_tail;
+    int out_bytes;
+    int out_notify; /* boolean, waiting for the socket to be writable */
+    int out_notify_sck; /* dup of sck for write notify when input_thread,
+                           -1 if none */
+    OsTimerPtr out_timer; /* servers without write notification */
 
     int connected; /* boolean. Set to False when I/O fails */
     int begin; /* boolean */
@@ -106,9 +220,12 @@ struct _rdpClientCon
 
     struct xrdp_client_info client_info;
 
-    uint8_t *shmemptr;
-    int shmemfd;
-    int shmem_bytes;
+    struct rdp_shm_buffer shm_buffers[RDP_MAX_SHM_BUFFERS];
+    int num_shm_buffers;
+    int shm_buffer_index; /* buffer the capture in progress goes to */
+    int shm_buffer_reg; /* xrdp takes registered buffer ids, msg 109 */
+    int shm_buffers_registered; /* ring was sent to xrdp with msg 65 */
+    int shmem_bytes; /* of each buffer */
     int shmem_lineBytes;
     RegionPtr shmRegion;
     int rect_id;
@@ -120,12 +237,64 @@ struct _rdpClientCon
     int updateScheduled; /* boolean */
     int updateRetries;
 
+    /* adaptive pacing, the frame interval follows the ack round trip */
+    struct rdp_pace_slot pace_slots[RDP_PACE_SLOTS];
+    int srtt8; /* smoothed round trip in ms * 8, 0 until the first ack */
+    int rttvar4; /* mean deviation of the round trip in ms * 4 */
+    int frameInterval; /* min ms between frames */
+    int coalesceDelay; /* ms to wait for more changes */
+
+    /* latency instrumentation, see rdpClientConPaceAck */
+    struct rdp_frame_times frame_times; /* frame being captured */
+    uint64_t damage_time; /* oldest damage not captured yet, 0 if none */
+    CARD32 input_seen_ms; /* last input a frame was counted against */
+    struct rdp_hist latency[RDP_LAT_COUNT];
+
+    /* counters for the stats query on the control socket */
+    uint64_t frames_sent;
+    uint64_t frames_skipped; /* captured, nothing had changed */
+    uint64_t frames_deferred; /* waited for xrdp to catch up */
+    uint64_t tiles_hashed;
+    uint64_t tiles_skipped; /* hash matched what was last sent */
+    uint64_t tiles_cached; /* copied from the client's tile cache */
+    uint64_t tiles_solid; /* changed tiles of one colour */
+    uint64_t screen_copies; /* rects copied on the client's surface */
+    uint64_t scrolls_detected; /* found by comparing row hashes */
+    uint64_t bytes_converted; /* source bytes read by the capture */
+
     RegionPtr dirtyRegion;
 
     int num_rfx_crcs_alloc[16];
     uint64_t *rfx_crcs[16];
     int send_key_frame[16];
 
+    /* GfxPro tiles the client has cached, NULL unless xrdp sent msg 110 */
+    struct rdp_tile_cache *tile_cache;
+    struct rdp_tile_cache_ops *tile_cache_ops; /* for the frame being sent */
+
+    /* GfxPro screen to screen copies, xrdp sent msg 111
+       copies are in screen coordinates and in the order they were done,
+       frame_copies are the ones for the frame being sent, in monitor
+       coordinates, with room for a scroll found by the capture */
+    int screen_copy; /* boolean */
+    struct rdp_screen_copy copies[RDP_MAX_SCREEN_COPIES];
+    int num_copies;
+    struct rdp_screen_copy frame_copies[RDP_MAX_SCREEN_COPIES + 1];
+    int num_frame_copies;
+
+    /* hash of each 64 pixel strip of each row as the client has it, for
+       the scroll detection, 0 is not known */
+    int num_row_hashes_alloc[16];
+    uint64_t *row_hashes[16];
+
+    /* GfxPro tiles of one colour sent as solid fills, xrdp sent msg 112
+       frame_fills are the ones for the frame being sent, in monitor
+       coordinates */
+    int solid_fill; /* boolean */
+    struct rdp_solid_fill *frame_fills;
+    int num_frame_fills;
+    int num_frame_fills_alloc;
+
     /* true = skip drawing */
     int suppress_output;
 
@@ -176,6 +345,9 @@ rdpClientConAddAllReg(rdpPtr dev, RegionPtr reg, DrawablePtr pDrawable);
 extern _X_EXPORT int
 rdpClientConAddAllBox(rdpPtr dev, BoxPtr box, DrawablePtr pDrawable);
 extern _X_EXPORT int
+rdpClientConAddAllCopy(rdpPtr dev, RegionPtr reg, int dx, int dy,
+                       DrawablePtr pDrawable);
+extern _X_EXPORT int
 rdpClientConSetCursor(rdpPtr dev, rdpClientCon *clientCon,
                       short x, short y, uint8_t *cur_data, uint8_t *cur_mask);
 extern _X_EXPORT int
@@ -187,5 +359,7 @@ rdpClientConSetCursorShmFd(rdpPtr dev, rdpClientCon *clientCon,
                            short x, short y,
                            uint8_t *cur_data, uint8_t *cur_mask, int bpp,
                            int width, int height);
+extern _X_EXPORT unsigned int
+rdpHistPercentile(const struct rdp_hist *hist, int pct);
 
 #endif
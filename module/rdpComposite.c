@@ -75,11 +75,13 @@ rdpComposite(CARD8 op, PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst,
     PictureScreenPtr ps;
     BoxRec box;
     RegionRec reg;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpComposite:"));
     pScreen = pDst->pDrawable->pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpCompositeCallCount++;
+    RDP_PROF_BEGIN(dev);
     box.x1 = xDst + pDst->pDrawable->x;
     box.y1 = yDst + pDst->pDrawable->y;
     box.x2 = box.x1 + width;
@@ -91,8 +93,11 @@ rdpComposite(CARD8 op, PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst,
     }
     ps = GetPictureScreen(pScreen);
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpCompositeOrg(ps, dev, op, pSrc, pMask, pDst, xSrc, ySrc,
                     xMask, yMask, xDst, yDst, width, height);
+    RDP_PROF_ORG_END(dev);
     rdpClientConAddAllReg(dev, &reg, pDst->pDrawable);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpCompositeCallCount);
 }
@@ -69,11 +69,13 @@ rdpCompositeRects(CARD8 op, PicturePtr dst, xRenderColor * color,
     rdpPtr dev;
     PictureScreenPtr ps;
     RegionPtr reg;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpCompositeRects:"));
     pScreen = dst->pDrawable->pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpCompositeRectsCallCount++;
+    RDP_PROF_BEGIN(dev);
     reg = rdpRegionFromRects(num_rects, rects, CT_NONE);
     rdpRegionTranslate(reg, dst->pDrawable->x, dst->pDrawable->y);
     if (dst->pCompositeClip != NULL)
@@ -82,7 +84,10 @@ rdpCompositeRects(CARD8 op, PicturePtr dst, xRenderColor * color,
     }
     ps = GetPictureScreen(pScreen);
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpCompositeRectsOrg(ps, dev, op, dst, color, num_rects, rects);
+    RDP_PROF_ORG_END(dev);
     rdpClientConAddAllReg(dev, reg, dst->pDrawable);
     rdpRegionDestroy(reg);
+    RDP_PROF_END(dev, rdpCompositeRectsCallCount);
 }
@@ -59,6 +59,67 @@ rdpCopyAreaOrg(DrawablePtr pSrc, DrawablePtr pDst, GCPtr pGC,
     return rv;
 }
 
+/******************************************************************************/
+/* returns TRUE if the GC just copies the source pixels, only then can the
+   client do the copy */
+static Bool
+rdpCopyAreaIsPlain(DrawablePtr pDst, GCPtr pGC)
+{
+    unsigned long depth_mask;
+
+    if (pGC->alu != GXcopy)
+    {
+        return FALSE;
+    }
+    if (pDst->depth >= 32)
+    {
+        depth_mask = 0xFFFFFFFF;
+    }
+    else
+    {
+        depth_mask = (1UL << pDst->depth) - 1;
+    }
+    return (pGC->planemask & depth_mask) == depth_mask;
+}
+
+/******************************************************************************/
+/* a copy from the screen to the screen, the part of reg that came from
+   visible pixels is copied on the client, the rest is dirty */
+static void
+rdpCopyAreaScreen(rdpPtr dev, DrawablePtr pSrc, DrawablePtr pDst, GCPtr pGC,
+                  RegionPtr reg, int dx, int dy)
+{
+    RegionRec copy_reg;
+    BoxRec box;
+
+    if (pSrc->type == DRAWABLE_WINDOW)
+    {
+        rdpRegionInit(&copy_reg, NullBox, 0);
+        if (pGC->subWindowMode == IncludeInferiors)
+        {
+            rdpRegionCopy(&copy_reg, &(((WindowPtr)pSrc)->borderClip));
+        }
+        else
+        {
+            rdpRegionCopy(&copy_reg, &(((WindowPtr)pSrc)->clipList));
+        }
+    }
+    else
+    {
+        box.x1 = 0;
+        box.y1 = 0;
+        box.x2 = pSrc->width;
+        box.y2 = pSrc->height;
+        rdpRegionInit(&copy_reg, &box, 0);
+    }
+    rdpRegionTranslate(&copy_reg, dx, dy);
+    rdpRegionIntersect(&copy_reg, &copy_reg, reg);
+    rdpRegionSubtract(reg, reg, &copy_reg);
+    rdpClientConAddAllCopy(dev, &copy_reg, dx, dy, pDst);
+    rdpClientConAddAllReg(dev, reg, pDst);
+    rdpRegionUninit(&copy_reg);
+}
+
 /******************************************************************************/
 RegionPtr
 rdpCopyArea(DrawablePtr pSrc, DrawablePtr pDst, GCPtr pGC,
@@ -69,11 +130,15 @@ rdpCopyArea(DrawablePtr pSrc, DrawablePtr pDst, GCPtr pGC,
     RegionRec clip_reg;
     RegionRec reg;
     int cd;
+    int dx;
+    int dy;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpCopyArea:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpCopyAreaCallCount++;
+    RDP_PROF_BEGIN(dev);
     box.x1 = dstx + pDst->x;
     box.y1 = dsty + pDst->y;
     box.x2 = box.x1 + w;
@@ -87,12 +152,27 @@ rdpCopyArea(DrawablePtr pSrc, DrawablePtr pDst, GCPtr pGC,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rv = rdpCopyAreaOrg(pSrc, pDst, pGC, srcx, srcy, w, h, dstx, dsty);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
-        rdpClientConAddAllReg(dev, &reg, pDst);
+        dx = (dstx + pDst->x) - (srcx + pSrc->x);
+        dy = (dsty + pDst->y) - (srcy + pSrc->y);
+        if (((dx != 0) || (dy != 0)) &&
+            rdpCopyAreaIsPlain(pDst, pGC) &&
+            XRDP_DRAWABLE_IS_VISIBLE(dev, pSrc) &&
+            XRDP_DRAWABLE_IS_VISIBLE(dev, pDst))
+        {
+            rdpCopyAreaScreen(dev, pSrc, pDst, pGC, &reg, dx, dy);
+        }
+        else
+        {
+            rdpClientConAddAllReg(dev, &reg, pDst);
+        }
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpCopyAreaCallCount);
     return rv;
 }
@@ -73,10 +73,12 @@ rdpCopyPlane(DrawablePtr pSrc, DrawablePtr pDst,
     RegionRec reg;
     int cd;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpCopyPlane:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpCopyPlaneCallCount++;
+    RDP_PROF_BEGIN(dev);
     box.x1 = pDst->x + dstx;
     box.y1 = pDst->y + dsty;
     box.x2 = box.x1 + w;
@@ -90,13 +92,16 @@ rdpCopyPlane(DrawablePtr pSrc, DrawablePtr pDst,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rv = rdpCopyPlaneOrg(pSrc, pDst, pGC, srcx, srcy, w, h,
                          dstx, dsty, bitPlane);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDst);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpCopyPlaneCallCount);
     return rv;
 }
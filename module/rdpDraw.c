@@ -308,11 +308,13 @@ rdpCopyWindow(WindowPtr pWin, DDXPointRec ptOldOrg, RegionPtr pOldRegion)
     int num_reg_rects;
     BoxPtr box;
     BoxRec box1;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpCopyWindow:"));
     pScreen = pWin->drawable.pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpCopyWindowCallCount++;
+    RDP_PROF_BEGIN(dev);
 
     rdpRegionInit(&reg, NullBox, 0);
     rdpRegionCopy(&reg, pOldRegion);
@@ -321,9 +323,11 @@ rdpCopyWindow(WindowPtr pWin, DDXPointRec ptOldOrg, RegionPtr pOldRegion)
     dx = pWin->drawable.x - ptOldOrg.x;
     dy = pWin->drawable.y - ptOldOrg.y;
 
+    RDP_PROF_ORG_BEGIN(dev);
     dev->pScreen->CopyWindow = dev->CopyWindow;
     dev->pScreen->CopyWindow(pWin, ptOldOrg, pOldRegion);
     dev->pScreen->CopyWindow = rdpCopyWindow;
+    RDP_PROF_ORG_END(dev);
 
     num_clip_rects = REGION_NUM_RECTS(&clip);
     num_reg_rects = REGION_NUM_RECTS(&reg);
@@ -348,11 +352,12 @@ rdpCopyWindow(WindowPtr pWin, DDXPointRec ptOldOrg, RegionPtr pOldRegion)
         {
             rdpRegionTranslate(&reg, dx, dy);
             rdpRegionIntersect(&reg, &reg, &clip);
-            rdpClientConAddAllReg(dev, &reg, &(pWin->drawable));
+            rdpClientConAddAllCopy(dev, &reg, dx, dy, &(pWin->drawable));
         }
     }
     rdpRegionUninit(&reg);
     rdpRegionUninit(&clip);
+    RDP_PROF_END(dev, rdpCopyWindowCallCount);
 }
 
 #if XRDP_CLOSESCR == 1 /* before v1.13 */
@@ -422,3 +427,16 @@ rdpGetDevFromScreen(ScreenPtr pScreen)
     dev = XRDPPTR(pScrn);
     return dev;
 }
+
+/******************************************************************************/
+/* called from RDP_PROF_END when dev->profile_ops is set */
+void
+rdpDrawProfileAdd(rdpPtr dev, int op, uint64_t total_ns, uint64_t org_ns)
+{
+    struct rdp_op_prof *prof;
+
+    prof = dev->op_prof + op;
+    prof->calls++;
+    prof->org_ns += org_ns;
+    prof->wrap_ns += total_ns > org_ns ? total_ns - org_ns : 0;
+}
@@ -24,6 +24,9 @@ misc draw calls
 #ifndef __RDPDRAW_H
 #define __RDPDRAW_H
 
+#include <stddef.h>
+#include <time.h>
+
 #include <xorg-server.h>
 #include <xorgVersion.h>
 #include <xf86.h>
@@ -80,6 +83,55 @@ do { \
     (_pGC)->ops = &g_rdpGCOps; \
 } while (0)
 
+/******************************************************************************/
+/* optional cost profiling of the wrappers, the bookkeeping around the
+   original op and the op itself are timed separately, the op slot is
+   the index of its counter in dev->counts */
+#define RDP_PROF_VARS uint64_t prof_start; uint64_t prof_time; uint64_t prof_org
+
+#define RDP_PROF_BEGIN(_dev) \
+do { \
+    prof_start = (_dev)->profile_ops ? rdpDrawProfileTime() : 0; \
+    prof_time = 0; \
+    prof_org = 0; \
+} while (0)
+
+#define RDP_PROF_ORG_BEGIN(_dev) \
+do { \
+    if (prof_start != 0) \
+    { \
+        prof_time = rdpDrawProfileTime(); \
+    } \
+} while (0)
+
+#define RDP_PROF_ORG_END(_dev) \
+do { \
+    if (prof_start != 0) \
+    { \
+        prof_org += rdpDrawProfileTime() - prof_time; \
+    } \
+} while (0)
+
+#define RDP_PROF_END(_dev, _count) \
+do { \
+    if (prof_start != 0) \
+    { \
+        rdpDrawProfileAdd(_dev, \
+                          offsetof(struct _rdpCounts, _count) / sizeof(CARD32), \
+                          rdpDrawProfileTime() - prof_start, prof_org); \
+    } \
+} while (0)
+
+/******************************************************************************/
+static __inline__ uint64_t
+rdpDrawProfileTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 extern GCOps g_rdpGCOps; /* in rdpGC.c */
 
 extern _X_EXPORT int
@@ -106,5 +158,7 @@ extern _X_EXPORT WindowPtr
 rdpGetRootWindowPtr(ScreenPtr pScreen);
 extern _X_EXPORT rdpPtr
 rdpGetDevFromScreen(ScreenPtr pScreen);
+extern _X_EXPORT void
+rdpDrawProfileAdd(rdpPtr dev, int op, uint64_t total_ns, uint64_t org_ns);
 
 #endif
@@ -545,7 +545,8 @@ rdpEglOut(rdpClientCon *clientCon, struct rdp_egl *egl, RegionPtr in_reg,
     int out_rect_index;
     int status;
     BoxRec rect;
-    RegionRec tile_reg;
+    uint8_t *tile_map;
+    int tile_index;
     uint8_t *dst;
     uint8_t *tile_dst;
     int crc_offset;
@@ -579,6 +580,12 @@ rdpEglOut(rdpClientCon *clientCon, struct rdp_egl *egl, RegionPtr in_reg,
         clientCon->rfx_crcs[mon_index] = g_new0(uint64_t, num_crcs);
     }
     tile_extents_stride = (tile_extents_rect->x2 - tile_extents_rect->x1) / 64;
+    /* classify all the tiles in one go, in_reg is only trimmed at the end */
+    tile_map = g_new(uint8_t, RDPMAX(tile_extents_stride *
+                     ((tile_extents_rect->y2 - tile_extents_rect->y1) / 64),
+                     1));
+    rdpRegionTileMap(in_reg, tile_extents_rect, 64, tile_map);
+    tile_index = 0;
     out_rect_index = 0;
     y = tile_extents_rect->y1;
     while (y < tile_extents_rect->y2)
@@ -592,13 +599,10 @@ rdpEglOut(rdpClientCon *clientCon, struct rdp_egl *egl, RegionPtr in_reg,
             rect.y2 = rect.y1 + 64;
             LLOGLN(10, ("rdpEglOut: x1 %d y1 %d x2 %d y2 %d",
                    rect.x1, rect.y1, rect.x2, rect.y2));
-            rcode = rdpRegionContainsRect(in_reg, &rect);
+            rcode = tile_map[tile_index++];
             if (rcode == rgnOUT)
             {
                 LLOGLN(10, ("rdpEglOut: rgnOUT"));
-                rdpRegionInit(&tile_reg, &rect, 0);
-                rdpRegionSubtract(in_reg, in_reg, &tile_reg);
-                rdpRegionUninit(&tile_reg);
             }
             else
             {
@@ -625,9 +629,6 @@ rdpEglOut(rdpClientCon *clientCon, struct rdp_egl *egl, RegionPtr in_reg,
                 if (crc == clientCon->rfx_crcs[mon_index][crc_offset])
                 {
                     LLOGLN(10, ("rdpEglOut: crc skip at x %d y %d", x, y));
-                    rdpRegionInit(&tile_reg, &rect, 0);
-                    rdpRegionSubtract(in_reg, in_reg, &tile_reg);
-                    rdpRegionUninit(&tile_reg);
                 }
                 else
                 {
@@ -635,15 +636,7 @@ rdpEglOut(rdpClientCon *clientCon, struct rdp_egl *egl, RegionPtr in_reg,
                                  GL_UNSIGNED_INT_8_8_8_8_REV, tile_dst);
                     clientCon->rfx_crcs[mon_index][crc_offset] = crc;
                     out_rects[out_rect_index] = rect;
-                    if (out_rect_index < RDP_MAX_TILES)
-                    {
-                        out_rect_index++;
-                    }
-                    else
-                    {
-                        LLOGLN(0, ("rdpEglOut: too many out rects %d",
-                               out_rect_index));
-                    }
+                    out_rect_index++;
                 }
 
             }
@@ -651,6 +644,9 @@ rdpEglOut(rdpClientCon *clientCon, struct rdp_egl *egl, RegionPtr in_reg,
         }
         y += XRDP_RFX_ALIGN;
     }
+    free(tile_map);
+    /* the out rects are in tile order, drop the skipped tiles */
+    rdpRegionIntersectRects(in_reg, out_rects, out_rect_index);
     *num_out_rects = out_rect_index;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     return 0;
@@ -708,12 +704,6 @@ rdpEglCaptureRfx(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
     {
         return FALSE;
     }
-    *out_rects = g_new(BoxRec, RDP_MAX_TILES);
-    if (*out_rects == NULL)
-    {
-        return FALSE;
-    }
-
     rdpRegionTranslate(in_reg, -id->left, -id->top);
 
     extents_rect = *rdpRegionExtents(in_reg);
@@ -724,10 +714,17 @@ rdpEglCaptureRfx(rdpClientCon *clientCon, RegionPtr in_reg, BoxPtr *out_rects,
     width = tile_extents_rect.x2 - tile_extents_rect.x1;
     height = tile_extents_rect.y2 - tile_extents_rect.y1;
     LLOGLN(10, ("rdpEglCaptureRfx: width %d height %d", width, height));
+    /* room for every tile, they are sent in several messages if needed */
+    *out_rects = g_new(BoxRec, RDPMAX((width / 64) * (height / 64), 1));
+    if (*out_rects == NULL)
+    {
+        return FALSE;
+    }
     crcs = g_new(int, (width / 64) * (height / 64));
     if (crcs == NULL)
     {
-        free(out_rects);
+        free(*out_rects);
+        *out_rects = NULL;
         return FALSE;
     }
     rfxGC = GetScratchGC(dev->depth, pScreen);
@@ -76,10 +76,12 @@ rdpFillPolygon(DrawablePtr pDrawable, GCPtr pGC,
     int x;
     int y;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpFillPolygon:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpFillPolygonCallCount++;
+    RDP_PROF_BEGIN(dev);
     box.x1 = 0;
     box.y1 = 0;
     box.x2 = 0;
@@ -113,11 +115,14 @@ rdpFillPolygon(DrawablePtr pDrawable, GCPtr pGC,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpFillPolygonOrg(pDrawable, pGC, shape, mode, count, pPts);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpFillPolygonCallCount);
 }
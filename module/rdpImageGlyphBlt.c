@@ -69,10 +69,12 @@ rdpImageGlyphBlt(DrawablePtr pDrawable, GCPtr pGC,
     RegionRec reg;
     int cd;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(0, ("rdpImageGlyphBlt:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpImageGlyphBltCallCount++;
+    RDP_PROF_BEGIN(dev);
     GetTextBoundingBox(pDrawable, pGC->font, x, y, nglyph, &box);
     rdpRegionInit(&reg, &box, 0);
     rdpRegionInit(&clip_reg, NullBox, 0);
@@ -83,11 +85,14 @@ rdpImageGlyphBlt(DrawablePtr pDrawable, GCPtr pGC,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpImageGlyphBltOrg(pDrawable, pGC, x, y, nglyph, ppci, pglyphBase);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpImageGlyphBltCallCount);
 }
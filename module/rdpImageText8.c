@@ -67,10 +67,12 @@ rdpImageText8(DrawablePtr pDrawable, GCPtr pGC,
     RegionRec reg;
     int cd;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpImageText8:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpImageText8CallCount++;
+    RDP_PROF_BEGIN(dev);
     GetTextBoundingBox(pDrawable, pGC->font, x, y, count, &box);
     rdpRegionInit(&reg, &box, 0);
     rdpRegionInit(&clip_reg, NullBox, 0);
@@ -81,11 +83,14 @@ rdpImageText8(DrawablePtr pDrawable, GCPtr pGC,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpImageText8Org(pDrawable, pGC, x, y, count, chars);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpImageText8CallCount);
 }
@@ -92,6 +92,26 @@ rdpUnregisterInputCallback(rdpInputEventProcPtr proc)
     return 1;
 }
 
+/******************************************************************************/
+/* pass on a held back motion event, called before any other input so
+   buttons, scrolling and keys keep their place relative to it, and at
+   the end of each batch of messages from xrdp */
+int
+rdpInputFlush(rdpPtr dev)
+{
+    if (!dev->motion_pending)
+    {
+        return 0;
+    }
+    dev->motion_pending = FALSE;
+    if (g_input_proc[1].proc != 0)
+    {
+        return g_input_proc[1].proc(dev, WM_MOUSEMOVE,
+                                    dev->motion_x, dev->motion_y, 0, 0);
+    }
+    return 0;
+}
+
 /******************************************************************************/
 int
 rdpInputKeyboardEvent(rdpPtr dev, int msg,
@@ -99,7 +119,9 @@ rdpInputKeyboardEvent(rdpPtr dev, int msg,
                       long param3, long param4)
 {
     dev->last_event_time_ms = GetTimeInMillis();
+    dev->last_input_time_ms = dev->last_event_time_ms;
 
+    rdpInputFlush(dev);
     if (g_input_proc[0].proc != 0)
     {
         return g_input_proc[0].proc(dev, msg, param1, param2, param3, param4);
@@ -115,6 +137,20 @@ rdpInputMouseEvent(rdpPtr dev, int msg,
 {
     dev->last_event_time_ms = GetTimeInMillis();
 
+    if ((msg == WM_MOUSEMOVE) && dev->coalesce_motion)
+    {
+        /* only the last position of a run of moves matters */
+        dev->motion_pending = TRUE;
+        dev->motion_x = param1;
+        dev->motion_y = param2;
+        return 0;
+    }
+    if (msg != WM_MOUSEMOVE)
+    {
+        /* clicks and wheel, hover and drag stay paced */
+        dev->last_input_time_ms = dev->last_event_time_ms;
+    }
+    rdpInputFlush(dev);
     if (g_input_proc[1].proc != 0)
     {
         return g_input_proc[1].proc(dev, msg, param1, param2, param3, param4);
@@ -37,6 +37,8 @@ rdpRegisterInputCallback(int type, rdpInputEventProcPtr proc);
 extern _X_EXPORT int
 rdpUnregisterInputCallback(rdpInputEventProcPtr proc);
 extern _X_EXPORT int
+rdpInputFlush(rdpPtr dev);
+extern _X_EXPORT int
 rdpInputKeyboardEvent(rdpPtr dev, int msg,
                       long param1, long param2,
                       long param3, long param4);
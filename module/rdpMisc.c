@@ -35,8 +35,10 @@ the rest
 #include <sys/un.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
@@ -221,6 +223,17 @@ g_sleep(int msecs)
     usleep(msecs * 1000);
 }
 
+/*****************************************************************************/
+/* monotonic microseconds, for measuring, not related to wall time */
+uint64_t
+g_time_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /*****************************************************************************/
 int
 g_sck_send(int sck, const void *ptr, int len, int flags)
@@ -228,6 +241,13 @@ g_sck_send(int sck, const void *ptr, int len, int flags)
     return send(sck, ptr, len, flags);
 }
 
+/*****************************************************************************/
+int
+g_sck_writev(int sck, const struct iovec *iov, int count)
+{
+    return writev(sck, iov, count);
+}
+
 /*****************************************************************************/
 void
 g_sprintf(char *dest, const char *format, ...)
@@ -59,8 +59,13 @@ extern _X_EXPORT int
 g_sck_last_error_would_block(int sck);
 extern _X_EXPORT void
 g_sleep(int msecs);
+extern _X_EXPORT uint64_t
+g_time_usec(void);
 extern _X_EXPORT int
 g_sck_send(int sck, const void *ptr, int len, int flags);
+struct iovec;
+extern _X_EXPORT int
+g_sck_writev(int sck, const struct iovec *iov, int count);
 extern _X_EXPORT void
 g_sprintf(char *dest, const char *format, ...);
 extern _X_EXPORT int
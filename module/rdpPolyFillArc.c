@@ -68,10 +68,12 @@ rdpPolyFillArc(DrawablePtr pDrawable, GCPtr pGC, int narcs, xArc *parcs)
     int extra;
     RegionRec clip_reg;
     RegionRec reg;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPolyFillArc:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyFillArcCallCount++;
+    RDP_PROF_BEGIN(dev);
     rdpRegionInit(&reg, NullBox, 0);
     if (narcs > 0)
     {
@@ -98,11 +100,14 @@ rdpPolyFillArc(DrawablePtr pDrawable, GCPtr pGC, int narcs, xArc *parcs)
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpPolyFillArcOrg(pDrawable, pGC, narcs, parcs);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpPolyFillArcCallCount);
 }
@@ -66,10 +66,12 @@ rdpPolyFillRect(DrawablePtr pDrawable, GCPtr pGC, int nrectFill,
     RegionRec clip_reg;
     RegionPtr reg;
     int cd;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPolyFillRect:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyFillRectCallCount++;
+    RDP_PROF_BEGIN(dev);
     /* make a copy of rects */
     reg = rdpRegionFromRects(nrectFill, prectInit, CT_NONE);
     rdpRegionTranslate(reg, pDrawable->x, pDrawable->y);
@@ -81,11 +83,14 @@ rdpPolyFillRect(DrawablePtr pDrawable, GCPtr pGC, int nrectFill,
         rdpRegionIntersect(reg, &clip_reg, reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpPolyFillRectOrg(pDrawable, pGC, nrectFill, prectInit);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionDestroy(reg);
+    RDP_PROF_END(dev, rdpPolyFillRectCallCount);
 }
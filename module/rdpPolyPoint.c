@@ -68,10 +68,12 @@ rdpPolyPoint(DrawablePtr pDrawable, GCPtr pGC, int mode,
     int cd;
     int index;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPolyPoint:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyPointCallCount++;
+    RDP_PROF_BEGIN(dev);
     rdpRegionInit(&reg, NullBox, 0);
     for (index = 0; index < npt; index++)
     {
@@ -89,11 +91,14 @@ rdpPolyPoint(DrawablePtr pDrawable, GCPtr pGC, int mode,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpPolyPointOrg(pDrawable, pGC, mode, npt, in_pts);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpPolyPointCallCount);
 }
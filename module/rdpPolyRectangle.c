@@ -75,10 +75,12 @@ rdpPolyRectangle(DrawablePtr pDrawable, GCPtr pGC, int nrects,
     int y2;
     RegionRec clip_reg;
     RegionRec reg;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPolyRectangle:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyRectangleCallCount++;
+    RDP_PROF_BEGIN(dev);
     rdpRegionInit(&reg, NullBox, 0);
     lw = pGC->lineWidth;
     if (lw < 1)
@@ -128,11 +130,14 @@ rdpPolyRectangle(DrawablePtr pDrawable, GCPtr pGC, int nrects,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpPolyRectangleOrg(pDrawable, pGC, nrects, rects);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpPolyRectangleCallCount);
 }
@@ -70,10 +70,12 @@ rdpPolySegment(DrawablePtr pDrawable, GCPtr pGC, int nseg, xSegment *pSegs)
     int x2;
     int y2;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPolySegment:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolySegmentCallCount++;
+    RDP_PROF_BEGIN(dev);
     rdpRegionInit(&reg, NullBox, 0);
     for (index = 0; index < nseg; index++)
     {
@@ -95,11 +97,14 @@ rdpPolySegment(DrawablePtr pDrawable, GCPtr pGC, int nseg, xSegment *pSegs)
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpPolySegmentOrg(pDrawable, pGC, nseg, pSegs);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpPolySegmentCallCount);
 }
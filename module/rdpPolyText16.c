@@ -70,10 +70,12 @@ rdpPolyText16(DrawablePtr pDrawable, GCPtr pGC,
     RegionRec reg;
     int cd;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPolyText16:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyText16CallCount++;
+    RDP_PROF_BEGIN(dev);
     GetTextBoundingBox(pDrawable, pGC->font, x, y, count, &box);
     rdpRegionInit(&reg, &box, 0);
     rdpRegionInit(&clip_reg, NullBox, 0);
@@ -84,12 +86,15 @@ rdpPolyText16(DrawablePtr pDrawable, GCPtr pGC,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rv = rdpPolyText16Org(pDrawable, pGC, x, y, count, chars);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpPolyText16CallCount);
     return rv;
 }
@@ -72,10 +72,12 @@ rdpPolylines(DrawablePtr pDrawable, GCPtr pGC, int mode,
     int x2;
     int y2;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPolylines:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolylinesCallCount++;
+    RDP_PROF_BEGIN(dev);
     rdpRegionInit(&reg, NullBox, 0);
     for (index = 1; index < npt; index++)
     {
@@ -97,11 +99,14 @@ rdpPolylines(DrawablePtr pDrawable, GCPtr pGC, int mode,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpPolylinesOrg(pDrawable, pGC, mode, npt, pptInit);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDrawable);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpPolylinesCallCount);
 }
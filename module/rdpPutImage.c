@@ -68,10 +68,12 @@ rdpPutImage(DrawablePtr pDst, GCPtr pGC, int depth, int x, int y,
     RegionRec reg;
     int cd;
     BoxRec box;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpPutImage:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPutImageCallCount++;
+    RDP_PROF_BEGIN(dev);
     box.x1 = x + pDst->x;
     box.y1 = y + pDst->y;
     box.x2 = box.x1 + w;
@@ -85,11 +87,14 @@ rdpPutImage(DrawablePtr pDst, GCPtr pGC, int depth, int x, int y,
         rdpRegionIntersect(&reg, &clip_reg, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpPutImageOrg(pDst, pGC, depth, x, y, w, h, leftPad, format, pBits);
+    RDP_PROF_ORG_END(dev);
     if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDst);
     }
     rdpRegionUninit(&clip_reg);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpPutImageCallCount);
 }
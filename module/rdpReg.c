@@ -269,3 +269,133 @@ rdpRegionPixelCount(RegionPtr pReg)
     }
     return rv;
 }
+
+/*****************************************************************************/
+/* set map to rgnOUT, rgnIN or rgnPART for each tile_size square in
+   tiles_rect, in row order, tiles_rect must be a multiple of tile_size
+   this is one pass over the region's rects, cheaper than calling
+   rdpRegionContainsRect for each tile when the region is complex
+   the map is always set, it falls back to rdpRegionContainsRect if
+   there is no memory for the pass */
+int
+rdpRegionTileMap(RegionPtr pReg, BoxPtr tiles_rect, int tile_size,
+                 uint8_t *map)
+{
+    BoxRec box;
+    int *area;
+    int tiles_width;
+    int tiles_height;
+    int num_tiles;
+    int tile_area;
+    int index;
+    int count;
+    int tx;
+    int ty;
+    int tx1;
+    int ty1;
+    int tx2;
+    int ty2;
+    int tile_x;
+    int tile_y;
+    int width;
+    int height;
+
+    tiles_width = (tiles_rect->x2 - tiles_rect->x1) / tile_size;
+    tiles_height = (tiles_rect->y2 - tiles_rect->y1) / tile_size;
+    num_tiles = tiles_width * tiles_height;
+    if (num_tiles < 1)
+    {
+        return 0;
+    }
+    area = (int *) calloc(num_tiles, sizeof(int));
+    if (area == NULL)
+    {
+        for (index = 0; index < num_tiles; index++)
+        {
+            box.x1 = tiles_rect->x1 + (index % tiles_width) * tile_size;
+            box.y1 = tiles_rect->y1 + (index / tiles_width) * tile_size;
+            box.x2 = box.x1 + tile_size;
+            box.y2 = box.y1 + tile_size;
+            map[index] = rdpRegionContainsRect(pReg, &box);
+        }
+        return 0;
+    }
+    /* the region's rects do not overlap so the areas add up */
+    count = REGION_NUM_RECTS(pReg);
+    for (index = 0; index < count; index++)
+    {
+        box = REGION_RECTS(pReg)[index];
+        box.x1 = max(box.x1, tiles_rect->x1);
+        box.y1 = max(box.y1, tiles_rect->y1);
+        box.x2 = min(box.x2, tiles_rect->x2);
+        box.y2 = min(box.y2, tiles_rect->y2);
+        if ((box.x1 >= box.x2) || (box.y1 >= box.y2))
+        {
+            continue;
+        }
+        tx1 = (box.x1 - tiles_rect->x1) / tile_size;
+        ty1 = (box.y1 - tiles_rect->y1) / tile_size;
+        tx2 = (box.x2 - tiles_rect->x1 + tile_size - 1) / tile_size;
+        ty2 = (box.y2 - tiles_rect->y1 + tile_size - 1) / tile_size;
+        for (ty = ty1; ty < ty2; ty++)
+        {
+            tile_y = tiles_rect->y1 + ty * tile_size;
+            height = min(box.y2, tile_y + tile_size) - max(box.y1, tile_y);
+            for (tx = tx1; tx < tx2; tx++)
+            {
+                tile_x = tiles_rect->x1 + tx * tile_size;
+                width = min(box.x2, tile_x + tile_size) - max(box.x1, tile_x);
+                area[ty * tiles_width + tx] += width * height;
+            }
+        }
+    }
+    tile_area = tile_size * tile_size;
+    for (index = 0; index < num_tiles; index++)
+    {
+        if (area[index] == 0)
+        {
+            map[index] = rgnOUT;
+        }
+        else if (area[index] == tile_area)
+        {
+            map[index] = rgnIN;
+        }
+        else
+        {
+            map[index] = rgnPART;
+        }
+    }
+    free(area);
+    return 0;
+}
+
+/*****************************************************************************/
+/* intersect pReg with the union of rects, rects must be sorted by y1 then
+   x1, not overlap and have the same y1 and y2 when on the same row, like
+   a list of tiles, so the region is built without sorting */
+Bool
+rdpRegionIntersectRects(RegionPtr pReg, BoxPtr rects, int num_rects)
+{
+    RegionPtr reg;
+    xRectanglePtr xrects;
+    int index;
+    Bool rv;
+
+    xrects = (xRectanglePtr) malloc(sizeof(xRectangle) * max(num_rects, 1));
+    if (xrects == NULL)
+    {
+        return FALSE;
+    }
+    for (index = 0; index < num_rects; index++)
+    {
+        xrects[index].x = rects[index].x1;
+        xrects[index].y = rects[index].y1;
+        xrects[index].width = rects[index].x2 - rects[index].x1;
+        xrects[index].height = rects[index].y2 - rects[index].y1;
+    }
+    reg = rdpRegionFromRects(num_rects, xrects, CT_YXBANDED);
+    free(xrects);
+    rv = rdpRegionIntersect(pReg, pReg, reg);
+    rdpRegionDestroy(reg);
+    return rv;
+}
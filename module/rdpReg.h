@@ -64,5 +64,10 @@ extern _X_EXPORT void
 rdpRegionUnionRect(RegionPtr pReg, BoxPtr prect);
 extern _X_EXPORT int
 rdpRegionPixelCount(RegionPtr pReg);
+extern _X_EXPORT int
+rdpRegionTileMap(RegionPtr pReg, BoxPtr tiles_rect, int tile_size,
+                 uint8_t *map);
+extern _X_EXPORT Bool
+rdpRegionIntersectRects(RegionPtr pReg, BoxPtr rects, int num_rects);
 
 #endif
@@ -45,6 +45,10 @@ SIMD function assigning
 /* use simd, run time */
 int g_simd_use_accel = 1;
 
+/* highest instruction set level to assign, run time, the kernel tests
+   lower it to get the functions of each level */
+int g_simd_max_level = RDP_SIMD_AVX2;
+
 /* use simd, compile time, if zero, g_simd_use_accel does not matter */
 #if !defined(SIMD_USE_ACCEL)
 #define SIMD_USE_ACCEL 0
@@ -188,6 +192,436 @@ a8r8g8b8_to_yuvalp_box_amd64_sse2_wrap(const uint8_t *s8, int src_stride,
     }
     return 0;
 }
+
+/******************************************************************************/
+/* AVX2 does 16 pixels at a time, the SSE2 wrap does what's left so the
+   output is the same as with SSE2 only */
+static int
+a8r8g8b8_to_nv12_box_amd64_avx2_wrap(const uint8_t *s8, int src_stride,
+                                     uint8_t *d8_y, int dst_stride_y,
+                                     uint8_t *d8_uv, int dst_stride_uv,
+                                     int width, int height)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~15;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_nv12_box_amd64_avx2(s8, src_stride,
+                                                    d8_y, dst_stride_y,
+                                                    d8_uv, dst_stride_uv,
+                                                    aligned_width, height);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_nv12_box_amd64_sse2_wrap(s8 + aligned_width * 4,
+                                                         src_stride,
+                                                         d8_y + aligned_width,
+                                                         dst_stride_y,
+                                                         d8_uv + aligned_width,
+                                                         dst_stride_uv,
+                                                         left_over_width,
+                                                         height);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+static int
+a8r8g8b8_to_nv12_709fr_box_amd64_avx2_wrap(const uint8_t *s8, int src_stride,
+                                           uint8_t *d8_y, int dst_stride_y,
+                                           uint8_t *d8_uv, int dst_stride_uv,
+                                           int width, int height)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~15;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_nv12_709fr_box_amd64_avx2(s8, src_stride,
+                                                          d8_y, dst_stride_y,
+                                                          d8_uv, dst_stride_uv,
+                                                          aligned_width,
+                                                          height);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_nv12_709fr_box_amd64_sse2_wrap(s8 + aligned_width * 4,
+                                                               src_stride,
+                                                               d8_y + aligned_width,
+                                                               dst_stride_y,
+                                                               d8_uv + aligned_width,
+                                                               dst_stride_uv,
+                                                               left_over_width,
+                                                               height);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_yuvalp_box_amd64_avx2_wrap(const uint8_t *s8, int src_stride,
+                                       uint8_t *d8, int dst_stride,
+                                       int width, int height)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~15;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_yuvalp_box_amd64_avx2(s8, src_stride,
+                                                      d8, dst_stride,
+                                                      aligned_width, height);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_yuvalp_box_amd64_sse2_wrap(s8 + aligned_width * 4,
+                                                           src_stride,
+                                                           d8 + aligned_width,
+                                                           dst_stride,
+                                                           left_over_width,
+                                                           height);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* the hash goes along each whole row, the SIMD code can not do part of
+   a row and leave the rest to C, a width it can not do is done in C
+   and the asm loops need at least one pixel */
+static int
+a8r8g8b8_to_yuvalp_hash_box_amd64_sse2_wrap(const uint8_t *s8, int src_stride,
+                                            uint8_t *d8, int dst_stride,
+                                            int width, int height,
+                                            uint64_t *hash)
+{
+    if ((width > 0) && (height > 0) && ((width & 7) == 0))
+    {
+        return a8r8g8b8_to_yuvalp_hash_box_amd64_sse2(s8, src_stride,
+                                                      d8, dst_stride,
+                                                      width, height, hash);
+    }
+    return a8r8g8b8_to_yuvalp_hash_box(s8, src_stride, d8, dst_stride,
+                                       width, height, hash);
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_yuvalp_hash_box_amd64_avx2_wrap(const uint8_t *s8, int src_stride,
+                                            uint8_t *d8, int dst_stride,
+                                            int width, int height,
+                                            uint64_t *hash)
+{
+    if ((width > 0) && (height > 0) && ((width & 15) == 0))
+    {
+        return a8r8g8b8_to_yuvalp_hash_box_amd64_avx2(s8, src_stride,
+                                                      d8, dst_stride,
+                                                      width, height, hash);
+    }
+    return a8r8g8b8_to_yuvalp_hash_box_amd64_sse2_wrap(s8, src_stride,
+                                                       d8, dst_stride,
+                                                       width, height, hash);
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_r5g6b5_box_amd64_sse2_wrap(const uint8_t *s8, int src_stride,
+                                       uint8_t *d8, int dst_stride,
+                                       int width, int height,
+                                       const uint8_t *dither)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~7;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_r5g6b5_box_amd64_sse2(s8, src_stride,
+                                                      d8, dst_stride,
+                                                      aligned_width, height,
+                                                      dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_r5g6b5_box(s8 + aligned_width * 4,
+                                           src_stride,
+                                           d8 + aligned_width * 2,
+                                           dst_stride,
+                                           left_over_width, height,
+                                           dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_r5g6b5_box_amd64_avx2_wrap(const uint8_t *s8, int src_stride,
+                                       uint8_t *d8, int dst_stride,
+                                       int width, int height,
+                                       const uint8_t *dither)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~15;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_r5g6b5_box_amd64_avx2(s8, src_stride,
+                                                      d8, dst_stride,
+                                                      aligned_width, height,
+                                                      dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_r5g6b5_box_amd64_sse2_wrap(s8 + aligned_width * 4,
+                                                           src_stride,
+                                                           d8 + aligned_width * 2,
+                                                           dst_stride,
+                                                           left_over_width, height,
+                                                           dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_a1r5g5b5_box_amd64_sse2_wrap(const uint8_t *s8, int src_stride,
+                                         uint8_t *d8, int dst_stride,
+                                         int width, int height,
+                                         const uint8_t *dither)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~7;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_a1r5g5b5_box_amd64_sse2(s8, src_stride,
+                                                        d8, dst_stride,
+                                                        aligned_width, height,
+                                                        dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_a1r5g5b5_box(s8 + aligned_width * 4,
+                                             src_stride,
+                                             d8 + aligned_width * 2,
+                                             dst_stride,
+                                             left_over_width, height,
+                                             dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_a1r5g5b5_box_amd64_avx2_wrap(const uint8_t *s8, int src_stride,
+                                         uint8_t *d8, int dst_stride,
+                                         int width, int height,
+                                         const uint8_t *dither)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~15;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_a1r5g5b5_box_amd64_avx2(s8, src_stride,
+                                                        d8, dst_stride,
+                                                        aligned_width, height,
+                                                        dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_a1r5g5b5_box_amd64_sse2_wrap(s8 + aligned_width * 4,
+                                                             src_stride,
+                                                             d8 + aligned_width * 2,
+                                                             dst_stride,
+                                                             left_over_width, height,
+                                                             dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_r3g3b2_box_amd64_sse2_wrap(const uint8_t *s8, int src_stride,
+                                       uint8_t *d8, int dst_stride,
+                                       int width, int height,
+                                       const uint8_t *dither)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~15;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_r3g3b2_box_amd64_sse2(s8, src_stride,
+                                                      d8, dst_stride,
+                                                      aligned_width, height,
+                                                      dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_r3g3b2_box(s8 + aligned_width * 4,
+                                           src_stride,
+                                           d8 + aligned_width,
+                                           dst_stride,
+                                           left_over_width, height,
+                                           dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_r3g3b2_box_amd64_avx2_wrap(const uint8_t *s8, int src_stride,
+                                       uint8_t *d8, int dst_stride,
+                                       int width, int height,
+                                       const uint8_t *dither)
+{
+    int aligned_width;
+    int left_over_width;
+    int error;
+
+    aligned_width = width & ~31;
+    left_over_width = width - aligned_width;
+    if (height > 0)
+    {
+        if (aligned_width > 0)
+        {
+            error = a8r8g8b8_to_r3g3b2_box_amd64_avx2(s8, src_stride,
+                                                      d8, dst_stride,
+                                                      aligned_width, height,
+                                                      dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+        if (left_over_width > 0)
+        {
+            error = a8r8g8b8_to_r3g3b2_box_amd64_sse2_wrap(s8 + aligned_width * 4,
+                                                           src_stride,
+                                                           d8 + aligned_width,
+                                                           dst_stride,
+                                                           left_over_width, height,
+                                                           dither);
+            if (error != 0)
+            {
+                return error;
+            }
+        }
+    }
+    return 0;
+}
 #endif
 
 #if defined(__x86__) || defined(_M_IX86) || defined(__i386__)
@@ -334,6 +768,11 @@ rdpSimdInit(ScreenPtr pScreen, ScrnInfoPtr pScrn)
     dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box;
     dev->a8r8g8b8_to_nv12_709fr_box = a8r8g8b8_to_nv12_709fr_box;
     dev->a8r8g8b8_to_yuvalp_box = a8r8g8b8_to_yuvalp_box;
+    dev->a8r8g8b8_to_yuvalp_hash_box = a8r8g8b8_to_yuvalp_hash_box;
+    dev->a8r8g8b8_solid_box = a8r8g8b8_solid_box;
+    dev->a8r8g8b8_to_r5g6b5_box = a8r8g8b8_to_r5g6b5_box;
+    dev->a8r8g8b8_to_a1r5g5b5_box = a8r8g8b8_to_a1r5g5b5_box;
+    dev->a8r8g8b8_to_r3g3b2_box = a8r8g8b8_to_r3g3b2_box;
 #if SIMD_USE_ACCEL
     if (g_simd_use_accel)
     {
@@ -342,7 +781,8 @@ rdpSimdInit(ScreenPtr pScreen, ScrnInfoPtr pScrn)
         cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
         LLOGLN(0, ("rdpSimdInit: cpuid ax 1 cx 0 return ax 0x%8.8x bx "
                "0x%8.8x cx 0x%8.8x dx 0x%8.8x", ax, bx, cx, dx));
-        if (dx & (1 << 26)) /* SSE 2 */
+        if ((dx & (1 << 26)) && /* SSE 2 */
+            (g_simd_max_level >= RDP_SIMD_SSE2))
         {
             dev->yv12_to_rgb32 = yv12_to_rgb32_amd64_sse2;
             dev->i420_to_rgb32 = i420_to_rgb32_amd64_sse2;
@@ -352,14 +792,53 @@ rdpSimdInit(ScreenPtr pScreen, ScrnInfoPtr pScrn)
             dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box_amd64_sse2_wrap;
             dev->a8r8g8b8_to_nv12_709fr_box = a8r8g8b8_to_nv12_709fr_box_amd64_sse2_wrap;
             dev->a8r8g8b8_to_yuvalp_box = a8r8g8b8_to_yuvalp_box_amd64_sse2_wrap;
+            dev->a8r8g8b8_to_yuvalp_hash_box = a8r8g8b8_to_yuvalp_hash_box_amd64_sse2_wrap;
+            dev->a8r8g8b8_solid_box = a8r8g8b8_solid_box_amd64_sse2;
+            dev->a8r8g8b8_to_r5g6b5_box = a8r8g8b8_to_r5g6b5_box_amd64_sse2_wrap;
+            dev->a8r8g8b8_to_a1r5g5b5_box = a8r8g8b8_to_a1r5g5b5_box_amd64_sse2_wrap;
+            dev->a8r8g8b8_to_r3g3b2_box = a8r8g8b8_to_r3g3b2_box_amd64_sse2_wrap;
             LLOGLN(0, ("rdpSimdInit: sse2 amd64 yuv functions assigned"));
         }
+        /* AVX2 needs the OS to save the ymm registers, check OSXSAVE and
+           AVX in leaf 1, then XCR0 for SSE and AVX state, then leaf 7 */
+        if ((cx & (1 << 27)) && (cx & (1 << 28)) && /* OSXSAVE and AVX */
+            (g_simd_max_level >= RDP_SIMD_AVX2))
+        {
+            xgetbv_amd64(0, &ax, &dx);
+            LLOGLN(0, ("rdpSimdInit: xgetbv cx 0 return ax 0x%8.8x "
+                   "dx 0x%8.8x", ax, dx));
+            if ((ax & 6) == 6) /* XMM and YMM state */
+            {
+                cpuid_amd64(0, 0, &ax, &bx, &cx, &dx);
+                if (ax >= 7)
+                {
+                    cpuid_amd64(7, 0, &ax, &bx, &cx, &dx);
+                    LLOGLN(0, ("rdpSimdInit: cpuid ax 7 cx 0 return ax "
+                           "0x%8.8x bx 0x%8.8x cx 0x%8.8x dx 0x%8.8x",
+                           ax, bx, cx, dx));
+                    if (bx & (1 << 5)) /* AVX 2 */
+                    {
+                        dev->a8r8g8b8_to_a8b8g8r8_box = a8r8g8b8_to_a8b8g8r8_box_amd64_avx2;
+                        dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box_amd64_avx2_wrap;
+                        dev->a8r8g8b8_to_nv12_709fr_box = a8r8g8b8_to_nv12_709fr_box_amd64_avx2_wrap;
+                        dev->a8r8g8b8_to_yuvalp_box = a8r8g8b8_to_yuvalp_box_amd64_avx2_wrap;
+                        dev->a8r8g8b8_to_yuvalp_hash_box = a8r8g8b8_to_yuvalp_hash_box_amd64_avx2_wrap;
+                        dev->a8r8g8b8_solid_box = a8r8g8b8_solid_box_amd64_avx2;
+                        dev->a8r8g8b8_to_r5g6b5_box = a8r8g8b8_to_r5g6b5_box_amd64_avx2_wrap;
+                        dev->a8r8g8b8_to_a1r5g5b5_box = a8r8g8b8_to_a1r5g5b5_box_amd64_avx2_wrap;
+                        dev->a8r8g8b8_to_r3g3b2_box = a8r8g8b8_to_r3g3b2_box_amd64_avx2_wrap;
+                        LLOGLN(0, ("rdpSimdInit: avx2 amd64 yuv functions assigned"));
+                    }
+                }
+            }
+        }
 #elif defined(__x86__) || defined(_M_IX86) || defined(__i386__)
         int ax, bx, cx, dx;
         cpuid_x86(1, 0, &ax, &bx, &cx, &dx);
         LLOGLN(0, ("rdpSimdInit: cpuid ax 1 cx 0 return ax 0x%8.8x bx "
                "0x%8.8x cx 0x%8.8x dx 0x%8.8x", ax, bx, cx, dx));
-        if (dx & (1 << 26)) /* SSE 2 */
+        if ((dx & (1 << 26)) && /* SSE 2 */
+            (g_simd_max_level >= RDP_SIMD_SSE2))
         {
             dev->yv12_to_rgb32 = yv12_to_rgb32_x86_sse2;
             dev->i420_to_rgb32 = i420_to_rgb32_x86_sse2;
@@ -28,6 +28,11 @@ SIMD function assigning
 #include <xorgVersion.h>
 #include <xf86.h>
 
+/* instruction set levels for g_simd_max_level */
+#define RDP_SIMD_C 0
+#define RDP_SIMD_SSE2 1
+#define RDP_SIMD_AVX2 2
+
 extern _X_EXPORT Bool
 rdpSimdInit(ScreenPtr pScreen, ScrnInfoPtr pScrn);
 
@@ -0,0 +1,266 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+tile cache, content hash to client cache slot
+mirrors what xrdp was told to put in the client's cache, a fixed number
+of slots, the least recently used one is given to a new tile when full
+only used on the X main thread
+
+*/
+
+#if defined(HAVE_CONFIG_H)
+#include "config_ac.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpMisc.h"
+#include "rdpTileCache.h"
+
+#define LOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LOG_LEVEL) { ErrorF _args ; ErrorF("\n"); } } while (0)
+
+struct rdp_tile_cache_entry
+{
+    uint64_t key;
+    int chain; /* next entry in the same bucket or -1 */
+    int prev; /* toward most recently used or -1 */
+    int next; /* toward least recently used or -1 */
+    unsigned int frame; /* frame it was added in */
+};
+
+struct rdp_tile_cache
+{
+    int num_slots;
+    int num_used; /* entries 0 to num_used - 1 hold a tile */
+    int bucket_mask;
+    int *buckets; /* first entry or -1 */
+    int lru_head; /* most recently used */
+    int lru_tail; /* least recently used, the next to go */
+    unsigned int frame;
+    struct rdp_tile_cache_entry *entries; /* entry n is client slot n + 1 */
+};
+
+/******************************************************************************/
+struct rdp_tile_cache *
+rdpTileCacheCreate(int num_slots)
+{
+    struct rdp_tile_cache *cache;
+    int num_buckets;
+
+    if (num_slots < 1)
+    {
+        return NULL;
+    }
+    /* at least 2 buckets per slot, keeps the chains short */
+    num_buckets = 1;
+    while (num_buckets < num_slots * 2)
+    {
+        num_buckets <<= 1;
+    }
+    cache = g_new0(struct rdp_tile_cache, 1);
+    cache->num_slots = num_slots;
+    cache->bucket_mask = num_buckets - 1;
+    cache->buckets = g_new(int, num_buckets);
+    cache->entries = g_new0(struct rdp_tile_cache_entry, num_slots);
+    rdpTileCacheReset(cache);
+    LLOGLN(0, ("rdpTileCacheCreate: num_slots %d num_buckets %d",
+           num_slots, num_buckets));
+    return cache;
+}
+
+/******************************************************************************/
+void
+rdpTileCacheDestroy(struct rdp_tile_cache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+    free(cache->buckets);
+    free(cache->entries);
+    free(cache);
+}
+
+/******************************************************************************/
+/* forget every tile, the client slots are overwritten as they are used
+   again */
+void
+rdpTileCacheReset(struct rdp_tile_cache *cache)
+{
+    int index;
+
+    for (index = 0; index <= cache->bucket_mask; index++)
+    {
+        cache->buckets[index] = -1;
+    }
+    cache->num_used = 0;
+    cache->lru_head = -1;
+    cache->lru_tail = -1;
+}
+
+/******************************************************************************/
+/* tiles added from here on are not in the client's cache until the
+   frame is drawn */
+void
+rdpTileCacheNewFrame(struct rdp_tile_cache *cache)
+{
+    cache->frame++;
+}
+
+/******************************************************************************/
+static void
+rdpTileCacheUnlink(struct rdp_tile_cache *cache, int index)
+{
+    struct rdp_tile_cache_entry *entry;
+
+    entry = cache->entries + index;
+    if (entry->prev >= 0)
+    {
+        cache->entries[entry->prev].next = entry->next;
+    }
+    else
+    {
+        cache->lru_head = entry->next;
+    }
+    if (entry->next >= 0)
+    {
+        cache->entries[entry->next].prev = entry->prev;
+    }
+    else
+    {
+        cache->lru_tail = entry->prev;
+    }
+}
+
+/******************************************************************************/
+static void
+rdpTileCacheLinkHead(struct rdp_tile_cache *cache, int index)
+{
+    struct rdp_tile_cache_entry *entry;
+
+    entry = cache->entries + index;
+    entry->prev = -1;
+    entry->next = cache->lru_head;
+    if (cache->lru_head >= 0)
+    {
+        cache->entries[cache->lru_head].prev = index;
+    }
+    else
+    {
+        cache->lru_tail = index;
+    }
+    cache->lru_head = index;
+}
+
+/******************************************************************************/
+/* take the entry out of its bucket */
+static void
+rdpTileCacheRemoveKey(struct rdp_tile_cache *cache, int index)
+{
+    int *link;
+
+    link = cache->buckets + (cache->entries[index].key & cache->bucket_mask);
+    while (*link >= 0)
+    {
+        if (*link == index)
+        {
+            *link = cache->entries[index].chain;
+            return;
+        }
+        link = &(cache->entries[*link].chain);
+    }
+}
+
+/******************************************************************************/
+/* returns the client slot holding the tile and marks it used, 0 if the
+   tile is not cached, -1 if it was only added in this frame and the
+   client does not have it yet */
+int
+rdpTileCacheFind(struct rdp_tile_cache *cache, uint64_t key)
+{
+    struct rdp_tile_cache_entry *entry;
+    int index;
+
+    index = cache->buckets[key & cache->bucket_mask];
+    while (index >= 0)
+    {
+        entry = cache->entries + index;
+        if (entry->key == key)
+        {
+            if (entry->frame == cache->frame)
+            {
+                return -1;
+            }
+            if (cache->lru_head != index)
+            {
+                rdpTileCacheUnlink(cache, index);
+                rdpTileCacheLinkHead(cache, index);
+            }
+            return index + 1;
+        }
+        index = entry->chain;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* returns the client slot the tile goes in, the least recently used tile
+   is dropped if the cache is full
+   the key must not be in the cache */
+int
+rdpTileCacheAdd(struct rdp_tile_cache *cache, uint64_t key)
+{
+    struct rdp_tile_cache_entry *entry;
+    int index;
+    int bucket;
+
+    if (cache->num_used < cache->num_slots)
+    {
+        index = cache->num_used;
+        cache->num_used++;
+    }
+    else
+    {
+        index = cache->lru_tail;
+        LLOGLN(10, ("rdpTileCacheAdd: evict slot %d", index + 1));
+        rdpTileCacheRemoveKey(cache, index);
+        rdpTileCacheUnlink(cache, index);
+    }
+    entry = cache->entries + index;
+    bucket = key & cache->bucket_mask;
+    entry->key = key;
+    entry->frame = cache->frame;
+    entry->chain = cache->buckets[bucket];
+    cache->buckets[bucket] = index;
+    rdpTileCacheLinkHead(cache, index);
+    return index + 1;
+}
@@ -0,0 +1,80 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+tile cache, content hash to client cache slot
+
+*/
+
+#ifndef __RDPTILECACHE_H
+#define __RDPTILECACHE_H
+
+#include <xorg-server.h>
+#include <xorgVersion.h>
+#include <xf86.h>
+
+/* default client cache slots, 64x64 tiles at 4 bytes a pixel, 16 MB is
+   what a client with a small cache has */
+#define RDP_TILE_CACHE_SLOTS 1024
+
+/* most copies from and to the cache in one capture, a 4K screen is 2040
+   tiles */
+#define RDP_TILE_CACHE_FRAME_OPS 4096
+
+/* a tile the client has, copied from its cache slot to x, y */
+struct rdp_tile_cache_hit
+{
+    int slot;
+    short x;
+    short y;
+};
+
+/* a tile sent in this frame, copied to a cache slot after it is drawn */
+struct rdp_tile_cache_store
+{
+    int slot;
+    uint64_t key;
+    BoxRec rect;
+};
+
+/* what a frame does with the client cache, filled in by the capture and
+   sent with the frame */
+struct rdp_tile_cache_ops
+{
+    int num_hits;
+    int num_stores;
+    struct rdp_tile_cache_hit hits[RDP_TILE_CACHE_FRAME_OPS];
+    struct rdp_tile_cache_store stores[RDP_TILE_CACHE_FRAME_OPS];
+};
+
+struct rdp_tile_cache;
+
+extern _X_EXPORT struct rdp_tile_cache *
+rdpTileCacheCreate(int num_slots);
+extern _X_EXPORT void
+rdpTileCacheDestroy(struct rdp_tile_cache *cache);
+extern _X_EXPORT void
+rdpTileCacheReset(struct rdp_tile_cache *cache);
+extern _X_EXPORT void
+rdpTileCacheNewFrame(struct rdp_tile_cache *cache);
+extern _X_EXPORT int
+rdpTileCacheFind(struct rdp_tile_cache *cache, uint64_t key);
+extern _X_EXPORT int
+rdpTileCacheAdd(struct rdp_tile_cache *cache, uint64_t key);
+
+#endif
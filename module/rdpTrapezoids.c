@@ -72,11 +72,13 @@ rdpTrapezoids(CARD8 op, PicturePtr pSrc, PicturePtr pDst,
     PictureScreenPtr ps;
     BoxRec box;
     RegionRec reg;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpTrapezoids:"));
     pScreen = pDst->pDrawable->pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpTrapezoidsCallCount++;
+    RDP_PROF_BEGIN(dev);
     miTrapezoidBounds(ntrap, traps, &box);
     box.x1 += pDst->pDrawable->x;
     box.y1 += pDst->pDrawable->y;
@@ -89,8 +91,11 @@ rdpTrapezoids(CARD8 op, PicturePtr pSrc, PicturePtr pDst,
     }
     ps = GetPictureScreen(pScreen);
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpTrapezoidsOrg(ps, dev, op, pSrc, pDst, maskFormat, xSrc, ySrc,
                      ntrap, traps);
+    RDP_PROF_ORG_END(dev);
     rdpClientConAddAllReg(dev, &reg, pDst->pDrawable);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpTrapezoidsCallCount);
 }
@@ -72,11 +72,13 @@ rdpTriangles(CARD8 op, PicturePtr pSrc, PicturePtr pDst,
     PictureScreenPtr ps;
     BoxRec box;
     RegionRec reg;
+    RDP_PROF_VARS;
 
     LLOGLN(10, ("rdpTriangles:"));
     pScreen = pDst->pDrawable->pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpTrianglesCallCount++;
+    RDP_PROF_BEGIN(dev);
     miTriangleBounds(ntris, tris, &box);
     box.x1 += pDst->pDrawable->x;
     box.y1 += pDst->pDrawable->y;
@@ -89,8 +91,11 @@ rdpTriangles(CARD8 op, PicturePtr pSrc, PicturePtr pDst,
         rdpRegionIntersect(&reg, pDst->pCompositeClip, &reg);
     }
     /* do original call */
+    RDP_PROF_ORG_BEGIN(dev);
     rdpTrianglesOrg(ps, dev, op, pSrc, pDst, maskFormat, xSrc, ySrc,
                     ntris, tris);
+    RDP_PROF_ORG_END(dev);
     rdpClientConAddAllReg(dev, &reg, pDst->pDrawable);
     rdpRegionUninit(&reg);
+    RDP_PROF_END(dev, rdpTrianglesCallCount);
 }
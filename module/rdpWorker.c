@@ -0,0 +1,239 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+worker thread pool
+the X main thread hands out a batch of independent jobs, takes part in
+running them and returns when all are done, the workers never call into
+the X server
+
+*/
+
+#if defined(HAVE_CONFIG_H)
+#include "config_ac.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpMisc.h"
+#include "rdpWorker.h"
+
+#define LOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LOG_LEVEL) { ErrorF _args ; ErrorF("\n"); } } while (0)
+
+struct rdp_workers
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    pthread_t threads[RDP_MAX_WORKERS];
+    int num_threads; /* not counting the X main thread */
+    int shutdown;
+    /* current batch, protected by mutex */
+    unsigned int generation;
+    int num_busy;
+    rdp_worker_proc proc;
+    void *data;
+    int num_jobs;
+    /* next job index, atomic */
+    int next_job;
+};
+
+/******************************************************************************/
+static void
+rdpWorkersDoJobs(struct rdp_workers *workers, rdp_worker_proc proc,
+                 void *data, int num_jobs)
+{
+    int index;
+
+    for (;;)
+    {
+        index = __sync_fetch_and_add(&(workers->next_job), 1);
+        if (index >= num_jobs)
+        {
+            break;
+        }
+        proc(data, index);
+    }
+}
+
+/******************************************************************************/
+static void *
+rdpWorkersThreadProc(void *arg)
+{
+    struct rdp_workers *workers;
+    unsigned int generation;
+    rdp_worker_proc proc;
+    void *data;
+    int num_jobs;
+
+    workers = (struct rdp_workers *) arg;
+    /* a batch may already be posted before this thread gets to run */
+    generation = 0;
+    pthread_mutex_lock(&(workers->mutex));
+    for (;;)
+    {
+        while (!workers->shutdown && workers->generation == generation)
+        {
+            pthread_cond_wait(&(workers->start_cond), &(workers->mutex));
+        }
+        if (workers->shutdown)
+        {
+            break;
+        }
+        generation = workers->generation;
+        proc = workers->proc;
+        data = workers->data;
+        num_jobs = workers->num_jobs;
+        pthread_mutex_unlock(&(workers->mutex));
+        rdpWorkersDoJobs(workers, proc, data, num_jobs);
+        pthread_mutex_lock(&(workers->mutex));
+        workers->num_busy--;
+        if (workers->num_busy == 0)
+        {
+            pthread_cond_signal(&(workers->done_cond));
+        }
+    }
+    pthread_mutex_unlock(&(workers->mutex));
+    return NULL;
+}
+
+/******************************************************************************/
+/* num_threads is the total including the X main thread, 1 or less means
+   everything runs on the X main thread */
+struct rdp_workers *
+rdpWorkersCreate(int num_threads)
+{
+    struct rdp_workers *workers;
+    sigset_t set;
+    sigset_t old_set;
+    int index;
+
+    workers = g_new0(struct rdp_workers, 1);
+    pthread_mutex_init(&(workers->mutex), NULL);
+    pthread_cond_init(&(workers->start_cond), NULL);
+    pthread_cond_init(&(workers->done_cond), NULL);
+    num_threads = RDPCLAMP(num_threads, 1, RDP_MAX_WORKERS) - 1;
+    /* the X server's signal handlers must only run on the main thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, &old_set);
+    for (index = 0; index < num_threads; index++)
+    {
+        if (pthread_create(workers->threads + index, NULL,
+                           rdpWorkersThreadProc, workers) != 0)
+        {
+            LLOGLN(0, ("rdpWorkersCreate: pthread_create failed, "
+                   "using %d worker threads", index));
+            break;
+        }
+        workers->num_threads++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    LLOGLN(0, ("rdpWorkersCreate: %d worker threads", workers->num_threads));
+    return workers;
+}
+
+/******************************************************************************/
+void
+rdpWorkersDestroy(struct rdp_workers *workers)
+{
+    int index;
+
+    if (workers == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&(workers->mutex));
+    workers->shutdown = 1;
+    pthread_cond_broadcast(&(workers->start_cond));
+    pthread_mutex_unlock(&(workers->mutex));
+    for (index = 0; index < workers->num_threads; index++)
+    {
+        pthread_join(workers->threads[index], NULL);
+    }
+    pthread_cond_destroy(&(workers->done_cond));
+    pthread_cond_destroy(&(workers->start_cond));
+    pthread_mutex_destroy(&(workers->mutex));
+    free(workers);
+}
+
+/******************************************************************************/
+/* total threads available to rdpWorkersRun, including the caller */
+int
+rdpWorkersGetCount(struct rdp_workers *workers)
+{
+    if (workers == NULL)
+    {
+        return 1;
+    }
+    return workers->num_threads + 1;
+}
+
+/******************************************************************************/
+/* call proc(data, index) for index 0 to num_jobs - 1, blocks until all
+   jobs are done, the caller runs jobs too */
+int
+rdpWorkersRun(struct rdp_workers *workers, rdp_worker_proc proc,
+              void *data, int num_jobs)
+{
+    int index;
+
+    if (num_jobs < 1)
+    {
+        return 0;
+    }
+    if ((workers == NULL) || (workers->num_threads < 1) || (num_jobs < 2))
+    {
+        for (index = 0; index < num_jobs; index++)
+        {
+            proc(data, index);
+        }
+        return 0;
+    }
+    pthread_mutex_lock(&(workers->mutex));
+    workers->proc = proc;
+    workers->data = data;
+    workers->num_jobs = num_jobs;
+    workers->next_job = 0;
+    workers->num_busy = workers->num_threads;
+    workers->generation++;
+    pthread_cond_broadcast(&(workers->start_cond));
+    pthread_mutex_unlock(&(workers->mutex));
+    rdpWorkersDoJobs(workers, proc, data, num_jobs);
+    pthread_mutex_lock(&(workers->mutex));
+    while (workers->num_busy > 0)
+    {
+        pthread_cond_wait(&(workers->done_cond), &(workers->mutex));
+    }
+    pthread_mutex_unlock(&(workers->mutex));
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+worker thread pool
+
+*/
+
+#ifndef __RDPWORKER_H
+#define __RDPWORKER_H
+
+#include <xorg-server.h>
+#include <xorgVersion.h>
+#include <xf86.h>
+
+/* maximum number of threads, including the X main thread */
+#define RDP_MAX_WORKERS 32
+
+/* called once for each job index, from any thread, in any order
+ * must not call into the X server */
+typedef void (*rdp_worker_proc)(void *data, int index);
+
+struct rdp_workers;
+
+extern _X_EXPORT struct rdp_workers *
+rdpWorkersCreate(int num_threads);
+extern _X_EXPORT void
+rdpWorkersDestroy(struct rdp_workers *workers);
+extern _X_EXPORT int
+rdpWorkersGetCount(struct rdp_workers *workers);
+extern _X_EXPORT int
+rdpWorkersRun(struct rdp_workers *workers, rdp_worker_proc proc,
+              void *data, int num_jobs);
+
+#endif
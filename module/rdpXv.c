@@ -167,196 +167,6 @@ xrdpVidQueryBestSize(ScrnInfoPtr pScrn, Bool motion,
     LLOGLN(0, ("xrdpVidQueryBestSize:"));
 }
 
-/*****************************************************************************/
-int
-YV12_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
-{
-    int size_total;
-    int y;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    size_total = width * height;
-    for (j = 0; j < height; j++)
-    {
-        for (i = 0; i < width; i++)
-        {
-            y = yuvs[j * width + i];
-            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
-            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
-            c = y - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-        }
-    }
-    return 0;
-}
-
-/*****************************************************************************/
-int
-I420_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
-{
-    int size_total;
-    int y;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    size_total = width * height;
-    for (j = 0; j < height; j++)
-    {
-        for (i = 0; i < width; i++)
-        {
-            y = yuvs[j * width + i];
-            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
-            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
-            c = y - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-        }
-    }
-    return 0;
-}
-
-/*****************************************************************************/
-int
-YUY2_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
-{
-    int y1;
-    int y2;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    for (j = 0; j < height; j++)
-    {
-        for (i = 0; i < width; i++)
-        {
-            y1 = *(yuvs++);
-            v = *(yuvs++);
-            y2 = *(yuvs++);
-            u = *(yuvs++);
-
-            c = y1 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-
-            i++;
-            c = y2 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-        }
-    }
-    return 0;
-}
-
-/*****************************************************************************/
-int
-UYVY_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
-{
-    int y1;
-    int y2;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    for (j = 0; j < height; j++)
-    {
-        for (i = 0; i < width; i++)
-        {
-            v = *(yuvs++);
-            y1 = *(yuvs++);
-            u = *(yuvs++);
-            y2 = *(yuvs++);
-
-            c = y1 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-
-            i++;
-            c = y2 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-        }
-    }
-    return 0;
-}
-
 #if 0
 /*****************************************************************************/
 static int
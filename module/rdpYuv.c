@@ -0,0 +1,233 @@
+/*
+Copyright 2014-2017 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+YUV to RGB32 for XVideo
+the C versions of the yuv_to_rgb32_proc functions rdpSimdInit assigns,
+kept apart from rdpXv.c so they build without the Xv headers
+
+*/
+
+#if defined(HAVE_CONFIG_H)
+#include "config_ac.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpXv.h"
+
+/*****************************************************************************/
+int
+YV12_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
+{
+    int size_total;
+    int y;
+    int u;
+    int v;
+    int c;
+    int d;
+    int e;
+    int r;
+    int g;
+    int b;
+    int t;
+    int i;
+    int j;
+
+    size_total = width * height;
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            y = yuvs[j * width + i];
+            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
+            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
+            c = y - 16;
+            d = u - 128;
+            e = v - 128;
+            t = (298 * c + 409 * e + 128) >> 8;
+            b = RDPCLAMP(t, 0, 255);
+            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
+            g = RDPCLAMP(t, 0, 255);
+            t = (298 * c + 516 * d + 128) >> 8;
+            r = RDPCLAMP(t, 0, 255);
+            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+int
+I420_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
+{
+    int size_total;
+    int y;
+    int u;
+    int v;
+    int c;
+    int d;
+    int e;
+    int r;
+    int g;
+    int b;
+    int t;
+    int i;
+    int j;
+
+    size_total = width * height;
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            y = yuvs[j * width + i];
+            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
+            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
+            c = y - 16;
+            d = u - 128;
+            e = v - 128;
+            t = (298 * c + 409 * e + 128) >> 8;
+            b = RDPCLAMP(t, 0, 255);
+            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
+            g = RDPCLAMP(t, 0, 255);
+            t = (298 * c + 516 * d + 128) >> 8;
+            r = RDPCLAMP(t, 0, 255);
+            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+int
+YUY2_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
+{
+    int y1;
+    int y2;
+    int u;
+    int v;
+    int c;
+    int d;
+    int e;
+    int r;
+    int g;
+    int b;
+    int t;
+    int i;
+    int j;
+
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            y1 = *(yuvs++);
+            v = *(yuvs++);
+            y2 = *(yuvs++);
+            u = *(yuvs++);
+
+            c = y1 - 16;
+            d = u - 128;
+            e = v - 128;
+            t = (298 * c + 409 * e + 128) >> 8;
+            b = RDPCLAMP(t, 0, 255);
+            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
+            g = RDPCLAMP(t, 0, 255);
+            t = (298 * c + 516 * d + 128) >> 8;
+            r = RDPCLAMP(t, 0, 255);
+            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+
+            i++;
+            c = y2 - 16;
+            d = u - 128;
+            e = v - 128;
+            t = (298 * c + 409 * e + 128) >> 8;
+            b = RDPCLAMP(t, 0, 255);
+            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
+            g = RDPCLAMP(t, 0, 255);
+            t = (298 * c + 516 * d + 128) >> 8;
+            r = RDPCLAMP(t, 0, 255);
+            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+int
+UYVY_to_RGB32(const uint8_t *yuvs, int width, int height, int *rgbs)
+{
+    int y1;
+    int y2;
+    int u;
+    int v;
+    int c;
+    int d;
+    int e;
+    int r;
+    int g;
+    int b;
+    int t;
+    int i;
+    int j;
+
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            v = *(yuvs++);
+            y1 = *(yuvs++);
+            u = *(yuvs++);
+            y2 = *(yuvs++);
+
+            c = y1 - 16;
+            d = u - 128;
+            e = v - 128;
+            t = (298 * c + 409 * e + 128) >> 8;
+            b = RDPCLAMP(t, 0, 255);
+            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
+            g = RDPCLAMP(t, 0, 255);
+            t = (298 * c + 516 * d + 128) >> 8;
+            r = RDPCLAMP(t, 0, 255);
+            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+
+            i++;
+            c = y2 - 16;
+            d = u - 128;
+            e = v - 128;
+            t = (298 * c + 409 * e + 128) >> 8;
+            b = RDPCLAMP(t, 0, 255);
+            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
+            g = RDPCLAMP(t, 0, 255);
+            t = (298 * c + 516 * d + 128) >> 8;
+            r = RDPCLAMP(t, 0, 255);
+            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+        }
+    }
+    return 0;
+}
@@ -18,14 +18,14 @@
 ;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 ;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 ;
-;ARGB to ABGR
+;ARGB to ABGR, alpha is 0 like the C version
 ;x86 SSE2 32 bit
 ;
 
 %include "common.asm"
 
 PREPARE_RODATA
-c1 times 4 dd 0xFF00FF00
+c1 times 4 dd 0x0000FF00
 c2 times 4 dd 0x00FF0000
 c3 times 4 dd 0x000000FF
 
@@ -63,8 +63,8 @@ loop_xpre:
     jl done_loop_x       ; all done with this row
     mov eax, [esi]
     lea esi, [esi + 4]
-    mov edx, eax         ; a and g
-    and edx, 0xFF00FF00
+    mov edx, eax         ; g
+    and edx, 0x0000FF00
     mov ebp, eax         ; r
     and ebp, 0x00FF0000
     shr ebp, 16
@@ -82,7 +82,7 @@ done_loop_xpre:
     prefetchnta [esi]
 
 ; A R G B A R G B A R G B A R G B to
-; A B G R A B G R A B G R A B G R
+; 0 B G R 0 B G R 0 B G R 0 B G R
 
 loop_x8:
     cmp ecx, 8
@@ -92,7 +92,7 @@ loop_x8:
 
     movdqa xmm0, [esi]
     lea esi, [esi + 16]
-    movdqa xmm3, xmm0    ; a and g
+    movdqa xmm3, xmm0    ; g
     pand xmm3, xmm4
     movdqa xmm1, xmm0    ; r
     pand xmm1, xmm5
@@ -108,7 +108,7 @@ loop_x8:
 
     movdqa xmm0, [esi]
     lea esi, [esi + 16]
-    movdqa xmm3, xmm0    ; a and g
+    movdqa xmm3, xmm0    ; g
     pand xmm3, xmm4
     movdqa xmm1, xmm0    ; r
     pand xmm1, xmm5
@@ -130,8 +130,8 @@ loop_x:
     jl done_loop_x
     mov eax, [esi]
     lea esi, [esi + 4]
-    mov edx, eax         ; a and g
-    and edx, 0xFF00FF00
+    mov edx, eax         ; g
+    and edx, 0x0000FF00
     mov ebp, eax         ; r
     and ebp, 0x00FF0000
     shr ebp, 16
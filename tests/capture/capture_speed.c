@@ -0,0 +1,735 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+capture speed testing
+drives rdpCapture for each capture code with a synthetic framebuffer and
+damage, no X server needed
+
+*/
+
+#if defined(HAVE_CONFIG_H)
+#include "config_ac.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <xorg-server.h>
+
+#include "rdp.h"
+#include "rdpClientCon.h"
+#include "rdpReg.h"
+#include "rdpMisc.h"
+#include "rdpCapture.h"
+#include "rdpSimd.h"
+#include "rdpWorker.h"
+#include "rdpTileCache.h"
+
+extern int g_simd_use_accel; /* in rdpSimd.c */
+
+/* scattered small rects per frame, more than MAX_CAPTURE_RECTS */
+#define NUM_SCATTER_RECTS 48
+/* lines the scroll pattern moves per frame */
+#define SCROLL_LINES 16
+
+struct cap_mode
+{
+    const char *name;
+    enum xrdp_capture_code capture_code;
+    int rdp_format;
+};
+
+static const struct cap_mode g_modes[] =
+{
+    { "simple", CC_SIMPLE, XRDP_a8r8g8b8 },
+    { "suf_a16", CC_SUF_A16, XRDP_a8b8g8r8 },
+    { "gfx_pro", CC_GFX_PRO, XRDP_a8r8g8b8 },
+    { "suf_rfx", CC_SUF_RFX, XRDP_a8r8g8b8 },
+    { "suf_a2", CC_SUF_A2, XRDP_nv12 },
+    { "gfx_a2", CC_GFX_A2, XRDP_nv12_709fr }
+};
+#define NUM_MODES ((int) (sizeof(g_modes) / sizeof(g_modes[0])))
+
+enum cap_pattern
+{
+    PAT_FULL = 0,   /* every pixel changes every frame */
+    PAT_SCATTER,    /* small rects change, like typing or a clock */
+    PAT_SCROLL,     /* the screen moves up, new lines at the bottom */
+    PAT_STATIC,     /* all damaged, nothing changes */
+    PAT_REVISIT,    /* two screens in turn, like switching tabs */
+    PAT_FLAT,       /* a window on a background of one colour, all change */
+    NUM_PATTERNS
+};
+
+static const char *g_pattern_names[NUM_PATTERNS] =
+{
+    "full", "scatter", "scroll", "static", "revisit", "flat"
+};
+
+struct cap_test
+{
+    int width;
+    int height;
+    int frames;
+    uint8_t *fb;
+    uint8_t *shmem;
+    uint8_t *ref; /* what the whole frame converts to, see check_output */
+    uint32_t seed;
+    int tile_cache_slots;
+    int scroll_detect;
+    int solid_fill;
+    struct rdp_workers *workers;
+    rdpPtr dev;
+};
+
+struct cap_result
+{
+    double seconds;
+    uint64_t damage_bytes;
+    uint64_t out_bytes;
+    uint64_t tiles_hashed;
+    uint64_t tiles_skipped;
+    uint64_t tiles_cached;
+    uint64_t tiles_solid;
+    uint64_t scrolls_detected;
+    int64_t *frame_us;
+    int failed;
+};
+
+/******************************************************************************/
+static uint32_t
+lcg_rand(uint32_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+/******************************************************************************/
+/* fill a box with noise, some flat runs so it is not all worst case */
+static void
+fill_box(struct cap_test *test, const BoxRec *box)
+{
+    uint32_t *d32;
+    uint32_t pixel;
+    int x;
+    int y;
+
+    pixel = 0;
+    for (y = box->y1; y < box->y2; y++)
+    {
+        d32 = (uint32_t *) (test->fb + y * test->width * 4);
+        for (x = box->x1; x < box->x2; x++)
+        {
+            if ((x & 7) == 0)
+            {
+                pixel = lcg_rand(&(test->seed)) | 0xFF000000;
+            }
+            d32[x] = pixel;
+        }
+    }
+}
+
+/******************************************************************************/
+/* fill a box with one colour */
+static void
+fill_solid(struct cap_test *test, const BoxRec *box, uint32_t pixel)
+{
+    uint32_t *d32;
+    int x;
+    int y;
+
+    for (y = box->y1; y < box->y2; y++)
+    {
+        d32 = (uint32_t *) (test->fb + y * test->width * 4);
+        for (x = box->x1; x < box->x2; x++)
+        {
+            d32[x] = pixel;
+        }
+    }
+}
+
+/******************************************************************************/
+/* the window in PAT_FLAT, not on the tile or block grid */
+static void
+flat_window(struct cap_test *test, BoxPtr box)
+{
+    box->x1 = test->width / 4 + 3;
+    box->y1 = test->height / 4 + 3;
+    box->x2 = test->width / 2 + 3;
+    box->y2 = test->height / 2 + 3;
+}
+
+/******************************************************************************/
+/* change the framebuffer for this frame and return the damage */
+static int
+make_frame(struct cap_test *test, enum cap_pattern pattern, int frame,
+           BoxPtr boxes)
+{
+    BoxRec box;
+    int index;
+    int num_boxes;
+    int stride;
+
+    stride = test->width * 4;
+    box.x1 = 0;
+    box.y1 = 0;
+    box.x2 = test->width;
+    box.y2 = test->height;
+    switch (pattern)
+    {
+        case PAT_FULL:
+            fill_box(test, &box);
+            boxes[0] = box;
+            return 1;
+        case PAT_SCATTER:
+            num_boxes = 0;
+            for (index = 0; index < NUM_SCATTER_RECTS; index++)
+            {
+                box.x1 = lcg_rand(&(test->seed)) % (test->width - 64);
+                box.y1 = lcg_rand(&(test->seed)) % (test->height - 32);
+                box.x2 = box.x1 + 8 + lcg_rand(&(test->seed)) % 56;
+                box.y2 = box.y1 + 8 + lcg_rand(&(test->seed)) % 24;
+                fill_box(test, &box);
+                boxes[num_boxes++] = box;
+            }
+            return num_boxes;
+        case PAT_SCROLL:
+            if (frame == 0)
+            {
+                fill_box(test, &box);
+            }
+            else
+            {
+                memmove(test->fb, test->fb + SCROLL_LINES * stride,
+                        (test->height - SCROLL_LINES) * stride);
+                box.y1 = test->height - SCROLL_LINES;
+                fill_box(test, &box);
+                box.y1 = 0;
+            }
+            boxes[0] = box;
+            return 1;
+        case PAT_STATIC:
+            if (frame == 0)
+            {
+                fill_box(test, &box);
+            }
+            boxes[0] = box;
+            return 1;
+        case PAT_REVISIT:
+            test->seed = 1 + (frame & 1);
+            fill_box(test, &box);
+            boxes[0] = box;
+            return 1;
+        case PAT_FLAT:
+            fill_solid(test, &box, 0xFF000000 | (frame * 0x00010305));
+            boxes[0] = box;
+            flat_window(test, &box);
+            fill_box(test, &box);
+            return 1;
+        default:
+            break;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+static rdpClientCon *
+create_client_con(struct cap_test *test, const struct cap_mode *mode)
+{
+    rdpClientCon *clientCon;
+
+    clientCon = g_new0(rdpClientCon, 1);
+    clientCon->dev = test->dev;
+    clientCon->client_info.capture_code = mode->capture_code;
+    clientCon->rdp_format = mode->rdp_format;
+    clientCon->shmemstatus = SHM_ACTIVE;
+    clientCon->cap_left = 0;
+    clientCon->cap_top = 0;
+    clientCon->cap_width = test->width;
+    clientCon->cap_height = test->height;
+    if ((mode->rdp_format == XRDP_nv12) ||
+        (mode->rdp_format == XRDP_nv12_709fr))
+    {
+        clientCon->cap_stride_bytes = test->width;
+    }
+    else
+    {
+        clientCon->cap_stride_bytes = test->width * 4;
+    }
+    /* suf_rfx gets a cache too, it has no cache commands and must not
+       use it */
+    if (((mode->capture_code == CC_GFX_PRO) ||
+         (mode->capture_code == CC_SUF_RFX)) && (test->tile_cache_slots > 0))
+    {
+        clientCon->tile_cache = rdpTileCacheCreate(test->tile_cache_slots);
+        clientCon->tile_cache_ops = g_new0(struct rdp_tile_cache_ops, 1);
+    }
+    clientCon->screen_copy = test->scroll_detect;
+    clientCon->solid_fill = test->solid_fill;
+    return clientCon;
+}
+
+/******************************************************************************/
+static void
+delete_client_con(rdpClientCon *clientCon)
+{
+    int index;
+
+    for (index = 0; index < 16; index++)
+    {
+        free(clientCon->rfx_crcs[index]);
+        free(clientCon->row_hashes[index]);
+    }
+    rdpTileCacheDestroy(clientCon->tile_cache);
+    free(clientCon->tile_cache_ops);
+    free(clientCon->frame_fills);
+    free(clientCon);
+}
+
+/******************************************************************************/
+/* the block captures convert only what changed, and one row of the
+   blocks of one colour, when every block changes the output must be the
+   whole frame converted, returns the first byte that is not or -1 */
+static int
+check_output(struct cap_test *test, const struct cap_mode *mode)
+{
+    rdpPtr dev;
+    uint8_t *ref_uv;
+    int bytes;
+    int index;
+
+    dev = test->dev;
+    ref_uv = test->ref + test->width * test->height;
+    switch (mode->capture_code)
+    {
+        case CC_SUF_A16:
+            dev->a8r8g8b8_to_a8b8g8r8_box(test->fb, test->width * 4,
+                                          test->ref, test->width * 4,
+                                          test->width, test->height);
+            bytes = test->width * test->height * 4;
+            break;
+        case CC_SUF_A2:
+            dev->a8r8g8b8_to_nv12_box(test->fb, test->width * 4,
+                                      test->ref, test->width,
+                                      ref_uv, test->width,
+                                      test->width, test->height);
+            bytes = test->width * test->height * 3 / 2;
+            break;
+        case CC_GFX_A2:
+            dev->a8r8g8b8_to_nv12_709fr_box(test->fb, test->width * 4,
+                                            test->ref, test->width,
+                                            ref_uv, test->width,
+                                            test->width, test->height);
+            bytes = test->width * test->height * 3 / 2;
+            break;
+        default:
+            return -1;
+    }
+    for (index = 0; index < bytes; index++)
+    {
+        if (test->ref[index] != test->shmem[index])
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/******************************************************************************/
+static int
+run_test(struct cap_test *test, const struct cap_mode *mode,
+         enum cap_pattern pattern, struct cap_result *result)
+{
+    rdpClientCon *clientCon;
+    struct image_data id;
+    RegionRec reg;
+    RegionRec box_reg;
+    BoxRec boxes[NUM_SCATTER_RECTS];
+    BoxRec extents;
+    BoxPtr out_rects;
+    int num_boxes;
+    int num_out_rects;
+    int frame;
+    int index;
+    int num_tiles;
+    int num_full_tiles;
+    int num_scroll_tiles;
+    int num_flat_tiles;
+    int bad_byte;
+    uint64_t tiles_hashed;
+    uint64_t tiles_skipped;
+    int64_t start;
+    int64_t end;
+
+    memset(&id, 0, sizeof(id));
+    id.width = test->width;
+    id.height = test->height;
+    id.bpp = 32;
+    id.Bpp = 4;
+    id.lineBytes = test->width * 4;
+    id.pixels = test->fb;
+    id.shmem_pixels = test->shmem;
+    id.shmem_id = -1;
+    test->seed = 1;
+    num_tiles = ((test->width + 63) / 64) * ((test->height + 63) / 64);
+    num_full_tiles = (test->width / 64) * (test->height / 64);
+    /* the new lines and the tile row above them if not aligned */
+    num_scroll_tiles = ((test->width + 63) / 64) *
+                       (2 + (SCROLL_LINES - 1) / 64);
+    /* the window and the partial tiles at the edges */
+    flat_window(test, &extents);
+    num_flat_tiles = ((extents.x2 + 63) / 64 - extents.x1 / 64) *
+                     ((extents.y2 + 63) / 64 - extents.y1 / 64) +
+                     num_tiles - num_full_tiles;
+    clientCon = create_client_con(test, mode);
+    for (frame = 0; frame < test->frames; frame++)
+    {
+        num_boxes = make_frame(test, pattern, frame, boxes);
+        rdpRegionInit(&reg, NullBox, 0);
+        for (index = 0; index < num_boxes; index++)
+        {
+            rdpRegionInit(&box_reg, boxes + index, 0);
+            rdpRegionUnion(&reg, &reg, &box_reg);
+            rdpRegionUninit(&box_reg);
+        }
+        /* like rdpCapRect */
+        if (REGION_NUM_RECTS(&reg) > MAX_CAPTURE_RECTS)
+        {
+            extents = *rdpRegionExtents(&reg);
+            rdpRegionUninit(&reg);
+            rdpRegionInit(&reg, &extents, 0);
+        }
+        result->damage_bytes += 4 * (uint64_t) rdpRegionPixelCount(&reg);
+        out_rects = NULL;
+        num_out_rects = 0;
+        clientCon->num_frame_copies = 0;
+        clientCon->num_frame_fills = 0;
+        tiles_hashed = clientCon->tiles_hashed;
+        tiles_skipped = clientCon->tiles_skipped;
+        start = g_time_usec();
+        if (!rdpCapture(clientCon, &reg, &out_rects, &num_out_rects, &id))
+        {
+            printf("%s %s: rdpCapture failed at frame %d\n", mode->name,
+                   g_pattern_names[pattern], frame);
+            result->failed = 1;
+        }
+        end = g_time_usec();
+        result->frame_us[frame] = end - start;
+        result->seconds += (end - start) / 1000000.0;
+        for (index = 0; index < num_out_rects; index++)
+        {
+            result->out_bytes += 4 *
+                    (out_rects[index].x2 - out_rects[index].x1) *
+                    (out_rects[index].y2 - out_rects[index].y1);
+        }
+        /* the 16 bit surface takes whole 16x16 blocks inside the screen */
+        if (mode->capture_code == CC_SUF_A16)
+        {
+            for (index = 0; index < num_out_rects; index++)
+            {
+                if ((((out_rects[index].x2 - out_rects[index].x1) & 15) != 0) ||
+                    (((out_rects[index].y2 - out_rects[index].y1) & 15) != 0) ||
+                    (out_rects[index].x1 < 0) || (out_rects[index].y1 < 0) ||
+                    (out_rects[index].x2 > test->width) ||
+                    (out_rects[index].y2 > test->height))
+                {
+                    printf("%s %s: rect %d %d %d %d not 16x16 blocks in "
+                           "frame %d\n", mode->name, g_pattern_names[pattern],
+                           out_rects[index].x1, out_rects[index].y1,
+                           out_rects[index].x2, out_rects[index].y2, frame);
+                    result->failed = 1;
+                    break;
+                }
+            }
+        }
+        /* surface command frames have no copies, fills or cache commands,
+           every damaged tile that changed must be sent */
+        if ((mode->capture_code == CC_SUF_RFX) &&
+            ((clientCon->tiles_hashed - tiles_hashed -
+              (clientCon->tiles_skipped - tiles_skipped) !=
+              (uint64_t) num_out_rects) ||
+             (clientCon->num_frame_copies != 0) ||
+             (clientCon->num_frame_fills != 0)))
+        {
+            printf("%s %s: %d of %d changed tiles sent, %d copies %d fills "
+                   "in frame %d\n", mode->name, g_pattern_names[pattern],
+                   num_out_rects,
+                   (int) (clientCon->tiles_hashed - tiles_hashed -
+                          (clientCon->tiles_skipped - tiles_skipped)),
+                   clientCon->num_frame_copies, clientCon->num_frame_fills,
+                   frame);
+            result->failed = 1;
+        }
+        /* nothing changed, the block and tile hashes should catch it */
+        if ((pattern == PAT_STATIC) && (frame > 0) && (num_out_rects > 0) &&
+            (mode->capture_code != CC_SIMPLE))
+        {
+            printf("%s %s: %d rects sent for unchanged frame %d\n",
+                   mode->name, g_pattern_names[pattern], num_out_rects,
+                   frame);
+            result->failed = 1;
+        }
+        /* both screens fit in the tile cache, the client has all but
+           the partial tiles at the edges */
+        if ((pattern == PAT_REVISIT) && (frame > 1) &&
+            (mode->capture_code == CC_GFX_PRO) &&
+            (clientCon->tile_cache != NULL) &&
+            (num_tiles * 2 <= test->tile_cache_slots) &&
+            (num_out_rects > num_tiles - num_full_tiles))
+        {
+            printf("%s %s: %d rects sent for cached frame %d\n",
+                   mode->name, g_pattern_names[pattern], num_out_rects,
+                   frame);
+            result->failed = 1;
+        }
+        /* the lines that moved are copied on the client */
+        if ((pattern == PAT_SCROLL) && (frame > 0) &&
+            (mode->capture_code == CC_GFX_PRO) && test->scroll_detect &&
+            ((clientCon->num_frame_copies != 1) ||
+             (num_out_rects > num_scroll_tiles)))
+        {
+            printf("%s %s: %d copies %d rects sent for scrolled frame %d\n",
+                   mode->name, g_pattern_names[pattern],
+                   clientCon->num_frame_copies, num_out_rects, frame);
+            result->failed = 1;
+        }
+        /* the background is filled on the client */
+        if ((pattern == PAT_FLAT) && (mode->capture_code == CC_GFX_PRO) &&
+            test->solid_fill &&
+            ((clientCon->num_frame_fills < 1) ||
+             (num_out_rects > num_flat_tiles)))
+        {
+            printf("%s %s: %d fills %d rects sent for flat frame %d\n",
+                   mode->name, g_pattern_names[pattern],
+                   clientCon->num_frame_fills, num_out_rects, frame);
+            result->failed = 1;
+        }
+        if (pattern == PAT_FLAT)
+        {
+            bad_byte = check_output(test, mode);
+            if (bad_byte >= 0)
+            {
+                printf("%s %s: output byte %d wrong in flat frame %d\n",
+                       mode->name, g_pattern_names[pattern], bad_byte,
+                       frame);
+                result->failed = 1;
+            }
+        }
+        free(out_rects);
+        rdpRegionUninit(&reg);
+    }
+    result->tiles_hashed = clientCon->tiles_hashed;
+    result->tiles_skipped = clientCon->tiles_skipped;
+    result->tiles_cached = clientCon->tiles_cached;
+    result->tiles_solid = clientCon->tiles_solid;
+    result->scrolls_detected = clientCon->scrolls_detected;
+    delete_client_con(clientCon);
+    return result->failed;
+}
+
+/******************************************************************************/
+static int
+cmp_int64(const void *a, const void *b)
+{
+    int64_t val1;
+    int64_t val2;
+
+    val1 = *((const int64_t *) a);
+    val2 = *((const int64_t *) b);
+    return (val1 > val2) - (val1 < val2);
+}
+
+/******************************************************************************/
+static void
+print_result(struct cap_test *test, const struct cap_mode *mode,
+             enum cap_pattern pattern, struct cap_result *result)
+{
+    double seconds;
+
+    seconds = result->seconds > 0 ? result->seconds : 1e-9;
+    qsort(result->frame_us, test->frames, sizeof(int64_t), cmp_int64);
+    printf("%-8s %-8s %9.1f %9.1f %10.0f %6.1f %6.1f %6.1f %7d %8.0f %7d "
+           "%7d %7d\n",
+           mode->name, g_pattern_names[pattern],
+           result->damage_bytes / seconds / (1024 * 1024),
+           result->out_bytes / seconds / (1024 * 1024),
+           result->tiles_hashed / seconds,
+           result->tiles_hashed > 0 ?
+           100.0 * result->tiles_skipped / result->tiles_hashed : 0.0,
+           result->tiles_hashed > 0 ?
+           100.0 * result->tiles_cached / result->tiles_hashed : 0.0,
+           result->tiles_hashed > 0 ?
+           100.0 * result->tiles_solid / result->tiles_hashed : 0.0,
+           (int) result->scrolls_detected,
+           result->seconds * 1000000.0 / test->frames,
+           (int) result->frame_us[test->frames / 2],
+           (int) result->frame_us[(test->frames * 99) / 100],
+           (int) result->frame_us[test->frames - 1]);
+}
+
+/******************************************************************************/
+static int
+usage(void)
+{
+    printf("capture_speed [options]\n");
+    printf("  -w <width>     framebuffer width, default 1920\n");
+    printf("  -h <height>    framebuffer height, default 1080\n");
+    printf("  -n <frames>    frames per test, default 100\n");
+    printf("  -t <threads>   capture threads, default 1\n");
+    printf("  -m <mode>      only this capture mode, simple suf_a16 "
+           "gfx_pro suf_rfx suf_a2 gfx_a2\n");
+    printf("  -c             use the C functions, not SIMD\n");
+    printf("  -k <slots>     gfx_pro tile cache slots, default %d, "
+           "0 disables\n", RDP_TILE_CACHE_SLOTS);
+    printf("  -s             no gfx_pro scroll detection\n");
+    printf("  -f             no solid fills\n");
+    return 1;
+}
+
+/******************************************************************************/
+int
+main(int argc, char **argv)
+{
+    struct cap_test test;
+    struct cap_result result;
+    ScrnInfoRec scrn;
+    const char *mode_name;
+    size_t shmem_bytes;
+    int threads;
+    int opt;
+    int mode;
+    int pattern;
+    int rv;
+
+    memset(&test, 0, sizeof(test));
+    test.width = 1920;
+    test.height = 1080;
+    test.frames = 100;
+    test.tile_cache_slots = RDP_TILE_CACHE_SLOTS;
+    test.scroll_detect = 1;
+    test.solid_fill = 1;
+    threads = 1;
+    mode_name = NULL;
+    while ((opt = getopt(argc, argv, "w:h:n:t:m:ck:sf")) != -1)
+    {
+        switch (opt)
+        {
+            case 'w':
+                test.width = atoi(optarg);
+                break;
+            case 'h':
+                test.height = atoi(optarg);
+                break;
+            case 'n':
+                test.frames = atoi(optarg);
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'm':
+                mode_name = optarg;
+                break;
+            case 'c':
+                g_simd_use_accel = 0;
+                break;
+            case 'k':
+                test.tile_cache_slots = atoi(optarg);
+                break;
+            case 's':
+                test.scroll_detect = 0;
+                break;
+            case 'f':
+                test.solid_fill = 0;
+                break;
+            default:
+                return usage();
+        }
+    }
+    if ((test.width < 128) || (test.height < 128) || (test.frames < 1) ||
+        (test.width > 8192) || (test.height > 8192))
+    {
+        return usage();
+    }
+
+    /* the h264 modes round the damage out to even */
+    test.width &= ~1;
+    test.height &= ~1;
+
+    test.dev = g_new0(rdpRec, 1);
+    memset(&scrn, 0, sizeof(scrn));
+    scrn.driverPrivate = test.dev;
+    rdpSimdInit(NULL, &scrn);
+    test.workers = rdpWorkersCreate(threads);
+    test.dev->capture_workers = test.workers;
+    test.dev->screen_copy = test.scroll_detect;
+    test.dev->scroll_detect = test.scroll_detect;
+    test.dev->solid_fill = test.solid_fill;
+
+    /* room for the biggest output, gfx pro pads to 64x64 tiles */
+    test.fb = g_new0(uint8_t, test.width * test.height * 4);
+    shmem_bytes = ((test.width + 63) & ~63) * ((test.height + 63) & ~63) * 4;
+    test.shmem = g_new0(uint8_t, shmem_bytes);
+    test.ref = g_new0(uint8_t, shmem_bytes);
+    result.frame_us = g_new0(int64_t, test.frames);
+
+#if defined(SIMD_USE_ACCEL)
+    printf("%dx%d %d frames %d threads %s\n", test.width, test.height,
+           test.frames, rdpWorkersGetCount(test.workers),
+           g_simd_use_accel ? "simd" : "c");
+#else
+    printf("%dx%d %d frames %d threads c\n", test.width, test.height,
+           test.frames, rdpWorkersGetCount(test.workers));
+#endif
+    printf("%-8s %-8s %9s %9s %10s %6s %6s %6s %7s %8s %7s %7s %7s\n",
+           "mode", "damage", "in MB/s", "out MB/s", "tiles/s", "skip%",
+           "cache%", "solid%", "scrolls", "avg us", "p50 us", "p99 us", "max us");
+    rv = 0;
+    for (mode = 0; mode < NUM_MODES; mode++)
+    {
+        if ((mode_name != NULL) && (strcmp(mode_name, g_modes[mode].name) != 0))
+        {
+            continue;
+        }
+        for (pattern = 0; pattern < NUM_PATTERNS; pattern++)
+        {
+            memset(result.frame_us, 0, sizeof(int64_t) * test.frames);
+            result.seconds = 0;
+            result.damage_bytes = 0;
+            result.out_bytes = 0;
+            result.tiles_hashed = 0;
+            result.tiles_skipped = 0;
+            result.tiles_cached = 0;
+            result.tiles_solid = 0;
+            result.scrolls_detected = 0;
+            result.failed = 0;
+            rv |= run_test(&test, g_modes + mode, pattern, &result);
+            print_result(&test, g_modes + mode, pattern, &result);
+        }
+    }
+
+    free(result.frame_us);
+    free(test.ref);
+    free(test.shmem);
+    free(test.fb);
+    rdpWorkersDestroy(test.workers);
+    free(test.dev);
+    return rv;
+}
@@ -0,0 +1,7 @@
+#! /bin/sh
+
+# quick run of every capture mode, fails if a capture fails or an
+# unchanged frame is not skipped, run capture_speed by hand for numbers
+./capture_speed -w 640 -h 480 -n 8 -t 2 || exit 1
+# a screen that is not a multiple of 16, the edge blocks are moved in
+./capture_speed -w 650 -h 490 -n 8 -t 2
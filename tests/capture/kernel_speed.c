@@ -0,0 +1,704 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+kernel equivalence and speed testing
+every conversion function in the rdpRec dispatch table, at each
+instruction set level rdpSimdInit can assign, is checked against the C
+version over odd sizes and unaligned strides then timed with the caches
+hot and cold
+
+*/
+
+#if defined(HAVE_CONFIG_H)
+#include "config_ac.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <xorg-server.h>
+
+#include "rdp.h"
+#include "rdpMisc.h"
+#include "rdpSimd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+/* the time stamp counter, reference cycles, not core cycles when the
+   clock is boosted */
+#define TICKS_NAME "cyc/px"
+static uint64_t
+get_ticks(void)
+{
+    return __rdtsc();
+}
+#else
+#define TICKS_NAME "ns/px"
+static uint64_t
+get_ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+extern int g_simd_max_level; /* in rdpSimd.c */
+
+#define NUM_LEVELS (RDP_SIMD_AVX2 + 1)
+static const char *g_level_names[NUM_LEVELS] = { "c", "sse2", "avx2" };
+
+enum kernel_type
+{
+    KT_YUV,     /* yuv_to_rgb32_proc */
+    KT_COPY,    /* copy_box_proc */
+    KT_YUVALP,  /* copy_box_proc into a 64x64 tile */
+    KT_HASH,    /* copy_box_hash_proc into a 64x64 tile */
+    KT_DST2,    /* copy_box_dst2_proc */
+    KT_DITHER,  /* copy_box_dither_proc */
+    KT_SOLID    /* solid_box_proc, the result and pixel go in dst */
+};
+
+struct kernel
+{
+    const char *name;
+    enum kernel_type type;
+    size_t offset; /* of the proc in rdpRec */
+    int exact; /* must match the C version */
+    int dst_bpp; /* bytes per destination pixel, not KT_YUV, KT_DST2 or
+                    KT_SOLID */
+    int dither_bits[3]; /* r, g, b bits dropped, KT_DITHER only */
+};
+
+/* the SIMD yuv to rgb32 functions use full range BT.601, the C ones
+   video range, they are compared but not expected to match */
+static const struct kernel g_kernels[] =
+{
+    { "yv12_to_rgb32", KT_YUV,
+      offsetof(rdpRec, yv12_to_rgb32), 0, 4, { 0, 0, 0 } },
+    { "i420_to_rgb32", KT_YUV,
+      offsetof(rdpRec, i420_to_rgb32), 0, 4, { 0, 0, 0 } },
+    { "yuy2_to_rgb32", KT_YUV,
+      offsetof(rdpRec, yuy2_to_rgb32), 0, 4, { 0, 0, 0 } },
+    { "uyvy_to_rgb32", KT_YUV,
+      offsetof(rdpRec, uyvy_to_rgb32), 0, 4, { 0, 0, 0 } },
+    { "a8r8g8b8_to_a8b8g8r8_box", KT_COPY,
+      offsetof(rdpRec, a8r8g8b8_to_a8b8g8r8_box), 1, 4, { 0, 0, 0 } },
+    { "a8r8g8b8_to_nv12_box", KT_DST2,
+      offsetof(rdpRec, a8r8g8b8_to_nv12_box), 1, 1, { 0, 0, 0 } },
+    { "a8r8g8b8_to_nv12_709fr_box", KT_DST2,
+      offsetof(rdpRec, a8r8g8b8_to_nv12_709fr_box), 1, 1, { 0, 0, 0 } },
+    { "a8r8g8b8_to_yuvalp_box", KT_YUVALP,
+      offsetof(rdpRec, a8r8g8b8_to_yuvalp_box), 1, 1, { 0, 0, 0 } },
+    { "a8r8g8b8_to_yuvalp_hash_box", KT_HASH,
+      offsetof(rdpRec, a8r8g8b8_to_yuvalp_hash_box), 1, 1, { 0, 0, 0 } },
+    { "a8r8g8b8_to_r5g6b5_box", KT_DITHER,
+      offsetof(rdpRec, a8r8g8b8_to_r5g6b5_box), 1, 2, { 3, 2, 3 } },
+    { "a8r8g8b8_to_a1r5g5b5_box", KT_DITHER,
+      offsetof(rdpRec, a8r8g8b8_to_a1r5g5b5_box), 1, 2, { 3, 3, 3 } },
+    { "a8r8g8b8_to_r3g3b2_box", KT_DITHER,
+      offsetof(rdpRec, a8r8g8b8_to_r3g3b2_box), 1, 1, { 5, 5, 6 } },
+    { "a8r8g8b8_solid_box", KT_SOLID,
+      offsetof(rdpRec, a8r8g8b8_solid_box), 1, 0, { 0, 0, 0 } }
+};
+#define NUM_KERNELS ((int) (sizeof(g_kernels) / sizeof(g_kernels[0])))
+
+/* sizes for the equivalence checks, the SIMD code does 4, 8 or 16
+   pixels at a time and the C code does the rest */
+static const int g_widths[] =
+{
+    1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65,
+    100, 127, 128, 129
+};
+#define NUM_WIDTHS ((int) (sizeof(g_widths) / sizeof(g_widths[0])))
+static const int g_heights[] = { 1, 2, 3, 4, 7, 17, 63, 64 };
+#define NUM_HEIGHTS ((int) (sizeof(g_heights) / sizeof(g_heights[0])))
+/* start of the box past a 16 byte boundary, in bytes */
+static const int g_offsets[] = { 0, 4, 12 };
+#define NUM_OFFSETS ((int) (sizeof(g_offsets) / sizeof(g_offsets[0])))
+/* extra bytes at the end of each line */
+static const int g_pads[] = { 0, 4, 52 };
+#define NUM_PADS ((int) (sizeof(g_pads) / sizeof(g_pads[0])))
+
+/* box size for the timing */
+#define SPEED_WIDTH 512
+#define SPEED_HEIGHT 256
+
+/* biggest buffer any of the checks or timings need */
+#define BUF_BYTES (4 * 1024 * 1024)
+
+struct kernel_args
+{
+    const uint8_t *src;
+    int src_stride;
+    uint8_t *dst;
+    int dst_stride;
+    uint8_t *dst_uv;
+    int dst_uv_stride;
+    int width;
+    int height;
+    const uint8_t *dither;
+    uint64_t hash[4];
+};
+
+struct kernel_test
+{
+    rdpRec devs[NUM_LEVELS];
+    uint8_t *src;
+    uint8_t *solid; /* KT_SOLID source, written by setup_args */
+    uint8_t *ref_dst;
+    uint8_t *dst;
+    uint8_t *evict;
+    int evict_bytes;
+    uint8_t dither[4 * 32];
+    uint32_t seed;
+    int quick;
+};
+
+/******************************************************************************/
+static uint32_t
+lcg_rand(uint32_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+/******************************************************************************/
+/* noise with runs of black and white so the clamping is hit */
+static void
+fill_src(struct kernel_test *test)
+{
+    uint32_t *s32;
+    uint32_t pixel;
+    int index;
+
+    s32 = (uint32_t *) (test->src);
+    for (index = 0; index < BUF_BYTES / 4; index++)
+    {
+        pixel = lcg_rand(&(test->seed));
+        pixel ^= lcg_rand(&(test->seed)) << 8;
+        switch ((index >> 5) & 7)
+        {
+            case 0:
+                pixel = 0;
+                break;
+            case 1:
+                pixel = 0xFFFFFFFF;
+                break;
+            case 2:
+                pixel |= 0xF0F0F0F0;
+                break;
+        }
+        s32[index] = pixel;
+    }
+}
+
+/******************************************************************************/
+/* like rdpGetDither */
+static void
+make_dither(struct kernel_test *test, const struct kernel *kernel,
+            int x, int y)
+{
+    static const uint8_t bayer4[4][4] =
+    {
+        {  0,  8,  2, 10 },
+        { 12,  4, 14,  6 },
+        {  3, 11,  1,  9 },
+        { 15,  7, 13,  5 }
+    };
+    uint8_t *d8;
+    int bayer;
+    int index;
+    int jndex;
+
+    d8 = test->dither;
+    for (index = 0; index < 4; index++)
+    {
+        for (jndex = 0; jndex < 8; jndex++)
+        {
+            bayer = bayer4[(y + index) & 3][(x + jndex) & 3];
+            d8[0] = (bayer << kernel->dither_bits[2]) >> 4;
+            d8[1] = (bayer << kernel->dither_bits[1]) >> 4;
+            d8[2] = (bayer << kernel->dither_bits[0]) >> 4;
+            d8[3] = 0;
+            d8 += 4;
+        }
+    }
+}
+
+/******************************************************************************/
+static void *
+get_proc(rdpPtr dev, const struct kernel *kernel)
+{
+    void *proc;
+
+    memcpy(&proc, ((char *) dev) + kernel->offset, sizeof(proc));
+    return proc;
+}
+
+/******************************************************************************/
+static int
+run_kernel(rdpPtr dev, const struct kernel *kernel, struct kernel_args *args)
+{
+    yuv_to_rgb32_proc yuv_proc;
+    copy_box_proc copy_proc;
+    copy_box_hash_proc hash_proc;
+    copy_box_dst2_proc dst2_proc;
+    copy_box_dither_proc dither_proc;
+    solid_box_proc solid_proc;
+    uint32_t pixel;
+    int rv;
+
+    switch (kernel->type)
+    {
+        case KT_YUV:
+            memcpy(&yuv_proc, ((char *) dev) + kernel->offset,
+                   sizeof(yuv_proc));
+            return yuv_proc(args->src, args->width, args->height,
+                            (int *) (args->dst));
+        case KT_COPY:
+        case KT_YUVALP:
+            memcpy(&copy_proc, ((char *) dev) + kernel->offset,
+                   sizeof(copy_proc));
+            return copy_proc(args->src, args->src_stride,
+                             args->dst, args->dst_stride,
+                             args->width, args->height);
+        case KT_HASH:
+            memcpy(&hash_proc, ((char *) dev) + kernel->offset,
+                   sizeof(hash_proc));
+            return hash_proc(args->src, args->src_stride,
+                             args->dst, args->dst_stride,
+                             args->width, args->height, args->hash);
+        case KT_DST2:
+            memcpy(&dst2_proc, ((char *) dev) + kernel->offset,
+                   sizeof(dst2_proc));
+            return dst2_proc(args->src, args->src_stride,
+                             args->dst, args->dst_stride,
+                             args->dst_uv, args->dst_uv_stride,
+                             args->width, args->height);
+        case KT_DITHER:
+            memcpy(&dither_proc, ((char *) dev) + kernel->offset,
+                   sizeof(dither_proc));
+            return dither_proc(args->src, args->src_stride,
+                               args->dst, args->dst_stride,
+                               args->width, args->height, args->dither);
+        case KT_SOLID:
+            memcpy(&solid_proc, ((char *) dev) + kernel->offset,
+                   sizeof(solid_proc));
+            rv = solid_proc(args->src, args->src_stride,
+                            args->width, args->height, &pixel);
+            memcpy(args->dst, &rv, sizeof(rv));
+            memcpy(args->dst + sizeof(rv), &pixel, sizeof(pixel));
+            return rv;
+    }
+    return 1;
+}
+
+/******************************************************************************/
+/* set up args for a box, dst is the buffer, returns the bytes of dst
+   used or 0 if the kernel can not do this size */
+static int
+setup_args(struct kernel_test *test, const struct kernel *kernel,
+           uint8_t *dst, int width, int height, int offset, int pad,
+           struct kernel_args *args)
+{
+    uint32_t *s32;
+    int stride;
+    int index;
+
+    memset(args, 0, sizeof(*args));
+    args->width = width;
+    args->height = height;
+    args->dither = test->dither;
+    args->hash[0] = 0x243f6a8885a308d3ull;
+    args->hash[1] = 0x13198a2e03707344ull;
+    args->hash[2] = 0xa4093822299f31d0ull;
+    args->hash[3] = 0x082efa98ec4e6c89ull;
+    switch (kernel->type)
+    {
+        case KT_YUV:
+            /* the SIMD code does 8 pixels and 2 lines at a time and the
+               rgb32 must be 16 byte aligned, the Xv sizes are even */
+            if (((width & 7) != 0) || ((height & 1) != 0) ||
+                (offset != 0) || (pad != 0))
+            {
+                return 0;
+            }
+            args->src = test->src;
+            args->dst = dst;
+            return width * height * 4;
+        case KT_YUVALP:
+        case KT_HASH:
+            /* one 64x64 tile, planes of 64 * 64 bytes */
+            if ((width > 64) || (height > 64) || (pad != 0))
+            {
+                return 0;
+            }
+            args->src = test->src + offset;
+            args->src_stride = 64 * 4 + 16;
+            /* the box can start anywhere in the tile row */
+            args->dst = dst + RDPMIN(offset, 64 - width);
+            args->dst_stride = 64;
+            return 64 * 64 * 4;
+        case KT_DST2:
+            /* the capture code makes nv12 boxes even */
+            if (((width & 1) != 0) || ((height & 1) != 0))
+            {
+                return 0;
+            }
+            args->src = test->src + offset;
+            args->src_stride = width * 4 + pad;
+            args->dst_stride = width + pad;
+            args->dst = dst + offset;
+            args->dst_uv = dst + offset + args->dst_stride * height + 64;
+            args->dst_uv_stride = args->dst_stride;
+            return offset + args->dst_stride * height * 3 / 2 + 64;
+        case KT_SOLID:
+            /* one colour, the pad picks a pixel that is different, none,
+               the alpha of the last or the blue of the middle one */
+            s32 = (uint32_t *) (test->solid + offset);
+            stride = width + 4;
+            for (index = 0; index < stride * height; index++)
+            {
+                s32[index] = 0x80C0E0F0;
+            }
+            if (pad == 4)
+            {
+                s32[stride * (height - 1) + width - 1] ^= 0x01000000;
+            }
+            else if (pad != 0)
+            {
+                s32[stride * (height / 2) + width / 2] ^= 0x00000001;
+            }
+            args->src = test->solid + offset;
+            args->src_stride = stride * 4;
+            args->dst = dst;
+            return 8;
+        default:
+            args->src = test->src + offset;
+            args->src_stride = width * 4 + pad;
+            args->dst = dst + offset;
+            args->dst_stride = width * kernel->dst_bpp + pad;
+            return offset + args->dst_stride * height;
+    }
+}
+
+/******************************************************************************/
+/* compare a kernel against the C one over all the sizes, returns the
+   biggest byte difference, 0 is bit exact */
+static int
+check_kernel(struct kernel_test *test, const struct kernel *kernel,
+             int level, int *first_width, int *first_height)
+{
+    struct kernel_args ref_args;
+    struct kernel_args args;
+    int max_diff;
+    int diff;
+    int bytes;
+    int index;
+    int wi;
+    int hi;
+    int oi;
+    int pi;
+    int di;
+
+    max_diff = 0;
+    *first_width = 0;
+    *first_height = 0;
+    for (wi = 0; wi < NUM_WIDTHS; wi++)
+    {
+        for (hi = 0; hi < NUM_HEIGHTS; hi++)
+        {
+            for (oi = 0; oi < NUM_OFFSETS; oi++)
+            {
+                for (pi = 0; pi < NUM_PADS; pi++)
+                {
+                    /* no dither and a dither pattern */
+                    for (di = 0; di < 2; di++)
+                    {
+                        if ((di == 1) && (kernel->type != KT_DITHER))
+                        {
+                            break;
+                        }
+                        if (di == 0)
+                        {
+                            memset(test->dither, 0, sizeof(test->dither));
+                        }
+                        else
+                        {
+                            make_dither(test, kernel, g_widths[wi],
+                                        g_heights[hi]);
+                        }
+                        bytes = setup_args(test, kernel, test->ref_dst,
+                                           g_widths[wi], g_heights[hi],
+                                           g_offsets[oi], g_pads[pi],
+                                           &ref_args);
+                        if (bytes == 0)
+                        {
+                            continue;
+                        }
+                        setup_args(test, kernel, test->dst,
+                                   g_widths[wi], g_heights[hi],
+                                   g_offsets[oi], g_pads[pi], &args);
+                        /* the guard bytes must come out the same too */
+                        memset(test->ref_dst, 0xA5, bytes + 64);
+                        memset(test->dst, 0xA5, bytes + 64);
+                        run_kernel(test->devs + RDP_SIMD_C, kernel,
+                                   &ref_args);
+                        run_kernel(test->devs + level, kernel, &args);
+                        diff = memcmp(ref_args.hash, args.hash,
+                                      sizeof(args.hash)) != 0 ? 256 : 0;
+                        for (index = 0; index < bytes + 64; index++)
+                        {
+                            diff = RDPMAX(diff, abs(test->ref_dst[index] -
+                                                    test->dst[index]));
+                        }
+                        if ((diff != 0) && (*first_width == 0))
+                        {
+                            *first_width = g_widths[wi];
+                            *first_height = g_heights[hi];
+                        }
+                        max_diff = RDPMAX(max_diff, diff);
+                    }
+                }
+            }
+        }
+    }
+    return max_diff;
+}
+
+/******************************************************************************/
+/* write the whole eviction buffer so the kernel's buffers are not in
+   any cache level */
+static void
+evict_caches(struct kernel_test *test)
+{
+    int index;
+
+    for (index = 0; index < test->evict_bytes; index += 64)
+    {
+        test->evict[index]++;
+    }
+}
+
+/******************************************************************************/
+/* ticks per pixel, the median of the runs */
+static double
+time_kernel(struct kernel_test *test, const struct kernel *kernel,
+            int level, int cold)
+{
+    struct kernel_args args;
+    uint64_t ticks[64];
+    uint64_t start;
+    uint64_t temp;
+    int width;
+    int height;
+    int runs;
+    int index;
+    int jndex;
+
+    width = SPEED_WIDTH;
+    height = SPEED_HEIGHT;
+    if ((kernel->type == KT_YUVALP) || (kernel->type == KT_HASH))
+    {
+        width = 64;
+        height = 64;
+    }
+    memset(test->dither, 0, sizeof(test->dither));
+    setup_args(test, kernel, test->dst, width, height, 0, 0, &args);
+    runs = cold ? 16 : 64;
+    /* warm up, page faults and the like */
+    run_kernel(test->devs + level, kernel, &args);
+    for (index = 0; index < runs; index++)
+    {
+        if (cold)
+        {
+            evict_caches(test);
+        }
+        start = get_ticks();
+        run_kernel(test->devs + level, kernel, &args);
+        ticks[index] = get_ticks() - start;
+    }
+    /* insertion sort, runs is small */
+    for (index = 1; index < runs; index++)
+    {
+        temp = ticks[index];
+        for (jndex = index; (jndex > 0) && (ticks[jndex - 1] > temp); jndex--)
+        {
+            ticks[jndex] = ticks[jndex - 1];
+        }
+        ticks[jndex] = temp;
+    }
+    return (double) ticks[runs / 2] / (width * height);
+}
+
+/******************************************************************************/
+static int
+usage(void)
+{
+    printf("kernel_speed [options]\n");
+    printf("  -q             check only, no timing\n");
+    printf("  -k <name>      only kernels with name in their name\n");
+    printf("  -e <MB>        cache eviction buffer size, default 64\n");
+    return 1;
+}
+
+/******************************************************************************/
+int
+main(int argc, char **argv)
+{
+    struct kernel_test test;
+    const struct kernel *kernel;
+    const char *kernel_name;
+    ScrnInfoRec scrn;
+    char exact_text[64];
+    int max_diff;
+    int first_width;
+    int first_height;
+    int level;
+    int lower;
+    int index;
+    int opt;
+    int rv;
+
+    memset(&test, 0, sizeof(test));
+    test.seed = 1;
+    test.evict_bytes = 64 * 1024 * 1024;
+    kernel_name = NULL;
+    while ((opt = getopt(argc, argv, "qk:e:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'q':
+                test.quick = 1;
+                break;
+            case 'k':
+                kernel_name = optarg;
+                break;
+            case 'e':
+                test.evict_bytes = atoi(optarg) * 1024 * 1024;
+                break;
+            default:
+                return usage();
+        }
+    }
+    if (test.evict_bytes < 1024 * 1024)
+    {
+        return usage();
+    }
+
+    /* one dispatch table for each level, a level the cpu or build does
+       not have comes out the same as the one below it */
+    memset(&scrn, 0, sizeof(scrn));
+    for (level = 0; level < NUM_LEVELS; level++)
+    {
+        g_simd_max_level = level;
+        scrn.driverPrivate = test.devs + level;
+        rdpSimdInit(NULL, &scrn);
+    }
+
+    /* 64 byte aligned so the offsets are the only misalignment */
+    if ((posix_memalign((void **) &(test.src), 64, BUF_BYTES) != 0) ||
+        (posix_memalign((void **) &(test.solid), 64, BUF_BYTES) != 0) ||
+        (posix_memalign((void **) &(test.ref_dst), 64, BUF_BYTES) != 0) ||
+        (posix_memalign((void **) &(test.dst), 64, BUF_BYTES) != 0))
+    {
+        printf("out of memory\n");
+        return 1;
+    }
+    fill_src(&test);
+    if (!test.quick)
+    {
+        test.evict = g_new0(uint8_t, test.evict_bytes);
+    }
+
+    printf("%-28s %-5s %-14s %9s %9s\n", "kernel", "level", "vs c",
+           "hot " TICKS_NAME, "cold " TICKS_NAME);
+    rv = 0;
+    for (index = 0; index < NUM_KERNELS; index++)
+    {
+        kernel = g_kernels + index;
+        if ((kernel_name != NULL) && (strstr(kernel->name, kernel_name) == NULL))
+        {
+            continue;
+        }
+        for (level = 0; level < NUM_LEVELS; level++)
+        {
+            /* skip a level that assigns the same function as a lower one */
+            for (lower = 0; lower < level; lower++)
+            {
+                if (get_proc(test.devs + lower, kernel) ==
+                    get_proc(test.devs + level, kernel))
+                {
+                    break;
+                }
+            }
+            if (lower < level)
+            {
+                continue;
+            }
+            if (level == RDP_SIMD_C)
+            {
+                snprintf(exact_text, sizeof(exact_text), "reference");
+            }
+            else
+            {
+                max_diff = check_kernel(&test, kernel, level,
+                                        &first_width, &first_height);
+                if (max_diff == 0)
+                {
+                    snprintf(exact_text, sizeof(exact_text), "exact");
+                }
+                else if (kernel->exact)
+                {
+                    snprintf(exact_text, sizeof(exact_text), "FAIL %dx%d",
+                             first_width, first_height);
+                    rv = 1;
+                }
+                else
+                {
+                    snprintf(exact_text, sizeof(exact_text), "max diff %d",
+                             max_diff);
+                }
+            }
+            if (test.quick)
+            {
+                printf("%-28s %-5s %-14s\n", kernel->name,
+                       g_level_names[level], exact_text);
+                continue;
+            }
+            printf("%-28s %-5s %-14s %9.3f %9.3f\n", kernel->name,
+                   g_level_names[level], exact_text,
+                   time_kernel(&test, kernel, level, 0),
+                   time_kernel(&test, kernel, level, 1));
+        }
+    }
+
+    free(test.evict);
+    free(test.dst);
+    free(test.ref_dst);
+    free(test.solid);
+    free(test.src);
+    return rv;
+}
@@ -0,0 +1,5 @@
+#! /bin/sh
+
+# every kernel at every level the cpu has must match the C version,
+# run kernel_speed by hand for the timing
+./kernel_speed -q
@@ -0,0 +1,2 @@
+/* the module source, built against the stub X headers */
+#include "rdpWorker.c"
@@ -0,0 +1,192 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+just enough of the X server and pixman types to build the capture code
+outside of Xorg, the other X headers are empty and everything is here
+
+*/
+
+#ifndef _XORG_SERVER_H_
+#define _XORG_SERVER_H_
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define _X_EXPORT
+
+#define XORG_VERSION_NUMERIC(major, minor, patch, snap, dummy) \
+    (((major) * 10000000) + ((minor) * 100000) + ((patch) * 1000) + (snap))
+#define XORG_VERSION_CURRENT XORG_VERSION_NUMERIC(1, 21, 1, 0, 0)
+
+#define X_LITTLE_ENDIAN 1234
+#define X_BIG_ENDIAN 4321
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define X_BYTE_ORDER X_BIG_ENDIAN
+#else
+#define X_BYTE_ORDER X_LITTLE_ENDIAN
+#endif
+
+typedef int Bool;
+#define TRUE 1
+#define FALSE 0
+
+typedef uint8_t CARD8;
+typedef uint16_t CARD16;
+typedef uint32_t CARD32;
+typedef uint64_t CARD64;
+typedef int16_t INT16;
+typedef int32_t INT32;
+typedef void *pointer;
+
+/* the pixman region layout, REGION_RECTS follows the header */
+typedef struct _Box
+{
+    short x1;
+    short y1;
+    short x2;
+    short y2;
+} BoxRec, *BoxPtr;
+
+typedef struct _RegData
+{
+    long size;
+    long numRects;
+} RegDataRec, *RegDataPtr;
+
+typedef struct _Region
+{
+    BoxRec extents;
+    RegDataPtr data;
+} RegionRec, *RegionPtr;
+
+#define NullBox ((BoxPtr) 0)
+#define REGION_NUM_RECTS(_reg) \
+    ((_reg)->data ? (int) (_reg)->data->numRects : 1)
+#define REGION_RECTS(_reg) \
+    ((_reg)->data ? (BoxPtr) ((_reg)->data + 1) : &((_reg)->extents))
+
+#define rgnOUT 0
+#define rgnIN 1
+#define rgnPART 2
+
+#define CT_NONE 0
+#define CT_YXBANDED 3
+
+typedef struct _xRectangle
+{
+    INT16 x;
+    INT16 y;
+    CARD16 width;
+    CARD16 height;
+} xRectangle, *xRectanglePtr;
+
+typedef struct _xSegment
+{
+    INT16 x1;
+    INT16 y1;
+    INT16 x2;
+    INT16 y2;
+} xSegment;
+
+typedef struct _DDXPoint
+{
+    short x;
+    short y;
+} DDXPointRec, *DDXPointPtr;
+
+/* opaque to the capture code */
+typedef struct _Screen *ScreenPtr;
+typedef struct _GC *GCPtr;
+typedef struct _Drawable *DrawablePtr;
+typedef struct _Pixmap *PixmapPtr;
+typedef struct _Window *WindowPtr;
+typedef struct _DeviceIntRec *DeviceIntPtr;
+typedef struct _Font *FontPtr;
+typedef struct _CharInfo *CharInfoPtr;
+typedef struct _Picture *PicturePtr;
+typedef struct _OsTimerRec *OsTimerPtr;
+typedef struct _Damage *DamagePtr;
+typedef struct _miPointerScreenFuncRec *miPointerScreenFuncPtr;
+typedef struct _GCFuncs GCFuncs;
+typedef struct _GCOps GCOps;
+typedef void (*CopyWindowProcPtr)(void);
+typedef void (*CreateGCProcPtr)(void);
+typedef void (*CreatePixmapProcPtr)(void);
+typedef void (*DestroyPixmapProcPtr)(void);
+typedef void (*ModifyPixmapHeaderProcPtr)(void);
+typedef void (*CloseScreenProcPtr)(void);
+typedef void (*CompositeProcPtr)(void);
+typedef void (*GlyphsProcPtr)(void);
+typedef void (*TrapezoidsProcPtr)(void);
+typedef void (*CreateScreenResourcesProcPtr)(void);
+typedef void (*TrianglesProcPtr)(void);
+typedef void (*CompositeRectsProcPtr)(void);
+typedef void (*RRSetConfigProcPtr)(void);
+typedef void (*RRGetInfoProcPtr)(void);
+typedef void (*RRScreenSetSizeProcPtr)(void);
+typedef void (*RRCrtcSetProcPtr)(void);
+typedef void (*RRCrtcSetGammaProcPtr)(void);
+typedef void (*RRCrtcGetGammaProcPtr)(void);
+typedef void (*RROutputSetPropertyProcPtr)(void);
+typedef void (*RROutputValidateModeProcPtr)(void);
+typedef void (*RRModeDestroyProcPtr)(void);
+typedef void (*RROutputGetPropertyProcPtr)(void);
+typedef void (*RRGetPanningProcPtr)(void);
+typedef void (*RRSetPanningProcPtr)(void);
+
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+/* the region calls rdpReg.c makes, see xorg_stub.c */
+extern Bool RegionCopy(RegionPtr dst, RegionPtr src);
+extern void RegionTranslate(RegionPtr pReg, int x, int y);
+extern Bool RegionNotEmpty(RegionPtr pReg);
+extern Bool RegionIntersect(RegionPtr newReg, RegionPtr reg1, RegionPtr reg2);
+extern int RegionContainsRect(RegionPtr pReg, BoxPtr prect);
+extern void RegionInit(RegionPtr pReg, BoxPtr rect, int size);
+extern void RegionUninit(RegionPtr pReg);
+extern RegionPtr RegionFromRects(int nrects, xRectanglePtr prect, int ctype);
+extern void RegionDestroy(RegionPtr pReg);
+extern RegionPtr RegionCreate(BoxPtr rect, int size);
+extern Bool RegionUnion(RegionPtr newReg, RegionPtr reg1, RegionPtr reg2);
+extern Bool RegionSubtract(RegionPtr newReg, RegionPtr reg1, RegionPtr reg2);
+extern Bool RegionInverse(RegionPtr newReg, RegionPtr reg1, BoxPtr invRect);
+extern BoxPtr RegionExtents(RegionPtr pReg);
+extern void RegionReset(RegionPtr pReg, BoxPtr pBox);
+extern Bool RegionBreak(RegionPtr pReg);
+
+typedef struct _ScrnInfoRec
+{
+    void *driverPrivate;
+} ScrnInfoRec, *ScrnInfoPtr;
+
+#define ErrorF printf
+#define xnfalloc malloc
+#define xnfcalloc calloc
+#define xnfrealloc realloc
+
+#endif
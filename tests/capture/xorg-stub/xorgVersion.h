@@ -0,0 +1 @@
+/* empty, see xorg-server.h */
@@ -0,0 +1,425 @@
+/*
+Copyright 2024 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+the parts of the X server the capture code needs
+the region is a sorted list of boxes that do not overlap, like pixman's
+but not banded, it is slow for big lists but fine for damage
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xorg-server.h>
+
+static RegDataRec g_empty_data = { 0, 0 };
+
+/*****************************************************************************/
+static int
+box_cmp(const void *a, const void *b)
+{
+    const BoxRec *box1;
+    const BoxRec *box2;
+
+    box1 = (const BoxRec *) a;
+    box2 = (const BoxRec *) b;
+    if (box1->y1 != box2->y1)
+    {
+        return box1->y1 - box2->y1;
+    }
+    return box1->x1 - box2->x1;
+}
+
+/*****************************************************************************/
+/* set pReg to the boxes, they must not overlap, empty boxes are dropped */
+static void
+region_set(RegionPtr pReg, const BoxRec *boxes, int num_boxes)
+{
+    RegDataPtr data;
+    BoxPtr dst;
+    int index;
+    int count;
+
+    if ((pReg->data != NULL) && (pReg->data != &g_empty_data))
+    {
+        free(pReg->data);
+    }
+    data = (RegDataPtr) malloc(sizeof(RegDataRec) +
+                               sizeof(BoxRec) * (num_boxes + 1));
+    dst = (BoxPtr) (data + 1);
+    count = 0;
+    for (index = 0; index < num_boxes; index++)
+    {
+        if ((boxes[index].x1 < boxes[index].x2) &&
+            (boxes[index].y1 < boxes[index].y2))
+        {
+            dst[count++] = boxes[index];
+        }
+    }
+    if (count == 0)
+    {
+        free(data);
+        pReg->extents.x1 = 0;
+        pReg->extents.y1 = 0;
+        pReg->extents.x2 = 0;
+        pReg->extents.y2 = 0;
+        pReg->data = &g_empty_data;
+        return;
+    }
+    qsort(dst, count, sizeof(BoxRec), box_cmp);
+    pReg->extents = dst[0];
+    for (index = 1; index < count; index++)
+    {
+        pReg->extents.x1 = min(pReg->extents.x1, dst[index].x1);
+        pReg->extents.y1 = min(pReg->extents.y1, dst[index].y1);
+        pReg->extents.x2 = max(pReg->extents.x2, dst[index].x2);
+        pReg->extents.y2 = max(pReg->extents.y2, dst[index].y2);
+    }
+    if (count == 1)
+    {
+        free(data);
+        pReg->data = NULL;
+        return;
+    }
+    data->size = count + 1;
+    data->numRects = count;
+    pReg->data = data;
+}
+
+/*****************************************************************************/
+/* the boxes of reg1 minus the boxes of reg2, in a new malloced list */
+static BoxPtr
+boxes_subtract(RegionPtr reg1, RegionPtr reg2, int *num_boxes)
+{
+    BoxPtr boxes;
+    BoxPtr next;
+    BoxPtr sub;
+    BoxRec box;
+    BoxRec in;
+    int count;
+    int next_count;
+    int alloc;
+    int index;
+    int jndex;
+
+    count = REGION_NUM_RECTS(reg1);
+    alloc = count + 1;
+    boxes = (BoxPtr) malloc(sizeof(BoxRec) * alloc);
+    memcpy(boxes, REGION_RECTS(reg1), sizeof(BoxRec) * count);
+    sub = REGION_RECTS(reg2);
+    for (jndex = 0; jndex < REGION_NUM_RECTS(reg2); jndex++)
+    {
+        /* each box splits in at most 4 */
+        next = (BoxPtr) malloc(sizeof(BoxRec) * (count * 4 + 1));
+        next_count = 0;
+        for (index = 0; index < count; index++)
+        {
+            box = boxes[index];
+            in.x1 = max(box.x1, sub[jndex].x1);
+            in.y1 = max(box.y1, sub[jndex].y1);
+            in.x2 = min(box.x2, sub[jndex].x2);
+            in.y2 = min(box.y2, sub[jndex].y2);
+            if ((in.x1 >= in.x2) || (in.y1 >= in.y2))
+            {
+                next[next_count++] = box;
+                continue;
+            }
+            if (box.y1 < in.y1)
+            {
+                next[next_count] = box;
+                next[next_count++].y2 = in.y1;
+            }
+            if (in.y2 < box.y2)
+            {
+                next[next_count] = box;
+                next[next_count++].y1 = in.y2;
+            }
+            if (box.x1 < in.x1)
+            {
+                next[next_count].x1 = box.x1;
+                next[next_count].y1 = in.y1;
+                next[next_count].x2 = in.x1;
+                next[next_count++].y2 = in.y2;
+            }
+            if (in.x2 < box.x2)
+            {
+                next[next_count].x1 = in.x2;
+                next[next_count].y1 = in.y1;
+                next[next_count].x2 = box.x2;
+                next[next_count++].y2 = in.y2;
+            }
+        }
+        free(boxes);
+        boxes = next;
+        count = next_count;
+    }
+    *num_boxes = count;
+    return boxes;
+}
+
+/*****************************************************************************/
+void
+RegionInit(RegionPtr pReg, BoxPtr rect, int size)
+{
+    (void) size;
+    if (rect != NULL)
+    {
+        pReg->extents = *rect;
+        pReg->data = NULL;
+    }
+    else
+    {
+        memset(&(pReg->extents), 0, sizeof(BoxRec));
+        pReg->data = &g_empty_data;
+    }
+}
+
+/*****************************************************************************/
+void
+RegionUninit(RegionPtr pReg)
+{
+    if ((pReg->data != NULL) && (pReg->data != &g_empty_data))
+    {
+        free(pReg->data);
+    }
+    pReg->data = NULL;
+}
+
+/*****************************************************************************/
+RegionPtr
+RegionCreate(BoxPtr rect, int size)
+{
+    RegionPtr pReg;
+
+    pReg = (RegionPtr) malloc(sizeof(RegionRec));
+    RegionInit(pReg, rect, size);
+    return pReg;
+}
+
+/*****************************************************************************/
+void
+RegionDestroy(RegionPtr pReg)
+{
+    RegionUninit(pReg);
+    free(pReg);
+}
+
+/*****************************************************************************/
+Bool
+RegionCopy(RegionPtr dst, RegionPtr src)
+{
+    if (dst != src)
+    {
+        region_set(dst, REGION_RECTS(src), REGION_NUM_RECTS(src));
+    }
+    return TRUE;
+}
+
+/*****************************************************************************/
+void
+RegionTranslate(RegionPtr pReg, int x, int y)
+{
+    BoxPtr boxes;
+    int index;
+
+    boxes = REGION_RECTS(pReg);
+    for (index = 0; index < REGION_NUM_RECTS(pReg); index++)
+    {
+        boxes[index].x1 += x;
+        boxes[index].y1 += y;
+        boxes[index].x2 += x;
+        boxes[index].y2 += y;
+    }
+    if (pReg->data != NULL)
+    {
+        pReg->extents.x1 += x;
+        pReg->extents.y1 += y;
+        pReg->extents.x2 += x;
+        pReg->extents.y2 += y;
+    }
+}
+
+/*****************************************************************************/
+Bool
+RegionNotEmpty(RegionPtr pReg)
+{
+    return REGION_NUM_RECTS(pReg) > 0;
+}
+
+/*****************************************************************************/
+Bool
+RegionIntersect(RegionPtr newReg, RegionPtr reg1, RegionPtr reg2)
+{
+    BoxPtr boxes;
+    BoxPtr box1;
+    BoxPtr box2;
+    int num_boxes;
+    int index;
+    int jndex;
+
+    boxes = (BoxPtr) malloc(sizeof(BoxRec) * (REGION_NUM_RECTS(reg1) *
+                            REGION_NUM_RECTS(reg2) + 1));
+    num_boxes = 0;
+    box1 = REGION_RECTS(reg1);
+    box2 = REGION_RECTS(reg2);
+    for (index = 0; index < REGION_NUM_RECTS(reg1); index++)
+    {
+        for (jndex = 0; jndex < REGION_NUM_RECTS(reg2); jndex++)
+        {
+            boxes[num_boxes].x1 = max(box1[index].x1, box2[jndex].x1);
+            boxes[num_boxes].y1 = max(box1[index].y1, box2[jndex].y1);
+            boxes[num_boxes].x2 = min(box1[index].x2, box2[jndex].x2);
+            boxes[num_boxes].y2 = min(box1[index].y2, box2[jndex].y2);
+            num_boxes++;
+        }
+    }
+    region_set(newReg, boxes, num_boxes);
+    free(boxes);
+    return TRUE;
+}
+
+/*****************************************************************************/
+Bool
+RegionUnion(RegionPtr newReg, RegionPtr reg1, RegionPtr reg2)
+{
+    BoxPtr boxes;
+    BoxPtr sub;
+    int num_boxes;
+    int num_sub;
+
+    /* reg1 plus the parts of reg2 not in reg1 */
+    sub = boxes_subtract(reg2, reg1, &num_sub);
+    num_boxes = REGION_NUM_RECTS(reg1);
+    boxes = (BoxPtr) malloc(sizeof(BoxRec) * (num_boxes + num_sub + 1));
+    memcpy(boxes, REGION_RECTS(reg1), sizeof(BoxRec) * num_boxes);
+    memcpy(boxes + num_boxes, sub, sizeof(BoxRec) * num_sub);
+    region_set(newReg, boxes, num_boxes + num_sub);
+    free(boxes);
+    free(sub);
+    return TRUE;
+}
+
+/*****************************************************************************/
+Bool
+RegionSubtract(RegionPtr newReg, RegionPtr reg1, RegionPtr reg2)
+{
+    BoxPtr boxes;
+    int num_boxes;
+
+    boxes = boxes_subtract(reg1, reg2, &num_boxes);
+    region_set(newReg, boxes, num_boxes);
+    free(boxes);
+    return TRUE;
+}
+
+/*****************************************************************************/
+Bool
+RegionInverse(RegionPtr newReg, RegionPtr reg1, BoxPtr invRect)
+{
+    RegionRec inv_reg;
+    Bool rv;
+
+    RegionInit(&inv_reg, invRect, 0);
+    rv = RegionSubtract(newReg, &inv_reg, reg1);
+    RegionUninit(&inv_reg);
+    return rv;
+}
+
+/*****************************************************************************/
+int
+RegionContainsRect(RegionPtr pReg, BoxPtr prect)
+{
+    BoxPtr boxes;
+    int index;
+    int area;
+    int width;
+    int height;
+
+    area = 0;
+    boxes = REGION_RECTS(pReg);
+    for (index = 0; index < REGION_NUM_RECTS(pReg); index++)
+    {
+        width = min(boxes[index].x2, prect->x2) -
+                max(boxes[index].x1, prect->x1);
+        height = min(boxes[index].y2, prect->y2) -
+                 max(boxes[index].y1, prect->y1);
+        if ((width > 0) && (height > 0))
+        {
+            area += width * height;
+        }
+    }
+    if (area == 0)
+    {
+        return rgnOUT;
+    }
+    if (area == (prect->x2 - prect->x1) * (prect->y2 - prect->y1))
+    {
+        return rgnIN;
+    }
+    return rgnPART;
+}
+
+/*****************************************************************************/
+RegionPtr
+RegionFromRects(int nrects, xRectanglePtr prect, int ctype)
+{
+    RegionPtr pReg;
+    RegionRec rect_reg;
+    BoxRec box;
+    int index;
+
+    (void) ctype;
+    pReg = RegionCreate(NullBox, 0);
+    for (index = 0; index < nrects; index++)
+    {
+        box.x1 = prect[index].x;
+        box.y1 = prect[index].y;
+        box.x2 = prect[index].x + prect[index].width;
+        box.y2 = prect[index].y + prect[index].height;
+        RegionInit(&rect_reg, &box, 0);
+        RegionUnion(pReg, pReg, &rect_reg);
+        RegionUninit(&rect_reg);
+    }
+    return pReg;
+}
+
+/*****************************************************************************/
+BoxPtr
+RegionExtents(RegionPtr pReg)
+{
+    return &(pReg->extents);
+}
+
+/*****************************************************************************/
+void
+RegionReset(RegionPtr pReg, BoxPtr pBox)
+{
+    RegionUninit(pReg);
+    RegionInit(pReg, pBox, 0);
+}
+
+/*****************************************************************************/
+Bool
+RegionBreak(RegionPtr pReg)
+{
+    RegionUninit(pReg);
+    RegionInit(pReg, NullBox, 0);
+    return FALSE;
+}
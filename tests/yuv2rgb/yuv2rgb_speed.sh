@@ -1,3 +0,0 @@
-#! /bin/sh
-
-./yuv2rgb_speed runtest